@@ -0,0 +1,45 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// History Shader
+uniform sampler2DArray iHistory;    // stored images
+uniform int layer;                  // index of image to restore
+uniform bool compact;               // YCoCg with checkerboard chroma, or RGBA
+
+const ivec2 neighbors[4] = ivec2[4]( ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1) );
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    vec4 center = texelFetch(iHistory, ivec3(coord, layer), 0);
+
+    // full precision
+    if (!compact) {
+        FragColor = center;
+        return;
+    }
+
+    // the missing chroma component is in the neighbors:
+    // interpolate it with more weight to neighbors of similar luma
+    ivec2 size = textureSize(iHistory, 0).xy;
+    float sum = 0.0;
+    float total = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 n = coord + neighbors[i];
+        if ( any(lessThan(n, ivec2(0))) || any(greaterThanEqual(n, size)) )
+            n = coord - neighbors[i];
+        vec2 YC = texelFetch(iHistory, ivec3(n, layer), 0).rg;
+        float w = 1.0 / (abs(YC.r - center.r) + 0.01);
+        sum += w * YC.g;
+        total += w;
+    }
+    float other = sum / total;
+
+    // inverse YCoCg transform
+    bool even = ((coord.x + coord.y) & 1) == 0;
+    float Y  = center.r;
+    float Co = (even ? center.g : other) - 0.5;
+    float Cg = (even ? other : center.g) - 0.5;
+    FragColor = vec4(Y + Co - Cg, Y + Cg, Y - Co - Cg, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// History Shader
+uniform sampler2D iChannel0;        // image to store
+uniform bool compact;               // YCoCg with checkerboard chroma, or RGBA
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    vec4 RGBA = texelFetch(iChannel0, coord, 0);
+
+    // full precision
+    if (!compact) {
+        FragColor = RGBA;
+        return;
+    }
+
+    // YCoCg transform
+    float Y  = dot(RGBA.rgb, vec3( 0.25, 0.5,  0.25));
+    float Co = dot(RGBA.rgb, vec3( 0.5,  0.0, -0.5 )) + 0.5;
+    float Cg = dot(RGBA.rgb, vec3(-0.25, 0.5, -0.25)) + 0.5;
+
+    // alternate chroma components in a checkerboard pattern
+    bool even = ((coord.x + coord.y) & 1) == 0;
+    FragColor = vec4(Y, even ? Co : Cg, 0.0, 1.0);
+}
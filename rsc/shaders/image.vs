@@ -8,7 +8,12 @@ out vec4 vertexColor;
 out vec2 vertexUV;
 
 uniform mat4 modelview;
-uniform mat4 projection;
+
+// projection of the view, shared by all programs
+layout (std140) uniform View
+{
+    mat4 projection;
+};
 uniform mat4 iNodes;
 
 void main()
@@ -0,0 +1,59 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// from General Shader
+uniform vec3 iResolution;           // viewport image resolution (in pixels)
+
+// YUV Packing Shader
+uniform sampler2D iChannel0;        // RGB image to convert
+uniform vec2 frameSize;             // size of RGB image (in pixels)
+uniform int format;                 // 0: I420, 1: NV12
+uniform int offsetU;                // bytes offset of plane U (I420) or UV (NV12)
+uniform int offsetV;                // bytes offset of plane V (I420 only)
+uniform int strideY;                // bytes per row of luma plane
+uniform int strideUV;               // bytes per row of chroma plane(s)
+uniform mat4 rgbMatrix;             // RGB to YUV conversion
+
+// compute the value of the byte at index n of the YUV image
+float byteAt(int n)
+{
+    ivec2 size = ivec2(frameSize);
+    ivec2 chroma = (size + 1) / 2;
+
+    // luma plane
+    if ( n < offsetU ) {
+        ivec2 p = ivec2( n % strideY, n / strideY );
+        if ( p.x >= size.x )
+            return 0.0;
+        vec3 RGB = texelFetch(iChannel0, p, 0).rgb;
+        return (rgbMatrix * vec4(RGB, 1.0)).x;
+    }
+
+    // chroma planes
+    int plane = ( format == 0 && n >= offsetV ) ? 2 : 1;
+    int local = n - ( plane == 2 ? offsetV : offsetU );
+    ivec2 p = ivec2( local % strideUV, local / strideUV );
+
+    // NV12 interleaves U and V in one plane
+    if ( format == 1 ) {
+        plane = 1 + p.x % 2;
+        p.x = p.x / 2;
+    }
+    if ( p.x >= chroma.x || p.y >= chroma.y )
+        return 0.0;
+
+    // average of the 2x2 block with a single linear fetch at its center
+    vec2 uv = vec2(2 * p + 1) / frameSize;
+    vec3 RGB = textureLod(iChannel0, uv, 0.0).rgb;
+    return (rgbMatrix * vec4(RGB, 1.0))[plane];
+}
+
+void main()
+{
+    // each RGBA fragment packs 4 consecutive bytes of the YUV image
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    int n = 4 * (coord.y * int(iResolution.x) + coord.x);
+
+    FragColor = vec4( byteAt(n), byteAt(n + 1), byteAt(n + 2), byteAt(n + 3) );
+}
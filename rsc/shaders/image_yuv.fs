@@ -0,0 +1,35 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec4 vertexColor;
+in vec2 vertexUV;
+
+// from General Shader
+uniform vec3 iResolution;           // viewport image resolution (in pixels)
+uniform mat4 iTransform;            // image transformation
+uniform vec4 color;
+
+// YUV Shader
+uniform sampler2D iChannel0;        // luma plane Y
+uniform sampler2D iChannel1;        // chroma plane U (I420) or interleaved UV (NV12)
+uniform sampler2D iChannel2;        // chroma plane V (I420 only)
+uniform int format;                 // 0: I420, 1: NV12
+uniform mat4 yuvMatrix;             // YUV to RGB conversion
+
+void main()
+{
+    // adjust UV
+    vec4 texcoord = iTransform * vec4(vertexUV.x, vertexUV.y, 0.0, 1.0);
+
+    // read luma and chroma planes
+    float Y = texture(iChannel0, texcoord.xy).r;
+    vec2 UV = ( format == 1 ) ? texture(iChannel1, texcoord.xy).rg
+                              : vec2( texture(iChannel1, texcoord.xy).r, texture(iChannel2, texcoord.xy).r );
+
+    // convert to RGB
+    vec3 RGB = clamp( (yuvMatrix * vec4(Y, UV, 1.0)).rgb, 0.0, 1.0);
+
+    // color is a mix of texture, vertex and uniform colors (opaque)
+    FragColor = vec4(RGB * vertexColor.rgb * color.rgb, 1.0);
+}
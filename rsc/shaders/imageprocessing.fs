@@ -47,6 +47,13 @@ uniform float threshold;
 uniform int   nbColors;
 uniform int   invert;
 
+// Image filter fused before processing (code appended after main)
+#ifdef FILTERED
+vec3 iChannelResolution[2];
+uniform sampler2D iChannel1;
+void mainImage( out vec4 fragColor, in vec2 fragCoord );
+#endif
+
 /*
 ** Hue, saturation, luminance <=> Red Green Blue
 */
@@ -110,7 +117,16 @@ void main(void)
     // adjust UV
     texcoord = iTransform * vec4(vertexUV.x, vertexUV.y, 0.0, 1.0);
 
+#ifdef FILTERED
+    // color given by the filter (clamped as if stored in a frame buffer)
+    iChannelResolution[0] = vec3(textureSize(iChannel0, 0), 0.f);
+    iChannelResolution[1] = vec3(textureSize(iChannel1, 0), 0.f);
+    vec4 texcolor;
+    mainImage( texcolor, texcoord.xy * iResolution.xy );
+    texcolor = clamp(texcolor, 0.0, 1.0);
+#else
     vec4 texcolor = texture(iChannel0, texcoord.xy);
+#endif
 
     // deal with alpha separately
     float alpha = clamp(texcolor.a * color.a, 0.0, 1.0);
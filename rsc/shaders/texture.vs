@@ -8,11 +8,19 @@ out vec4 vertexColor;
 out vec2 vertexUV;
 
 uniform mat4 modelview;
-uniform mat4 projection;
+uniform mat4 instances[15];         // modelview of instances after the first
+
+// projection of the view, shared by all programs
+layout (std140) uniform View
+{
+    mat4 projection;
+};
 
 void main()
 {
-    vec4 pos = modelview * vec4(position, 1.0);
+    // first instance (or single draw) uses modelview
+    mat4 m = gl_InstanceID > 0 ? instances[gl_InstanceID - 1] : modelview;
+    vec4 pos = m * vec4(position, 1.0);
 
     // output
     gl_Position = projection * pos;
@@ -20,6 +20,7 @@
 #include <string>
 #include <algorithm>
 #include <thread>
+#include <set>
 
 #include "Log.h"
 #include "View.h"
@@ -38,13 +39,14 @@
 #define ACTION_DEBUG
 #endif
 
-#define HISTORY_NODE(i) std::to_string(i).insert(0,1,'H')
+#define HISTORY_NODE "History"
 
 using namespace tinyxml2;
 
 
-Action::Action(): history_step_(0), history_max_step_(0), locked_(false),
-    snapshot_id_(0), snapshot_node_(nullptr), interpolator_(nullptr), interpolator_node_(nullptr)
+Action::Action(): history_step_(0), history_max_step_(0), history_memory_(0), locked_(false),
+    snapshot_id_(0), snapshot_node_(nullptr), interpolator_(nullptr), interpolator_node_(nullptr),
+    blender_(nullptr)
 {
 
 }
@@ -52,13 +54,12 @@ Action::Action(): history_step_(0), history_max_step_(0), locked_(false),
 void Action::init()
 {
     // clean the history
-    history_doc_.Clear();
-    history_step_ = 0;
-    history_max_step_ = 0;
+    clearHistory();
 
     // reset snapshot
     snapshot_id_ = 0;
     snapshot_node_ = nullptr;
+    clearInterpolation();
 
     store("Session start");
 }
@@ -99,32 +100,204 @@ void captureMixerSession(Session *se, tinyxml2::XMLDocument *doc, std::string no
     }
 }
 
-void Action::store(const std::string &label)
+// get the compact xml description of a source
+std::string captureSource(Source *s)
 {
-    // TODO: set a maximum amount of stored steps? (even very big, just to ensure memory limit)
+    XMLDocument xmlDoc;
+    XMLElement *root = xmlDoc.NewElement( HISTORY_NODE );
+    xmlDoc.InsertEndChild(root);
+
+    SessionVisitor sv(&xmlDoc, root);
+    s->accept(sv);
 
+    XMLPrinter xmlPrint(0, true);
+    XMLElement *sourceNode = root->FirstChildElement("Source");
+    if (sourceNode)
+        sourceNode->Accept(&xmlPrint);
+
+    return xmlPrint.CStr();
+}
+
+// must be called in a thread running in parrallel of the rendering
+static std::map<uint64_t, std::string> captureSources(SourceList sources)
+{
+    std::map<uint64_t, std::string> state;
+    for (auto iter = sources.begin(); iter != sources.end(); ++iter)
+        state[(*iter)->id()] = captureSource(*iter);
+    return state;
+}
+
+void Action::store(const std::string &label)
+{
     // ignore if locked or if no label is given
     if (locked_ || label.empty())
         return;
 
-    // incremental naming of history nodes
-    history_step_++;
+    Session *se = Mixer::manager().session();
+
+    // previous step must be complete
+    collect();
 
     // erase future
-    for (uint e = history_step_; e <= history_max_step_; e++) {
-        XMLElement *node = history_doc_.FirstChildElement( HISTORY_NODE(e).c_str() );
-        if ( node )
-            history_doc_.DeleteChild(node);
+    while (history_.size() > history_step_) {
+        history_memory_ -= history_.back().memory;
+        free(history_.back().thumbnail.buffer);
+        history_.pop_back();
     }
-    history_max_step_ = history_step_;
 
-    // threaded capturing state of current session
-    std::thread(captureMixerSession, Mixer::manager().session(), &history_doc_, HISTORY_NODE(history_step_), label).detach();
+    // pick up thumbnails rendered since last actions
+    for (auto it = history_.begin(); it != history_.end(); ++it)
+        collectThumbnail(*it);
+
+    // new step in history
+    history_.emplace_back();
+    HistoryStep &step = history_.back();
+    step.label = label;
+    step.view = (int) Mixer::manager().view()->mode();
+    step.activation_threshold = se->activationThreshold();
+    step.memory = sizeof(HistoryStep) + label.size();
+
+    // capture all sources in background
+    SourceList sources;
+    for (auto iter = se->begin(); iter != se->end(); ++iter) {
+        step.order.push_back( (*iter)->id() );
+        sources.push_back( *iter );
+    }
+    step.memory += step.order.size() * sizeof(uint64_t);
+    step.pending_sources = std::async(std::launch::async, captureSources, sources);
+
+    // thumbnail will be rendered in the next update
+    step.pending_thumbnail = se->requestThumbnail();
+
+    // incremental steps
+    history_memory_ += step.memory;
+    history_step_ = history_max_step_ = history_.size();
+}
+
+void Action::collect()
+{
+    if ( history_.empty() || !history_.back().pending_sources.valid() )
+        return;
+
+    HistoryStep &step = history_.back();
+    std::map<uint64_t, std::string> state = step.pending_sources.get();
+
+    // keep only the sources which changed
+    // (the first step is the base, and keeps all sources)
+    for (auto it = state.begin(); it != state.end(); ++it) {
+        auto previous = history_state_.find(it->first);
+        if ( history_.size() < 2 || previous == history_state_.end() || previous->second != it->second ) {
+            step.memory += it->second.size();
+            history_memory_ += it->second.size();
+            step.sources[it->first] = it->second;
+        }
+    }
+    history_state_.swap(state);
 
 #ifdef ACTION_DEBUG
-    Log::Info("Action stored %d '%s'", history_step_, label.c_str());
-//        XMLSaveDoc(&history_doc_, "/home/bhbn/history.xml");
+    Log::Info("Action stored %d '%s' (%lu sources changed, %lu kB history)", history_.size(), step.label.c_str(),
+              step.sources.size(), history_memory_ / 1024);
 #endif
+
+    // remove oldest steps if over memory budget
+    evictHistory();
+}
+
+void Action::clearHistory()
+{
+    // wait for capture in background
+    if ( !history_.empty() && history_.back().pending_sources.valid() )
+        history_.back().pending_sources.wait();
+
+    // free thumbnails
+    for (auto it = history_.begin(); it != history_.end(); ++it) {
+        collectThumbnail(*it);
+        free((*it).thumbnail.buffer);
+    }
+
+    history_.clear();
+    history_state_.clear();
+    history_step_ = 0;
+    history_max_step_ = 0;
+    history_memory_ = 0;
+}
+
+void Action::evictHistory()
+{
+    const size_t budget = (size_t) MAX(Settings::application.action_history_budget, 1) * 1048576;
+
+    // never evict the current step
+    while ( history_memory_ > budget && history_step_ > 1 ) {
+
+        HistoryStep &base = history_[0];
+        HistoryStep &next = history_[1];
+
+        // the next step becomes the base: it takes the sources it did not change
+        for (auto id = next.order.begin(); id != next.order.end(); ++id) {
+            if ( next.sources.count(*id) < 1 ) {
+                auto it = base.sources.find(*id);
+                if ( it != base.sources.end() ) {
+                    next.memory += it->second.size();
+                    history_memory_ += it->second.size();
+                    next.sources[*id] = std::move(it->second);
+                }
+            }
+        }
+
+        // drop the oldest step
+        collectThumbnail(base);
+        free(base.thumbnail.buffer);
+        history_memory_ -= base.memory;
+        history_.pop_front();
+
+        --history_step_;
+        --history_max_step_;
+    }
+}
+
+void Action::collectThumbnail(HistoryStep &step)
+{
+    // non-blocking test for the thumbnail promised by rendering
+    if ( step.pending_thumbnail.valid() &&
+         step.pending_thumbnail.wait_for(std::chrono::seconds(0)) == std::future_status::ready ) {
+
+        FrameBufferImage *img = nullptr;
+        try {
+            img = step.pending_thumbnail.get();
+        }
+        // catch any failed promise
+        catch (const std::exception&){
+        }
+
+        // keep jpeg compressed thumbnail
+        if (img) {
+            step.thumbnail = img->getJpeg();
+            step.memory += step.thumbnail.len;
+            history_memory_ += step.thumbnail.len;
+            delete img;
+        }
+    }
+}
+
+std::map<uint64_t, std::string> Action::sourcesAt(uint s) const
+{
+    std::map<uint64_t, std::string> state;
+
+    if (s > 0 && s <= history_.size()) {
+        // list of sources to find
+        const SourceIdList &order = history_[s-1].order;
+        std::set<uint64_t> missing(order.begin(), order.end());
+
+        // search backward the last change of each source
+        for (int i = s - 1; i >= 0 && !missing.empty(); --i) {
+            for (auto it = history_[i].sources.begin(); it != history_[i].sources.end(); ++it) {
+                if ( missing.erase(it->first) > 0 )
+                    state[it->first] = it->second;
+            }
+        }
+    }
+
+    return state;
 }
 
 void Action::undo()
@@ -162,22 +335,21 @@ std::string Action::label(uint s) const
 {
     std::string l = "";
 
-    if (s > 0 && s <= history_max_step_) {
-        const XMLElement *sessionNode = history_doc_.FirstChildElement( HISTORY_NODE(s).c_str());
-        if  (sessionNode)
-            l = sessionNode->Attribute("label");
-    }
+    if (s > 0 && s <= history_max_step_)
+        l = history_[s-1].label;
+
     return l;
 }
 
-FrameBufferImage *Action::thumbnail(uint s) const
+FrameBufferImage *Action::thumbnail(uint s)
 {
     FrameBufferImage *img = nullptr;
 
     if (s > 0 && s <= history_max_step_) {
-        const XMLElement *sessionNode = history_doc_.FirstChildElement( HISTORY_NODE(s).c_str());
-        if  (sessionNode)
-            img = SessionLoader::XMLToImage(sessionNode);
+        HistoryStep &step = history_[s-1];
+        collectThumbnail(step);
+        if (step.thumbnail.buffer != nullptr)
+            img = new FrameBufferImage(step.thumbnail);
     }
 
     return img;
@@ -185,25 +357,56 @@ FrameBufferImage *Action::thumbnail(uint s) const
 
 void Action::restore(uint target)
 {
+    if (history_.empty())
+        return;
+
+    // current step must be complete
+    collect();
+
     // lock
     locked_ = true;
 
-    // get history node of target step
+    // get history step of target
     history_step_ = CLAMP(target, 1, history_max_step_);
-    XMLElement *sessionNode = history_doc_.FirstChildElement( HISTORY_NODE(history_step_).c_str() );
-
-    if (sessionNode) {
+    const HistoryStep &step = history_[history_step_-1];
+
+    // ask view to refresh, and switch to action view if user prefers
+    int view = Settings::application.current_view ;
+    if (Settings::application.action_history_follow_view)
+        view = step.view;
+    Mixer::manager().setView( (View::Mode) view);
+
+    // status of all sources at target step
+    std::map<uint64_t, std::string> state = sourcesAt(history_step_);
+
+    // list the sources which differ from current status
+    std::string xml = "<" HISTORY_NODE ">";
+    for (auto it = state.begin(); it != state.end(); ++it) {
+        auto current = history_state_.find(it->first);
+        if ( current == history_state_.end() || current->second != it->second )
+            xml += it->second;
+    }
+    xml += "</" HISTORY_NODE ">";
 
-        // ask view to refresh, and switch to action view if user prefers
-        int view = Settings::application.current_view ;
-        if (Settings::application.action_history_follow_view)
-            sessionNode->QueryIntAttribute("view", &view);
-        Mixer::manager().setView( (View::Mode) view);
+    // list the sources which are not in the target step
+    SourceIdList removed;
+    for (auto it = history_state_.begin(); it != history_state_.end(); ++it) {
+        if ( state.count(it->first) < 1 )
+            removed.push_back(it->first);
+    }
 
-        // actually restore
-        Mixer::manager().restore(sessionNode);
+    // actually restore only the changes
+    XMLDocument xmlDoc;
+    XMLError eResult = xmlDoc.Parse( xml.c_str() );
+    if ( !XMLResultError(eResult) ) {
+        XMLElement *sessionNode = xmlDoc.FirstChildElement( HISTORY_NODE );
+        sessionNode->SetAttribute("activationThreshold", step.activation_threshold);
+        Mixer::manager().restore(sessionNode, removed, step.order);
     }
 
+    // current status is the target step
+    history_state_.swap(state);
+
     // free
     locked_ = false;
 }
@@ -279,6 +482,7 @@ void Action::replace(uint64_t snapshotid)
         Session *se = Mixer::manager().session();
         if (se) {
             se->snapshots()->xmlDoc_->DeleteChild( snapshot_node_ );
+            clearInterpolation();
 
             // threaded capture state of current session
             std::thread(captureMixerSession, se, se->snapshots()->xmlDoc_, SNAPSHOT_NODE(snapshot_id_), label).detach();
@@ -381,6 +585,7 @@ void Action::remove(uint64_t snapshotid)
         Session *se = Mixer::manager().session();
         se->snapshots()->xmlDoc_->DeleteChild( snapshot_node_ );
         se->snapshots()->keys_.remove( snapshot_id_ );
+        clearInterpolation();
     }
 
     snapshot_node_ = nullptr;
@@ -414,6 +619,75 @@ float Action::interpolation()
     return ret;
 }
 
+void Action::clearInterpolation()
+{
+    if (interpolator_)
+        delete interpolator_;
+    interpolator_ = nullptr;
+    interpolator_node_ = nullptr;
+
+    if (blender_)
+        delete blender_;
+    blender_ = nullptr;
+    blender_snapshots_.clear();
+}
+
+// sources of the session found in at least one of the snapshots
+static SourceList snapshotSources(Session *se, const std::vector<XMLElement *> &snapshots)
+{
+    std::set<uint64_t> ids;
+    for (auto sn = snapshots.begin(); sn != snapshots.end(); ++sn) {
+        XMLElement* N = (*sn)->FirstChildElement("Source");
+        for( ; N ; N = N->NextSiblingElement()) {
+            uint64_t id_xml_ = 0;
+            N->QueryUnsigned64Attribute("id", &id_xml_);
+            ids.insert(id_xml_);
+        }
+    }
+
+    SourceList list;
+    for (auto sit = se->begin(); sit != se->end(); ++sit) {
+        if ( ids.count((*sit)->id()) > 0 )
+            list.push_back(*sit);
+    }
+    return list;
+}
+
+// true if the interpolator was created for exactly these sources
+static bool validInterpolator(Interpolator *interpolator, const SourceList &sources)
+{
+    if (!interpolator || interpolator->sources().size() != sources.size())
+        return false;
+
+    return std::equal(sources.begin(), sources.end(), interpolator->sources().begin());
+}
+
+// create an interpolator for the given sources
+static Interpolator *createInterpolator(const SourceList &sources)
+{
+    Interpolator *interpolator = new Interpolator;
+    for (auto sit = sources.begin(); sit != sources.end(); ++sit)
+        interpolator->add(*sit);
+    return interpolator;
+}
+
+// add a key to the interpolator with the state of sources in a snapshot
+static void addSnapshotKey(Interpolator *interpolator, XMLElement *snapshot)
+{
+    size_t key = interpolator->addKey();
+
+    XMLElement* N = snapshot->FirstChildElement("Source");
+    for( ; N ; N = N->NextSiblingElement()) {
+        uint64_t id_xml_ = 0;
+        N->QueryUnsigned64Attribute("id", &id_xml_);
+
+        // read target in the snapshot xml (ignored if not in session)
+        SourceCore target;
+        SessionLoader::XMLToSourcecore(N, target);
+        interpolator->set(key, id_xml_, target);
+    }
+}
+
 void Action::interpolate(float val, uint64_t snapshotid)
 {
     if (snapshotid > 0)
@@ -421,36 +695,18 @@ void Action::interpolate(float val, uint64_t snapshotid)
 
     if (snapshot_node_) {
 
-        if ( interpolator_node_ != snapshot_node_ ) {
+        SourceList sources = snapshotSources( Mixer::manager().session(), { snapshot_node_ } );
+
+        if ( interpolator_node_ != snapshot_node_
+             || !validInterpolator(interpolator_, sources) ) {
 
             // change interpolator
             if (interpolator_)
                 delete interpolator_;
 
-            // create new interpolator
-            interpolator_ = new Interpolator;
-
-            // current session
-            Session *se = Mixer::manager().session();
-
-            XMLElement* N = snapshot_node_->FirstChildElement("Source");
-            for( ; N ; N = N->NextSiblingElement()) {
-
-                // check if a source with the given id exists in the session
-                uint64_t id_xml_ = 0;
-                N->QueryUnsigned64Attribute("id", &id_xml_);
-                SourceList::iterator sit = se->find(id_xml_);
-
-                // a source with this id exists
-                if ( sit != se->end() ) {
-                    // read target in the snapshot xml
-                    SourceCore target;
-                    SessionLoader::XMLToSourcecore(N, target);
-
-                    // add an interpolator for this source
-                    interpolator_->add(*sit, target);
-                }
-            }
+            // create new interpolator from current state to snapshot
+            interpolator_ = createInterpolator( sources );
+            addSnapshotKey(interpolator_, snapshot_node_);
 
             // operate interpolation on opened snapshot
             interpolator_node_ = snapshot_node_;
@@ -464,7 +720,47 @@ void Action::interpolate(float val, uint64_t snapshotid)
 
 }
 
+void Action::blend(const std::map<uint64_t, float> &weights)
+{
+    Session *se = Mixer::manager().session();
+
+    // list of snapshots to blend
+    std::vector<uint64_t> ids;
+    std::vector<XMLElement *> snapshots;
+    for (auto w = weights.begin(); w != weights.end(); ++w) {
+        XMLElement *sn = se->snapshots()->xmlDoc_->FirstChildElement( SNAPSHOT_NODE(w->first).c_str() );
+        if ( sn ) {
+            ids.push_back(w->first);
+            snapshots.push_back(sn);
+        }
+    }
+
+    // (re)create blender if the sources or the snapshots changed
+    SourceList sources = snapshotSources(se, snapshots);
+    if ( !validInterpolator(blender_, sources) || blender_snapshots_ != ids ) {
 
+        if (blender_)
+            delete blender_;
+
+        // first key is the current state, then one key per snapshot
+        blender_ = createInterpolator(sources);
+        for (auto sn = snapshots.begin(); sn != snapshots.end(); ++sn)
+            addSnapshotKey(blender_, *sn);
+
+        blender_snapshots_ = ids;
+    }
+
+    // weight of the state before blending is the remainder
+    std::vector<float> w(1, 0.f);
+    float sum = 0.f;
+    for (auto id = ids.begin(); id != ids.end(); ++id) {
+        w.push_back( MAX(weights.at(*id), 0.f) );
+        sum += w.back();
+    }
+    w[0] = MAX(1.f - sum, 0.f);
+
+    blender_->blend( w );
+}
 
 // static multithreaded version saving
 static void saveSnapshot(const std::string& filename, tinyxml2::XMLElement *snapshot_node)
@@ -2,14 +2,20 @@
 #define ACTIONMANAGER_H
 
 #include <list>
+#include <map>
+#include <deque>
+#include <vector>
 #include <string>
 #include <atomic>
+#include <future>
 
 #include <tinyxml2.h>
 
+#include "SourceList.h"
+#include "FrameBuffer.h"
+
 class Session;
 class Interpolator;
-class FrameBufferImage;
 
 class Action
 {
@@ -34,10 +40,16 @@ public:
     void redo ();
     void stepTo (uint target);
 
+    // wait for the sources of the last step, captured in background
+    void collect ();
+
     inline uint current () const { return history_step_; }
     inline uint max () const { return history_max_step_; }
     std::string label (uint s) const;
-    FrameBufferImage *thumbnail (uint s) const;
+    FrameBufferImage *thumbnail (uint s);
+
+    // memory used by the undo history (bytes)
+    inline size_t memoryUsage () const { return history_memory_; }
 
     // Snapshots
     static void takeSnapshot (Session *se, const std::string &label, bool create_thread);
@@ -60,14 +72,42 @@ public:
 
     float interpolation ();
     void interpolate (float val, uint64_t snapshotid = 0);
+    // weighted blend of several snapshots; the current state weights the remainder to 1
+    void blend (const std::map<uint64_t, float> &weights);
+    // forget interpolation states (e.g. when sources are deleted)
+    void clearInterpolation ();
 
 private:
 
-    tinyxml2::XMLDocument history_doc_;
+    // Undo history is a list of steps, from oldest (front) to newest (back)
+    // The first step holds the xml of all sources (base), and following
+    // steps only hold the xml of sources which changed since previous step
+    // (the xml of all sources is captured in background, and the changes
+    // are kept when collected)
+    struct HistoryStep {
+        std::string label;
+        int view;
+        float activation_threshold;
+        SourceIdList order;
+        std::map<uint64_t, std::string> sources;
+        std::future< std::map<uint64_t, std::string> > pending_sources;
+        FrameBufferImage::jpegBuffer thumbnail;
+        std::future<FrameBufferImage *> pending_thumbnail;
+        size_t memory;
+    };
+    std::deque<HistoryStep> history_;
     uint history_step_;
     uint history_max_step_;
+    size_t history_memory_;
     std::atomic<bool> locked_;
     void restore(uint target);
+    void clearHistory();
+    void evictHistory();
+    void collectThumbnail(HistoryStep &step);
+    std::map<uint64_t, std::string> sourcesAt(uint s) const;
+
+    // xml of all sources in the current status of the session
+    std::map<uint64_t, std::string> history_state_;
 
     uint64_t snapshot_id_;
     tinyxml2::XMLElement *snapshot_node_;
@@ -75,6 +115,9 @@ private:
     Interpolator *interpolator_;
     tinyxml2::XMLElement *interpolator_node_;
 
+    Interpolator *blender_;
+    std::vector<uint64_t> blender_snapshots_;
+
 };
 
 
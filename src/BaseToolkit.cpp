@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <climits>
 #include <map>
+#include <string_view>
 
 #include <locale>
 #include <unicode/ustream.h>
@@ -353,3 +354,11 @@ std::string BaseToolkit::common_numbered_pattern(const std::list<std::string> &a
     pattern += suffix;
     return pattern;
 }
+
+size_t BaseToolkit::hash(const void *data, size_t size, size_t seed)
+{
+    size_t h = std::hash<std::string_view>{}( std::string_view( (const char *) data, size) );
+
+    // combine with seed
+    return seed ^ ( h + 0x9e3779b9 + (seed << 6) + (seed >> 2) );
+}
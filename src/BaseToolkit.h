@@ -51,6 +51,9 @@ std::string common_pattern(const std::list<std::string> &allStrings);
 // form a pattern "prefix%03dsuffix" (e.g. numbered file list)
 std::string common_numbered_pattern(const std::list<std::string> &allStrings, int *min, int *max);
 
+// hash the bytes of data, combined with a previous hash value (seed)
+size_t hash(const void *data, size_t size, size_t seed = 0);
+
 }
 
 
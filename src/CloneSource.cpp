@@ -34,7 +34,7 @@
 
 #include "CloneSource.h"
 
-CloneSource::CloneSource(Source *origin, uint64_t id) : Source(id), origin_(origin), paused_(false), filter_(nullptr)
+CloneSource::CloneSource(Source *origin, uint64_t id) : Source(id), origin_(origin), paused_(false), filter_(nullptr), fused_(false)
 {
     // initial name copies the origin name: diplucates are namanged in session
     name_ = origin->name();
@@ -93,25 +93,49 @@ void CloneSource::render()
     if ( renderbuffer_ == nullptr )
         init();
     else {
-        // render filter image
-        filter_->draw( origin_->frame() );
-
-        // ensure correct output texture is displayed (could have changed if filter changed)
-        texturesurface_->setTextureIndex( filter_->texture() );
+        // per pixel filter is fused with color correction (single pass)
+        ImageFilteringShader *fused = nullptr;
+        ImageFilter *imagefilter = dynamic_cast<ImageFilter *>(filter_);
+        if ( imagefilter != nullptr && filter_->enabled() && imageProcessingEnabled() )
+            fused = imagefilter->fusableShader();
+        processingshader_->setFilter( fused );
+
+        if ( fused ) {
+            // color correction applies the filter on the origin image
+            texturesurface_->setTextureIndex( origin_->frame()->texture() );
+        }
+        else {
+            // render filter image
+            // (even if disabled when it was fused, to update its image)
+            if ( fused_ && !filter_->enabled() ) {
+                filter_->setEnabled( true );
+                filter_->draw( origin_->frame() );
+                filter_->setEnabled( false );
+            }
+            else
+                filter_->draw( origin_->frame() );
+
+            // ensure correct output texture is displayed (could have changed if filter changed)
+            texturesurface_->setTextureIndex( filter_->texture() );
+        }
+        fused_ = fused != nullptr;
 
         // detect resampling (change of resolution in filter)
-        if ( renderbuffer_->resolution() != filter_->resolution() ) {
-            renderbuffer_->resize( filter_->resolution() );
+        glm::vec3 res = fused_ ? origin_->frame()->resolution() : filter_->resolution();
+        if ( renderbuffer_->resolution() != res ) {
+            renderbuffer_->resize( res );
 //            FrameBuffer *renderbuffer = new FrameBuffer( filter_->resolution(), origin_->frame()->flags() );
 //            attach(renderbuffer);
         }
 
         // render textured surface into frame buffer
         // NB: this also applies the color correction shader
-        renderbuffer_->begin();
-        texturesurface_->draw(glm::identity<glm::mat4>(), renderbuffer_->projection());
-        renderbuffer_->end();
-        ready_ = true;
+        if ( needRender() ) {
+            renderbuffer_->begin();
+            texturesurface_->draw(glm::identity<glm::mat4>(), renderbuffer_->projection());
+            renderbuffer_->end();
+            ready_ = true;
+        }
     }
 }
 
@@ -145,6 +169,9 @@ void CloneSource::update(float dt)
 
 void CloneSource::setFilter(FrameBufferFilter::Type T)
 {
+    // filter might be fused with color correction
+    processingshader_->setFilter( nullptr );
+
     if (filter_)
         delete filter_;
 
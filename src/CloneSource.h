@@ -51,8 +51,9 @@ protected:
     // connecting line
     class DotLine *connection_;
 
-    // Filter
+    // Filter (fused with color correction if per pixel)
     FrameBufferFilter *filter_;
+    bool fused_;
 
 };
 
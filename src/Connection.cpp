@@ -191,6 +191,8 @@ void Connection::print()
 
 void Connection::listen()
 {
+    Log::SetSubsystem("Connection");
+
 #ifdef CONNECTION_DEBUG
     Log::Info("Accepting handshake on port %d", Connection::manager().connections_[0].port_handshake);
 #endif
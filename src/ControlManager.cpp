@@ -311,7 +311,7 @@ std::string Control::RequestListener::FullMessage( const osc::ReceivedMessage& m
 }
 
 
-Control::Control() : receiver_(nullptr)
+Control::Control() : receiver_(nullptr), blend_requested_(false)
 {
     for (size_t i = 0; i < INPUT_MULTITOUCH_COUNT; ++i) {
         multitouch_active[i] = false;
@@ -463,6 +463,19 @@ bool Control::init()
 
 void Control::update()
 {
+    // apply last snapshot blending requested
+    {
+        std::map<uint64_t, float> weights;
+        bool requested = false;
+        {
+            std::lock_guard<std::mutex> lock(blend_access_);
+            std::swap(requested, blend_requested_);
+            weights.swap(blend_weights_);
+        }
+        if (requested)
+            Action::manager().blend(weights);
+    }
+
     // read joystick buttons
     int num_buttons = 0;
     const unsigned char *state_buttons = glfwGetJoystickButtons(GLFW_JOYSTICK_1, &num_buttons );
@@ -516,6 +529,8 @@ void Control::update()
 
 void Control::listen()
 {
+    Log::SetSubsystem("OSC");
+
     if (Control::manager().receiver_)
         Control::manager().receiver_->Run();
 
@@ -1098,6 +1113,20 @@ bool Control::receiveSessionAttribute(const std::string &attribute,
             }
             send_feedback = true;
         }
+        else if ( attribute.compare(OSC_SESSION_BLEND) == 0) {
+            // one weight per snapshot, from the latest to the oldest
+            std::list<uint64_t> snapshots = Action::manager().snapshots();
+            std::map<uint64_t, float> weights;
+            for (auto snap = snapshots.rbegin(); snap != snapshots.rend() && !arguments.Eos(); ++snap) {
+                float w = 0.f;
+                arguments >> w;
+                weights[*snap] = w;
+            }
+            // blend in Control::update (main thread)
+            std::lock_guard<std::mutex> lock(blend_access_);
+            blend_weights_ = weights;
+            blend_requested_ = true;
+        }
         else if ( attribute.compare(OSC_SESSION_OPEN) == 0) {
             const char *filename;
             arguments >> filename;
@@ -78,6 +78,7 @@
 #define OSC_SESSION_OPEN       "/open"
 #define OSC_SESSION_SAVE       "/save"
 #define OSC_SESSION_CLOSE      "/close"
+#define OSC_SESSION_BLEND      "/blend"
 
 #define OSC_STREAM             "/peertopeer"
 #define OSC_MULTITOUCH         "/multitouch"
@@ -191,6 +192,11 @@ private:
     float input_values[INPUT_MAX];
     std::mutex input_access_;
 
+    // snapshot blending requested by OSC, applied in the main thread
+    std::map<uint64_t, float> blend_weights_;
+    bool blend_requested_;
+    std::mutex blend_access_;
+
     int   multitouch_active[INPUT_MULTITOUCH_COUNT];
     glm::vec2 multitouch_values[INPUT_MULTITOUCH_COUNT];
 
@@ -264,6 +264,10 @@ Handles::Handles(Type type) : Node(), type_(type)
         handle_ = handle_corner;
     }
 
+    // handles are around the corners, with icons of constant size
+    picking_bounds_.extend( glm::vec3(-1.f, -1.f, 0.f) );
+    picking_bounds_.extend( glm::vec3( 1.f,  1.f, 0.f) );
+    picking_margin_ = HANDLES_PICKING_MARGIN;
 }
 
 Handles::~Handles()
@@ -304,22 +308,18 @@ void Handles::draw(glm::mat4 modelview, glm::mat4 projection)
 
         if ( type_ == Handles::RESIZE ) {
 
-            // 4 corners
+            // 4 corners, in one draw call
+            std::vector<glm::mat4> &corners = instances_;
+            corners.clear();
             vec = modelview * glm::vec4(1.f, -1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            corners.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(1.f, 1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            corners.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(-1.f, -1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            corners.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(-1.f, 1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
+            corners.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
+            handle_->drawInstances( corners, projection );
 
             if ( glm::length(corner_) > 0.f ) {
                 vec = modelview * glm::vec4(corner_.x, corner_.y, 0.f, 1.f);
@@ -328,14 +328,14 @@ void Handles::draw(glm::mat4 modelview, glm::mat4 projection)
             }
         }
         else if ( type_ == Handles::RESIZE_H ){
-            // left and right
+            // left and right, in one draw call
+            std::vector<glm::mat4> &sides = instances_;
+            sides.clear();
             vec = modelview * glm::vec4(1.f, 0.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(-1.f, 0.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
+            handle_->drawInstances( sides, projection );
 
             if ( glm::length(corner_) > 0.f ) {
                 vec = modelview * glm::vec4(corner_.x, corner_.y, 0.f, 1.f);
@@ -344,14 +344,14 @@ void Handles::draw(glm::mat4 modelview, glm::mat4 projection)
             }
         }
         else if ( type_ == Handles::RESIZE_V ){
-            // top and bottom
+            // top and bottom, in one draw call
+            std::vector<glm::mat4> &sides = instances_;
+            sides.clear();
             vec = modelview * glm::vec4(0.f, 1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(0.f, -1.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
+            handle_->drawInstances( sides, projection );
 
             if ( glm::length(corner_) > 0.f ) {
                 vec = modelview * glm::vec4(corner_.x, corner_.y, 0.f, 1.f);
@@ -460,27 +460,27 @@ void Handles::draw(glm::mat4 modelview, glm::mat4 projection)
             handle_->draw( ctm, projection );
         }
         else if ( type_ == Handles::CROP_H ){
-            // left and right
+            // left and right, in one draw call
+            std::vector<glm::mat4> &sides = instances_;
+            sides.clear();
             vec = modelview * glm::vec4(1.f, 0.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
-
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
             vec = modelview * glm::vec4(-1.f, 0.f, 0.f, 1.f);
-            ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            handle_->draw( ctm, projection );
+            sides.push_back( GlmToolkit::transform(vec, rot, glm::vec3(1.f)) );
+            handle_->drawInstances( sides, projection );
 
         }
         else if ( type_ == Handles::CROP_V ){
-            // top and bottom
+            // top and bottom, in one draw call
+            std::vector<glm::mat4> &sides = instances_;
+            sides.clear();
             vec = modelview * glm::vec4(0.f, 1.f, 0.f, 1.f);
             ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            ctm = glm::rotate(ctm, (float) M_PI_2, glm::vec3(0.f, 0.f, 1.f));
-            handle_->draw( ctm, projection );
-
+            sides.push_back( glm::rotate(ctm, (float) M_PI_2, glm::vec3(0.f, 0.f, 1.f)) );
             vec = modelview * glm::vec4(0.f, -1.f, 0.f, 1.f);
             ctm = GlmToolkit::transform(vec, rot, glm::vec3(1.f));
-            ctm = glm::rotate(ctm, (float) M_PI_2, glm::vec3(0.f, 0.f, 1.f));
-            handle_->draw( ctm, projection );
+            sides.push_back( glm::rotate(ctm, (float) M_PI_2, glm::vec3(0.f, 0.f, 1.f)) );
+            handle_->drawInstances( sides, projection );
         }
         else if ( type_ == Handles::ROUNDING ){
             // one icon in top right corner
@@ -592,6 +592,17 @@ Symbol::~Symbol()
 
 }
 
+void Symbol::update( float dt )
+{
+    Node::update(dt);
+
+    // symbol is interactive once its mesh is initialized
+    if ( picking_bounds_.isNull() && symbol_ && !symbol_->bbox().isNull() ) {
+        picking_bounds_ = symbol_->bbox();
+        picking_changed_ = true;
+    }
+}
+
 void Symbol::draw(glm::mat4 modelview, glm::mat4 projection)
 {
     if ( !initialized() ) {
@@ -646,6 +657,10 @@ Disk::Disk() : Node()
         Disk::disk_ = new Mesh("mesh/disk.ply");
 
     color = glm::vec4( 1.f, 1.f, 1.f, 1.f);
+
+    // disk is interactive
+    picking_bounds_.extend( glm::vec3(-1.f, -1.f, 0.f) );
+    picking_bounds_.extend( glm::vec3( 1.f,  1.f, 0.f) );
 }
 
 void Disk::draw(glm::mat4 modelview, glm::mat4 projection)
@@ -801,22 +816,25 @@ void DotLine::draw(glm::mat4 modelview, glm::mat4 projection)
         glm::mat4 R = glm::rotate(glm::identity<glm::mat4>(), angle, glm::vec3(0.f, 0.f, 1.f) );
         R *= glm::scale(glm::identity<glm::mat4>(), glm::vec3(1.0f, 1.5f, 1.f));
 
-        // draw start point
-        DotLine::dot_->draw( ctm, projection);
+        // draw start and target points
+        std::vector<glm::mat4> &dots = instances_;
+        dots.clear();
+        dots.push_back( ctm );
+        dots.push_back( modelview * glm::translate(glm::identity<glm::mat4>(), target) );
+        DotLine::dot_->drawInstances( dots, projection);
 
         // draw equally spaced intermediate points
         glm::vec3 inc = target;
         glm::vec3 space = spacing * glm::normalize(target);
 
+        std::vector<glm::mat4> &arrows = instances_;
+        arrows.clear();
         while ( glm::length(inc) > spacing ) {
             inc -= space;
             ctm *= glm::translate(glm::identity<glm::mat4>(), space);
-            DotLine::arrow_->draw( ctm * R, projection);
+            arrows.push_back( ctm * R );
         }
-
-        // draw target point
-        ctm = modelview * glm::translate(glm::identity<glm::mat4>(), target);
-        DotLine::dot_->draw( ctm, projection);
+        DotLine::arrow_->drawInstances( arrows, projection);
     }
 }
 
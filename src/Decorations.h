@@ -8,6 +8,9 @@
 #include "Primitives.h"
 #include "Mesh.h"
 
+// distance (in scene coordinates) of handles icons from the corners
+#define HANDLES_PICKING_MARGIN 0.3f
+
 class Frame : public Node
 {
 public:
@@ -74,6 +77,8 @@ protected:
     Mesh *shadow_;
     glm::vec2 corner_;
     Type type_;
+    // modelviews of instanced draw (kept to avoid allocation)
+    std::vector<glm::mat4> instances_;
 };
 
 class Symbol : public Node
@@ -119,6 +124,7 @@ public:
     Symbol(Type t, glm::vec3 pos = glm::vec3(0.f));
     ~Symbol();
 
+    void update (float dt) override;
     void draw (glm::mat4 modelview, glm::mat4 projection) override;
     void accept (Visitor& v) override;
 
@@ -187,6 +193,8 @@ public:
 protected:
     static Mesh *dot_;
     static Mesh *arrow_;
+    // modelviews of instanced draw (kept to avoid allocation)
+    std::vector<glm::mat4> instances_;
 };
 
 #endif // DECORATIONS_H
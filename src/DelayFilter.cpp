@@ -1,54 +1,379 @@
 
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "Log.h"
 #include "FrameBuffer.h"
 #include "Resource.h"
 #include "Primitives.h"
+#include "ImageShader.h"
+#include "RenderingManager.h"
 #include "Visitor.h"
 
 #include "DelayFilter.h"
 
 DelayFilter::DelayFilter(): FrameBufferFilter(),
-    temp_frame_(nullptr), now_(0.0), delay_(0.5)
+    array_(0), framebuffer_(0), size_(0), compact_(true), frame_bytes_(0), staging_layer_(-1), staged_(-1.0), allocated_delay_(0.0),
+    host_memory_(0), upload_pbo_(0), output_(nullptr), now_(0.0), delay_(0.5)
 {
-
+    store_shader_ = new HistoryShader(HistoryShader::STORE);
+    store_surface_ = new Surface(store_shader_);
+    restore_shader_ = new HistoryShader(HistoryShader::RESTORE);
+    restore_surface_ = new Surface(restore_shader_);
 }
 
 DelayFilter::~DelayFilter()
 {
-    // delete all frame buffers
-    while (!frames_.empty()) {
-        if (frames_.front() != nullptr)
-            delete frames_.front();
-        frames_.pop();
-    }
+    // delete all frames and storage
+    release();
 
-    while (!elapsed_.empty())
-        elapsed_.pop();
+    delete store_surface_;   // NB: deletes store_shader_
+    delete restore_surface_; // NB: deletes restore_shader_
 }
 
 void DelayFilter::reset ()
 {
-    // delete all frame buffers
+    // drop all frames (storage is kept)
     while (!frames_.empty()) {
-        if (frames_.front() != nullptr)
-            delete frames_.front();
-        frames_.pop();
+        drop(frames_.front());
+        frames_.pop_front();
     }
 
-    while (!elapsed_.empty())
-        elapsed_.pop();
-
     now_ = 0.0;
 }
 
 double DelayFilter::updateTime ()
 {
-    if (!elapsed_.empty())
-        return elapsed_.front();
+    if (!frames_.empty())
+        return frames_.front().elapsed;
 
     return 0.;
 }
 
+size_t DelayFilter::framesInGPU () const
+{
+    return std::count_if(frames_.begin(), frames_.end(), [](const Frame &f) { return f.layer > -1; });
+}
+
+size_t DelayFilter::framesInRAM () const
+{
+    return frames_.size() - framesInGPU();
+}
+
+void DelayFilter::allocate (float dt, double delay)
+{
+    // same input: grow the storage and keep the frames
+    bool grow = array_ != 0 && size_ == glm::ivec2(input_->width(), input_->height())
+            && compact_ == !(input_->flags() & FrameBuffer::FrameBuffer_alpha);
+
+    if (!grow) {
+        release();
+
+        // compact storage of opaque images: 2 bytes per pixel
+        size_ = glm::ivec2(input_->width(), input_->height());
+        compact_ = !(input_->flags() & FrameBuffer::FrameBuffer_alpha);
+        frame_bytes_ = size_.x * size_.y * (compact_ ? 2 : 4);
+    }
+
+    // number of layers needed for the delay (with margin and staging layer)
+    int needed = (int) ( delay / (double(MAX(dt, 1.f)) * 0.001) ) + 3;
+
+    // but not more than what the graphics card can afford (keeping 2/3 free)
+    int layers = needed;
+    glm::ivec2 RAM = Rendering::getGPUMemoryInformation();
+    if (RAM.x < INT_MAX)
+        layers = MIN( layers, (RAM.x / 3) / MAX(1, (int) frame_bytes_ / 1024) );
+    GLint max_layers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    layers = CLAMP( layers, 3, max_layers);
+
+    // growing needs at least one more layer
+    int minimum = grow ? staging_layer_ + 2 : 3;
+    if (layers < minimum) {
+        allocated_delay_ = DBL_MAX;
+        return;
+    }
+
+    // array texture of frames, with less layers while the graphics card is out of memory
+    uint array = 0;
+    while (glGetError() != GL_NO_ERROR);
+    for (;;) {
+        glGenTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, compact_ ? GL_RG8 : GL_RGBA8, size_.x, size_.y, layers);
+        if ( glGetError() != GL_OUT_OF_MEMORY )
+            break;
+        if ( layers <= minimum ) {
+            Log::Warning("Delay filter: not enough memory in graphics card.");
+            // keep previous storage when growing
+            if (grow) {
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+                glDeleteTextures(1, &array);
+                allocated_delay_ = DBL_MAX;
+                return;
+            }
+            break;
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glDeleteTextures(1, &array);
+        layers = MAX( layers / 2, minimum);
+    }
+
+    // longer delays spill to RAM if the graphics card cannot hold more
+    allocated_delay_ = layers < needed ? DBL_MAX : delay;
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (grow) {
+        // copy the frames stored in graphics card into the same layers of the new array
+        uint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        for (auto f = frames_.begin(); f != frames_.end(); ++f) {
+            if (f->layer < 0)
+                continue;
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array_, 0, f->layer);
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array, 0, f->layer);
+            glBlitFramebuffer(0, 0, size_.x, size_.y, 0, 0, size_.x, size_.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &array_);
+        array_ = array;
+        restore_shader_->history_texture = array_;
+
+        // former staging layer and new layers are free
+        for (int l = layers - 2; l >= staging_layer_; --l)
+            free_layers_.push_back(l);
+        staging_layer_ = layers - 1;
+        staged_ = -1.0;
+
+#ifndef NDEBUG
+        Log::Info("Delay filter stores up to %d frames (%d x %d) in graphics card.", staging_layer_, size_.x, size_.y);
+#endif
+        return;
+    }
+
+    array_ = array;
+    glGenFramebuffers(1, &framebuffer_);
+
+    // last layer is used to upload frames from RAM
+    staging_layer_ = layers - 1;
+    staged_ = -1.0;
+    for (int l = staging_layer_ - 1; l > -1; --l)
+        free_layers_.push_back(l);
+
+    // pixel buffer objects for transfers to and from RAM
+    downloads_.resize(DELAY_TRANSFER_BUFFERS);
+    for (auto t = downloads_.begin(); t != downloads_.end(); ++t) {
+        glGenBuffers(1, &t->pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, t->pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_bytes_, NULL, GL_STREAM_READ);
+        t->fence = nullptr;
+        t->host = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glGenBuffers(1, &upload_pbo_);
+
+    // frame buffer of the restored frame
+    output_ = new FrameBuffer( input_->resolution(), input_->flags() & FrameBuffer::FrameBuffer_alpha );
+
+    store_shader_->compact = compact_;
+    restore_shader_->compact = compact_;
+    restore_shader_->history_texture = array_;
+
+#ifndef NDEBUG
+    Log::Info("Delay filter stores up to %d frames (%d x %d) in graphics card.", staging_layer_, size_.x, size_.y);
+#endif
+}
+
+void DelayFilter::release ()
+{
+    // drop all frames
+    while (!frames_.empty()) {
+        drop(frames_.front());
+        frames_.pop_front();
+    }
+
+    // free RAM
+    for (auto h = host_pool_.begin(); h != host_pool_.end(); ++h)
+        free(*h);
+    host_pool_.clear();
+    host_memory_ = 0;
+
+    // free graphics card
+    for (auto t = downloads_.begin(); t != downloads_.end(); ++t) {
+        if (t->fence)
+            glDeleteSync(t->fence);
+        glDeleteBuffers(1, &t->pbo);
+    }
+    downloads_.clear();
+    if (upload_pbo_)
+        glDeleteBuffers(1, &upload_pbo_);
+    if (framebuffer_)
+        glDeleteFramebuffers(1, &framebuffer_);
+    if (array_)
+        glDeleteTextures(1, &array_);
+    if (output_)
+        delete output_;
+    upload_pbo_ = 0;
+    framebuffer_ = 0;
+    array_ = 0;
+    output_ = nullptr;
+    free_layers_.clear();
+    staging_layer_ = -1;
+    allocated_delay_ = 0.0;
+}
+
+void DelayFilter::drop (Frame &f)
+{
+    // layer can be reused
+    if (f.layer > -1)
+        free_layers_.push_back(f.layer);
+
+    // cancel pending download
+    if (f.transfer > -1) {
+        glDeleteSync(downloads_[f.transfer].fence);
+        downloads_[f.transfer].fence = nullptr;
+        downloads_[f.transfer].host = nullptr;
+    }
+
+    // RAM can be reused
+    if (f.host != nullptr)
+        host_pool_.push_back(f.host);
+
+    f.layer = -1;
+    f.transfer = -1;
+    f.host = nullptr;
+}
+
+bool DelayFilter::spill ()
+{
+    // the oldest frame in graphics card goes to RAM
+    auto f = std::find_if(frames_.begin(), frames_.end(), [](const Frame &f) { return f.layer > -1; });
+    if (f == frames_.end())
+        return false;
+
+    // get a free transfer buffer (waiting for pending downloads if none)
+    auto t = std::find_if(downloads_.begin(), downloads_.end(), [](const Transfer &t) { return t.fence == nullptr; });
+    if (t == downloads_.end()) {
+        collect(true);
+        t = std::find_if(downloads_.begin(), downloads_.end(), [](const Transfer &t) { return t.fence == nullptr; });
+        if (t == downloads_.end())
+            return false;
+    }
+
+    // get RAM for the frame
+    unsigned char *host = nullptr;
+    if (!host_pool_.empty()) {
+        host = host_pool_.back();
+        host_pool_.pop_back();
+    }
+    else if (host_memory_ + frame_bytes_ <= MAX_DELAY_HOST_MEMORY) {
+        host = (unsigned char *) malloc(frame_bytes_);
+        if (host != nullptr)
+            host_memory_ += frame_bytes_;
+    }
+    if (host == nullptr)
+        return false;
+
+    // asynchronous download of the layer into the transfer buffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array_, 0, f->layer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, t->pbo);
+    glReadPixels(0, 0, size_.x, size_.y, compact_ ? GL_RG : GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    t->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    t->host = host;
+
+    // layer can be reused right away (read is done before later rendering)
+    free_layers_.push_back(f->layer);
+    f->layer = -1;
+    f->host = host;
+    f->transfer = t - downloads_.begin();
+
+    return true;
+}
+
+void DelayFilter::collect (bool wait)
+{
+    for (auto t = downloads_.begin(); t != downloads_.end(); ++t) {
+
+        if (t->fence == nullptr)
+            continue;
+
+        // test if download is done (or wait up to a second)
+        GLenum status = glClientWaitSync(t->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+        if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+            continue;
+        glDeleteSync(t->fence);
+        t->fence = nullptr;
+
+        // copy pixels to RAM
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, t->pbo);
+        unsigned char* ptr = (unsigned char*) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (NULL != ptr)
+            memcpy(t->host, ptr, frame_bytes_);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        t->host = nullptr;
+
+        // frame is now complete in RAM
+        int index = t - downloads_.begin();
+        for (auto f = frames_.begin(); f != frames_.end(); ++f) {
+            if (f->transfer == index) {
+                f->transfer = -1;
+                break;
+            }
+        }
+    }
+}
+
+int DelayFilter::stage (Frame &f)
+{
+    // upload frame from RAM into staging layer (once)
+    if (staged_ != f.elapsed) {
+
+        // frame must be completely in RAM
+        if (f.transfer > -1)
+            collect(true);
+
+        // write pixels into the upload buffer
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_pbo_);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_bytes_, NULL, GL_STREAM_DRAW);
+        unsigned char* ptr = (unsigned char*) glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (NULL != ptr)
+            memcpy(ptr, f.host, frame_bytes_);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // asynchronous upload of the buffer into the layer
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, staging_layer_, size_.x, size_.y, 1,
+                        compact_ ? GL_RG : GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        staged_ = f.elapsed;
+    }
+
+    return staging_layer_;
+}
+
 void DelayFilter::update (float dt)
 {
     if (input_) {
@@ -56,42 +381,43 @@ void DelayFilter::update (float dt)
         // What time is it?
         now_ += double(dt) * 0.001;
 
-        // if temporary FBO was pending to be deleted, delete it now
-        if (temp_frame_ != nullptr) {
-            delete temp_frame_;
-            temp_frame_ = nullptr;
-        }
+        // (re)allocate storage for the input
+        if ( array_ == 0 || size_.x != (int) input_->width() || size_.y != (int) input_->height() ||
+             compact_ == bool(input_->flags() & FrameBuffer::FrameBuffer_alpha) )
+            allocate(dt, delay_);
+        // grow storage for a longer delay (with margin to grow further)
+        else if ( delay_ > allocated_delay_ )
+            allocate(dt, MAX( delay_, MIN(delay_ * 1.5, MAX_DELAY) ) );
+
+        // complete downloads of frames spilled to RAM
+        collect(false);
 
         // is the total buffer of images longer than delay ?
-        if ( !frames_.empty() && now_ - elapsed_.front() > delay_ )
+        if ( !frames_.empty() && now_ - frames_.front().elapsed > delay_ )
         {
-            // remember FBO to be reused if needed (see below) or deleted later
-            temp_frame_ = frames_.front();
-
             // remove element from queue (front)
-            frames_.pop();
-            elapsed_.pop();
+            drop(frames_.front());
+            frames_.pop_front();
         }
 
         // add image to queue to accumulate buffer images until delay reached (with margin)
-        if ( frames_.empty() || now_ - elapsed_.front() < delay_ + ( double(dt) * 0.002) )
+        if ( frames_.empty() || now_ - frames_.front().elapsed < delay_ + ( double(dt) * 0.002) )
         {
-            // create a FBO if none can be reused (from above) and test for RAM in GPU
-            if (temp_frame_ == nullptr && ( frames_.empty() || Rendering::shouldHaveEnoughMemory(input_->resolution(), input_->flags()) ) ){
-                temp_frame_ = new FrameBuffer( input_->resolution(), input_->flags() );
-            }
-            // image available
-            if (temp_frame_ != nullptr) {
+            // need a free layer: move the oldest frame from graphics card to RAM if none
+            if ( !free_layers_.empty() || spill() ) {
                 // add element to queue (back)
-                frames_.push( temp_frame_ );
-                elapsed_.push( now_ );
-                // temp_frame_ FBO is now used, it should not be deleted
-                temp_frame_ = nullptr;
+                Frame f;
+                f.elapsed = now_;
+                f.layer = free_layers_.back();
+                f.host = nullptr;
+                f.transfer = -1;
+                free_layers_.pop_back();
+                frames_.push_back(f);
             }
             else {
                 // set delay to maximum affordable
-                delay_ = now_ - elapsed_.front() - (dt * 0.001);
-                Log::Warning("Cannot satisfy delay: not enough RAM in graphics card.");
+                delay_ = frames_.empty() ? 0.0 : now_ - frames_.front().elapsed - (dt * 0.001);
+                Log::Warning("Cannot satisfy delay: not enough memory.");
             }
         }
     }
@@ -99,8 +425,8 @@ void DelayFilter::update (float dt)
 
 uint DelayFilter::texture () const
 {
-    if (!frames_.empty())
-        return frames_.front()->texture();
+    if (!frames_.empty() && output_)
+        return output_->texture();
     else if (input_)
         return input_->texture();
     else
@@ -122,9 +448,29 @@ void DelayFilter::draw (FrameBuffer *input)
     if ( enabled() )
     {
         // make sure the queue is not empty
-        if ( input_ && !frames_.empty() ) {
-            // blit input framebuffer in the newest image in queue (back)
-            input_->blit( frames_.back() );
+        if ( input_ && !frames_.empty() && array_ ) {
+
+            // store input framebuffer in the newest image in queue (back)
+            RenderingAttrib attrib;
+            attrib.viewport = size_;
+            attrib.clear_color = glm::vec4(0.f);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array_, 0, frames_.back().layer);
+            Rendering::manager().pushAttrib(attrib);
+            store_surface_->setTextureIndex( input_->texture() );
+            store_surface_->draw(glm::identity<glm::mat4>(), output_->projection());
+            Rendering::manager().popAttrib();
+            FrameBuffer::release();
+
+            // restore the oldest image in queue (front) from graphics card or RAM
+            Frame &f = frames_.front();
+            restore_shader_->layer = f.layer > -1 ? f.layer : stage(f);
+            output_->begin(false);
+            restore_surface_->draw(glm::identity<glm::mat4>(), output_->projection());
+            output_->end();
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            glActiveTexture(GL_TEXTURE0);
         }
     }
 }
@@ -134,4 +480,3 @@ void DelayFilter::accept (Visitor& v)
     FrameBufferFilter::accept(v);
     v.visit(*this);
 }
-
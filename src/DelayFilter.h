@@ -1,13 +1,20 @@
 #ifndef DELAYFILTER_H
 #define DELAYFILTER_H
 
-#include <queue>
+#include <deque>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "FrameBufferFilter.h"
 
+#define MAX_DELAY 10.0
+#define MAX_DELAY_HOST_MEMORY 2147483648  // 2 GB of frames spilled in RAM
+#define DELAY_TRANSFER_BUFFERS 4
+
 class Surface;
 class FrameBuffer;
+class HistoryShader;
+struct __GLsync;
 
 class DelayFilter : public FrameBufferFilter
 {
@@ -29,13 +36,57 @@ public:
     void draw   (FrameBuffer *input) override;
     void accept (Visitor& v) override;
 
+    // number of frames stored in graphics card and in RAM
+    size_t framesInGPU () const;
+    size_t framesInRAM () const;
+
 private:
-    // queue of frames
-    std::queue<FrameBuffer *> frames_;
-    std::queue<double> elapsed_;
+    // queue of frames, from oldest (front) to newest (back)
+    // frames spilled to RAM are always the oldest
+    struct Frame {
+        double elapsed;
+        int layer;              // layer in array texture, -1 if in RAM
+        unsigned char *host;    // copy in RAM
+        int transfer;           // pending download, -1 if none
+    };
+    std::deque<Frame> frames_;
+    void drop (Frame &f);
+
+    // frames are stored in the layers of an array texture
+    uint array_;
+    uint framebuffer_;
+    glm::ivec2 size_;
+    bool compact_;
+    uint frame_bytes_;
+    std::vector<int> free_layers_;
+    int staging_layer_;
+    double staged_;
+    double allocated_delay_;
+    void allocate (float dt, double delay);
+    void release ();
+
+    // frames spilled in RAM when graphics card is full
+    std::vector<unsigned char *> host_pool_;
+    unsigned long host_memory_;
+
+    // asynchronous transfers with pixel buffer objects
+    struct Transfer {
+        uint pbo;
+        struct __GLsync *fence;
+        unsigned char *host;
+    };
+    std::vector<Transfer> downloads_;
+    uint upload_pbo_;
+    bool spill ();
+    void collect (bool wait);
+    int  stage (Frame &f);
 
     // render management
-    FrameBuffer *temp_frame_;
+    Surface *store_surface_;
+    HistoryShader *store_shader_;
+    Surface *restore_surface_;
+    HistoryShader *restore_shader_;
+    FrameBuffer *output_;
 
     // time management
     double now_;
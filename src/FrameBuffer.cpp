@@ -34,9 +34,16 @@
 #define FRAMEBUFFER_DEBUG
 #endif
 
+#define FRAMEBUFFER_POOL_FRAMES 120
+
 unsigned long FrameBuffer::total_mem_usage = 0;
-unsigned long FrameBuffer::memory_usage()
+unsigned long FrameBuffer::memory_usage(unsigned long *pooled, unsigned long *pooled_peak)
 {
+    if (pooled)
+        *pooled = FrameBufferPool::memory_usage();
+    if (pooled_peak)
+        *pooled_peak = FrameBufferPool::peak_memory_usage();
+
     return total_mem_usage;
 }
 
@@ -589,3 +596,86 @@ bool FrameBuffer::fill(FrameBufferImage *image)
 //    // delete (copy is also deleted)
 //    delete[] buffer;
 //}
+
+
+std::vector<FrameBufferPool::Entry> FrameBufferPool::entries_;
+unsigned long FrameBufferPool::frame_ = 0;
+unsigned long FrameBufferPool::mem_usage_ = 0;
+unsigned long FrameBufferPool::peak_mem_usage_ = 0;
+
+FrameBuffer *FrameBufferPool::acquire(glm::vec3 resolution, FrameBuffer::FrameBufferFlags flags)
+{
+    glm::ivec2 res = glm::ivec2(resolution);
+
+    // reuse an available buffer with same resolution and flags
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if ( !it->used && it->resolution == res && it->flags == flags ) {
+            it->used = true;
+            it->last_frame = frame_;
+            return it->buffer;
+        }
+    }
+
+    // create a new buffer otherwise
+    Entry e;
+    e.buffer = new FrameBuffer(resolution, flags);
+    e.resolution = res;
+    e.flags = flags;
+    e.used = true;
+    e.last_frame = frame_;
+    entries_.push_back(e);
+
+    return e.buffer;
+}
+
+void FrameBufferPool::release(FrameBuffer *fb)
+{
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if ( it->buffer == fb ) {
+            it->used = false;
+            it->last_frame = frame_;
+            break;
+        }
+    }
+
+    // NB: buffer is allocated on first use
+    update_memory_usage();
+}
+
+void FrameBufferPool::newFrame()
+{
+    ++frame_;
+
+    // delete buffers not used for some frames
+    size_t count = entries_.size();
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+        if ( !it->used && frame_ - it->last_frame > FRAMEBUFFER_POOL_FRAMES ) {
+            delete it->buffer;
+            it = entries_.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (count != entries_.size())
+        update_memory_usage();
+}
+
+void FrameBufferPool::update_memory_usage()
+{
+    mem_usage_ = 0;
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+        mem_usage_ += it->buffer->mem_usage_;
+
+    peak_mem_usage_ = MAX(peak_mem_usage_, mem_usage_);
+}
+
+unsigned long FrameBufferPool::memory_usage()
+{
+    return mem_usage_;
+}
+
+unsigned long FrameBufferPool::peak_memory_usage()
+{
+    return peak_mem_usage_;
+}
@@ -1,6 +1,8 @@
 #ifndef FRAMEBUFFER_H
 #define FRAMEBUFFER_H
 
+#include <vector>
+
 #include "RenderingManager.h"
 
 #define FBI_JPEG_QUALITY 90
@@ -96,7 +98,8 @@ public:
     bool fill(FrameBufferImage *image);
 
     // how much memory used, in Bytes
-    static unsigned long memory_usage();
+    // (optionally, memory used by pool of scratch buffers, current and peak)
+    static unsigned long memory_usage(unsigned long *pooled = nullptr, unsigned long *pooled_peak = nullptr);
 
 private:
     void init();
@@ -111,6 +114,43 @@ private:
     uint framebufferid_, multisampling_framebufferid_;
     unsigned long mem_usage_;
     static unsigned long total_mem_usage;
+
+    friend class FrameBufferPool;
+};
+
+/**
+ * @brief The FrameBufferPool class lends scratch FrameBuffers
+ * for intermediate render passes (e.g. first pass of filters).
+ * A buffer is given back after the pass, and reused by the next one
+ * needing the same resolution and flags; unused buffers are deleted
+ * after a few frames.
+ */
+class FrameBufferPool {
+
+public:
+    static FrameBuffer *acquire(glm::vec3 resolution, FrameBuffer::FrameBufferFlags flags = FrameBuffer::FrameBuffer_rgb);
+    static void release(FrameBuffer *fb);
+
+    // count frames and delete unused buffers
+    static void newFrame();
+
+    // how much memory used, in Bytes
+    static unsigned long memory_usage();
+    static unsigned long peak_memory_usage();
+
+private:
+    struct Entry {
+        FrameBuffer *buffer;
+        glm::ivec2 resolution;
+        FrameBuffer::FrameBufferFlags flags;
+        bool used;
+        unsigned long last_frame;
+    };
+    static std::vector<Entry> entries_;
+    static unsigned long frame_;
+    static unsigned long mem_usage_;
+    static unsigned long peak_mem_usage_;
+    static void update_memory_usage();
 };
 
 
@@ -19,6 +19,21 @@
 
 #include <algorithm>
 
+// memory-mapped files
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <linux/falloc.h>
+#elif defined(__APPLE__)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+
 //  Desktop OpenGL function loader
 #include <glad/glad.h>
 
@@ -26,20 +41,24 @@
 #include <gst/gstformat.h>
 #include <gst/video/video.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "Log.h"
 #include "GstToolkit.h"
 #include "BaseToolkit.h"
 #include "FrameBuffer.h"
+#include "Primitives.h"
+#include "ImageShader.h"
+#include "Settings.h"
 
 #include "FrameGrabber.h"
 
 
 
-FrameGrabbing::FrameGrabbing(): pbo_index_(0), pbo_next_index_(0), size_(0),
-    width_(0), height_(0), use_alpha_(0), caps_(NULL)
+FrameGrabbing::FrameGrabbing(): size_(0), width_(0), height_(0), use_alpha_(0), format_(GST_VIDEO_FORMAT_UNKNOWN),
+    caps_(NULL), pool_(NULL), conversion_buffer_(nullptr), conversion_surface_(nullptr), conversion_shader_(nullptr),
+    readback_write_(0), readback_read_(0), readback_pending_(0), collecting_(false), latency_(0.0), dropped_(0)
 {
-    pbo_[0] = 0;
-    pbo_[1] = 0;
 }
 
 FrameGrabbing::~FrameGrabbing()
@@ -50,8 +69,13 @@ FrameGrabbing::~FrameGrabbing()
     // cleanup
     if (caps_)
         gst_caps_unref (caps_);
-//    if (pbo_[0] > 0) // automatically deleted at shutdown
-//        glDeleteBuffers(2, pbo_);
+    if (pool_) {
+        gst_buffer_pool_set_active (pool_, FALSE);
+        gst_object_unref (pool_);
+    }
+    discardConversion();
+//    for (auto r = readback_.begin(); r != readback_.end(); ++r) // automatically deleted at shutdown
+//        glDeleteBuffers(1, &r->pbo);
 }
 
 void FrameGrabbing::add(FrameGrabber *rec)
@@ -115,6 +139,9 @@ void FrameGrabbing::stopAll()
 
 void FrameGrabbing::clearAll()
 {
+    // no more frames are grabbed
+    thread_ = std::thread::id();
+
     std::list<FrameGrabber *>::iterator iter;
     for (iter=grabbers_.begin(); iter != grabbers_.end(); )
     {
@@ -130,71 +157,212 @@ void FrameGrabbing::clearAll()
 }
 
 
+void FrameGrabbing::discardReadback()
+{
+    // forget about pending readbacks
+    for (auto r = readback_.begin(); r != readback_.end(); ++r) {
+        if (r->fence)
+            glDeleteSync(r->fence);
+        r->fence = nullptr;
+    }
+    readback_write_ = 0;
+    readback_read_ = 0;
+    readback_pending_ = 0;
+}
+
+void FrameGrabbing::discardConversion()
+{
+    if (conversion_surface_)
+        delete conversion_surface_; // NB: deletes conversion_shader_
+    if (conversion_buffer_)
+        delete conversion_buffer_;
+    conversion_surface_ = nullptr;
+    conversion_shader_ = nullptr;
+    conversion_buffer_ = nullptr;
+}
+
 void FrameGrabbing::grabFrame(FrameBuffer *frame_buffer)
 {
     if (frame_buffer == nullptr)
         return;
 
+    // number of frames in the readback ring
+    guint depth = CLAMP(Settings::application.record.readback_depth, MIN_READBACK_DEPTH, MAX_READBACK_DEPTH);
+
+    // format of frames given to grabbers: YUV conversion on GPU if enabled
+    // (alpha channel is preserved by keeping RGBA frames)
+    GstVideoFormat format = (frame_buffer->flags() & FrameBuffer::FrameBuffer_alpha) ? GST_VIDEO_FORMAT_RGBA : GST_VIDEO_FORMAT_RGB;
+    if ( format == GST_VIDEO_FORMAT_RGB && Settings::application.record.conversion_mode == 1 )
+        format = GST_VIDEO_FORMAT_I420;
+    else if ( format == GST_VIDEO_FORMAT_RGB && Settings::application.record.conversion_mode == 2 )
+        format = GST_VIDEO_FORMAT_NV12;
+    // (change of conversion is not applied while capturing)
+    if ( !grabbers_.empty() && format != GST_VIDEO_FORMAT_RGBA &&
+         format_ != GST_VIDEO_FORMAT_RGBA && format_ != GST_VIDEO_FORMAT_UNKNOWN )
+        format = format_;
+
     // if different frame buffer from previous frame
     if ( frame_buffer->width() != width_ ||
          frame_buffer->height() != height_ ||
-         (frame_buffer->flags() & FrameBuffer::FrameBuffer_alpha) != use_alpha_) {
+         (frame_buffer->flags() & FrameBuffer::FrameBuffer_alpha) != use_alpha_ ||
+         format != format_ ||
+         readback_.size() != depth) {
 
         // define stream properties
         width_ = frame_buffer->width();
         height_ = frame_buffer->height();
         use_alpha_ = (frame_buffer->flags() & FrameBuffer::FrameBuffer_alpha);
-        size_ = width_ * height_ * (use_alpha_ ? 4 : 3);
-
-        // first time initialization
-        if ( pbo_[0] == 0 )
-            glGenBuffers(2, pbo_);
-
-        // re-affect pixel buffer object
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[1]);
-        glBufferData(GL_PIXEL_PACK_BUFFER, size_, NULL, GL_STREAM_READ);
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[0]);
-        glBufferData(GL_PIXEL_PACK_BUFFER, size_, NULL, GL_STREAM_READ);
+        format_ = format;
+
+        // layout of frames in memory
+        GstVideoInfo info;
+        gst_video_info_set_format(&info, format_, width_, height_);
+        size_ = GST_VIDEO_INFO_IS_YUV(&info) ? GST_VIDEO_INFO_SIZE(&info) : width_ * height_ * (use_alpha_ ? 4 : 3);
+        guint readback_size = size_;
+
+        // setup conversion pass to render YUV planes in an RGBA frame buffer
+        discardConversion();
+        if ( GST_VIDEO_INFO_IS_YUV(&info) ) {
+            // each RGBA pixel packs 4 bytes, rows of the luma plane stride
+            guint w = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0) / 4;
+            guint h = (size_ + 4 * w - 1) / (4 * w);
+            readback_size = w * h * 4;
+            conversion_buffer_ = new FrameBuffer(w, h, FrameBuffer::FrameBuffer_alpha);
+
+            // shader computing each byte of the YUV planes
+            conversion_shader_ = new YUVPackShader;
+            conversion_shader_->format = format_ == GST_VIDEO_FORMAT_NV12 ? YUVShader::NV12 : YUVShader::I420;
+            conversion_shader_->frameSize = glm::vec2(width_, height_);
+            conversion_shader_->plane_offset[0] = GST_VIDEO_INFO_PLANE_OFFSET(&info, 1);
+            conversion_shader_->plane_offset[1] = GST_VIDEO_INFO_N_PLANES(&info) > 2 ? GST_VIDEO_INFO_PLANE_OFFSET(&info, 2) : size_;
+            conversion_shader_->plane_stride[0] = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+            conversion_shader_->plane_stride[1] = GST_VIDEO_INFO_PLANE_STRIDE(&info, 1);
+
+            // same colorimetry as announced in caps
+            gdouble Kr = 0.299, Kb = 0.114;
+            gst_video_color_matrix_get_Kr_Kb(info.colorimetry.matrix, &Kr, &Kb);
+            conversion_shader_->setColorimetry( (float) Kr, (float) Kb, info.colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255);
+
+            conversion_surface_ = new Surface(conversion_shader_);
+        }
 
-        // reset indices
-        pbo_index_ = 0;
-        pbo_next_index_ = 0;
+        // reset ring of pixel buffer objects
+        discardReadback();
+        for (auto r = readback_.begin(); r != readback_.end(); ++r)
+            glDeleteBuffers(1, &r->pbo);
+        readback_.resize(depth);
+        for (auto r = readback_.begin(); r != readback_.end(); ++r) {
+            glGenBuffers(1, &r->pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, r->pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, readback_size, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
         // new caps
         if (caps_)
             gst_caps_unref (caps_);
         caps_ = gst_caps_new_simple ("video/x-raw",
-                                     "format", G_TYPE_STRING, use_alpha_ ? "RGBA" : "RGB",
+                                     "format", G_TYPE_STRING, gst_video_format_to_string(format_),
                                      "width",  G_TYPE_INT, width_,
                                      "height", G_TYPE_INT, height_,
                                      NULL);
+        if ( GST_VIDEO_INFO_IS_YUV(&info) ) {
+            gchar *colorimetry = gst_video_colorimetry_to_string(&info.colorimetry);
+            gst_caps_set_simple (caps_, "colorimetry", G_TYPE_STRING, colorimetry, NULL);
+            g_free(colorimetry);
+        }
+
+        // new pool of buffers (released buffers return to the pool)
+        if (pool_) {
+            gst_buffer_pool_set_active (pool_, FALSE);
+            gst_object_unref (pool_);
+        }
+        pool_ = gst_buffer_pool_new ();
+        GstStructure *config = gst_buffer_pool_get_config (pool_);
+        gst_buffer_pool_config_set_params (config, caps_, size_, depth, 0);
+        if ( !gst_buffer_pool_set_config (pool_, config) || !gst_buffer_pool_set_active (pool_, TRUE) ) {
+            Log::Warning("Frame capture : Could not allocate buffer pool.");
+            gst_object_unref (pool_);
+            pool_ = NULL;
+        }
+
+        // reset statistics
+        latency_ = 0.0;
+        dropped_ = 0;
+    }
+
+    // nothing to do without frame grabbers
+    if (grabbers_.empty() || size_ < 1 || pool_ == NULL) {
+        discardReadback();
+        return;
     }
 
-    // fill a frame in buffer
-    if (!grabbers_.empty() && size_ > 0) {
+    // frames are grabbed in this thread (for flush)
+    thread_ = std::this_thread::get_id();
 
-        GstBuffer *buffer = nullptr;
+    // collect the frames for which the GPU has finished the readback
+    // (in order, without blocking)
+    collect(false);
+
+    // issue a new readback if a pixel buffer object is available
+    if (readback_pending_ < readback_.size()) {
+
+        Readback &r = readback_[readback_write_];
+
+        // convert frame into YUV planes
+        if (conversion_buffer_) {
+            conversion_surface_->setTextureIndex( frame_buffer->texture() );
+            conversion_buffer_->begin(false);
+            conversion_surface_->draw(glm::identity<glm::mat4>(), conversion_buffer_->projection());
+            conversion_buffer_->end();
+        }
 
         // set buffer target for writing in a new frame
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[pbo_index_]);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
 
-#ifdef USE_GLREADPIXEL
-        // get frame
-        frame_buffer->readPixels();
-#else
-        glBindTexture(GL_TEXTURE_2D, frame_buffer->texture());
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-#endif
+        // get frame (read pixels into pbo is the fastest)
+        if (conversion_buffer_)
+            conversion_buffer_->readPixels();
+        else
+            frame_buffer->readPixels();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // fence to know when the readback is done
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        r.issued = g_get_monotonic_time();
+
+        // next in ring
+        readback_write_ = (readback_write_ + 1) % readback_.size();
+        ++readback_pending_;
+    }
+    // all pixel buffer objects are still in use: skip this frame
+    else
+        ++dropped_;
+
+}
+
+void FrameGrabbing::collect(bool wait)
+{
+    // NB: grabbers stopping while given a frame do not collect again
+    collecting_ = true;
+
+    while (readback_pending_ > 0) {
 
-        // update case ; alternating indices
-        if ( pbo_next_index_ != pbo_index_ ) {
+        Readback &r = readback_[readback_read_];
 
-            // set buffer target for saving the frame
-            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[pbo_next_index_]);
+        // test if fence was signaled (or wait for it)
+        GLenum status = glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? READBACK_FLUSH_TIMEOUT : 0);
+        if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+            break;
+        glDeleteSync(r.fence);
+        r.fence = nullptr;
 
-            // new buffer
-            buffer = gst_buffer_new_and_alloc (size_);
+        // new buffer from the pool
+        GstBuffer *buffer = nullptr;
+        if ( gst_buffer_pool_acquire_buffer (pool_, &buffer, NULL) == GST_FLOW_OK ) {
+
+            // set buffer target for reading the frame
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
 
             // map gst buffer into a memory  WRITE target
             GstMapInfo map;
@@ -205,74 +373,257 @@ void FrameGrabbing::grabFrame(FrameBuffer *frame_buffer)
 
             // transfer pixels from PBO memory to buffer memory
             if (NULL != ptr)
-                memmove(map.data, ptr, size_);
+                memcpy(map.data, ptr, size_);
 
             // un-map
             glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
             gst_buffer_unmap (buffer, &map);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
         }
 
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        // latency of readback (moving average, in milliseconds)
+        double dt = (double) (g_get_monotonic_time() - r.issued) / 1000.0;
+        latency_ = latency_ > 0.0 ? 0.9 * latency_ + 0.1 * dt : dt;
 
-        // alternate indices
-        pbo_next_index_ = pbo_index_;
-        pbo_index_ = (pbo_index_ + 1) % 2;
+        // next in ring
+        readback_read_ = (readback_read_ + 1) % readback_.size();
+        --readback_pending_;
 
         // a frame was successfully grabbed
-        if ( buffer != nullptr && gst_buffer_get_size(buffer) > 0) {
-
-            // give the frame to all recorders
-            std::list<FrameGrabber *>::iterator iter = grabbers_.begin();
-            while (iter != grabbers_.end())
-            {
-                FrameGrabber *rec = *iter;
-                rec->addFrame(buffer, caps_);
-
-                // remove finished recorders
-                if (rec->finished()) {
-                    iter = grabbers_.erase(iter);
-                    delete rec;
-                }
-                else
-                    ++iter;
-            }
+        if ( buffer != nullptr ) {
+            // give the frame to all recorders (without copy)
+            sendFrame(buffer);
+            // release the frame (returns to the pool when all recorders are done)
+            gst_buffer_unref(buffer);
+        }
+    }
 
-            // manage the list of chainned recorder
-            std::map<FrameGrabber *, FrameGrabber *>::iterator chain = grabbers_chain_.begin();
-            while (chain != grabbers_chain_.end())
-            {
-                // update frame grabber of chain list
-                chain->first->addFrame(buffer, caps_);
-
-                // if the chained recorder is now active
-                if (chain->first->active_ && chain->first->accept_buffer_){
-                    // add it to main grabbers,
-                    grabbers_.push_back(chain->first);
-                    // stop the replaced grabber
-                    chain->second->stop();
-                    // loop in chain list: done with this chain
-                    chain = grabbers_chain_.erase(chain);
-                }
-                else
-                    // loop in chain list
-                    ++chain;
-            }
+    collecting_ = false;
+}
 
-            // unref / free the frame
-            gst_buffer_unref(buffer);
+void FrameGrabbing::flush()
+{
+    if ( collecting_ || readback_pending_ < 1 || pool_ == NULL || std::this_thread::get_id() != thread_ )
+        return;
+
+    collect(true);
+}
+
+void FrameGrabbing::sendFrame(GstBuffer *buffer)
+{
+    // give the frame to all recorders
+    std::list<FrameGrabber *>::iterator iter = grabbers_.begin();
+    while (iter != grabbers_.end())
+    {
+        FrameGrabber *rec = *iter;
+        rec->addFrame(buffer, caps_);
+
+        // remove finished recorders
+        if (rec->finished()) {
+            iter = grabbers_.erase(iter);
+            delete rec;
         }
+        else
+            ++iter;
+    }
 
+    // manage the list of chainned recorder
+    std::map<FrameGrabber *, FrameGrabber *>::iterator chain = grabbers_chain_.begin();
+    while (chain != grabbers_chain_.end())
+    {
+        // update frame grabber of chain list
+        chain->first->addFrame(buffer, caps_);
+
+        // if the chained recorder is now active
+        if (chain->first->active_ && chain->first->accept_buffer_){
+            // add it to main grabbers,
+            grabbers_.push_back(chain->first);
+            // stop the replaced grabber
+            chain->second->stop();
+            // loop in chain list: done with this chain
+            chain = grabbers_chain_.erase(chain);
+        }
+        else
+            // loop in chain list
+            ++chain;
     }
+}
 
+
+
+FrameSpill::FrameSpill(const std::string &directory, guint64 capacity): directory_(directory),
+    capacity_(capacity), file_(-1), map_(nullptr), frame_size_(0), slot_size_(0), slots_(0),
+    reserved_(0), head_(0), count_(0), dropped_(0)
+{
 }
 
+FrameSpill::~FrameSpill()
+{
+    if (map_ != nullptr)
+        munmap(map_, slots_ * slot_size_);
+    if (file_ > -1)
+        close(file_);
+}
+
+// free space in the file system of the file
+static guint64 spill_available(int file)
+{
+    struct statvfs fs;
+    if ( fstatvfs(file, &fs) != 0 )
+        return 0;
+    return (guint64) fs.f_bavail * (guint64) fs.f_frsize;
+}
+
+// reserve disk space to extend the file: writing to a mapped sparse file
+// would crash when the disk is full
+static bool spill_reserve(int file, off_t offset, off_t length)
+{
+#if defined(__linux__)
+    // allocate blocks without writing them (never emulated with zeros)
+    if ( fallocate(file, FALLOC_FL_KEEP_SIZE, offset, length) != 0 ) {
+        // not supported by the file system: check free space instead
+        if ( errno != EOPNOTSUPP || spill_available(file) < (guint64) length )
+            return false;
+    }
+    return ftruncate(file, offset + length) == 0;
+#elif defined(__APPLE__)
+    fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, length, 0 };
+    if ( fcntl(file, F_PREALLOCATE, &store) == -1 && spill_available(file) < (guint64) length )
+        return false;
+    return ftruncate(file, offset + length) == 0;
+#else
+    // cannot reserve space on this platform
+    (void) file;
+    (void) offset;
+    (void) length;
+    return false;
+#endif
+}
+
+// spilling in memory (tmpfs) would defeat the purpose
+static bool spill_on_disk(const std::string &directory)
+{
+#if defined(__linux__)
+    struct statfs fs;
+    if ( statfs(directory.c_str(), &fs) != 0 )
+        return false;
+    return fs.f_type != TMPFS_MAGIC && fs.f_type != RAMFS_MAGIC;
+#elif defined(__APPLE__)
+    struct statfs fs;
+    if ( statfs(directory.c_str(), &fs) != 0 )
+        return false;
+    return std::string(fs.f_fstypename) != "tmpfs";
+#else
+    (void) directory;
+    return false;
+#endif
+}
+
+bool FrameSpill::allocate(gsize frame_size)
+{
+    if (map_ != nullptr || file_ > -1 || frame_size < 1)
+        return false;
+
+    if ( !spill_on_disk(directory_) ) {
+        Log::Warning("Frame capture : %s is not on a disk; cannot spill frames there.", directory_.c_str());
+        return false;
+    }
+
+    // temporary file, removed from the file system immediately
+    std::string filename = directory_ + "vimix_spill_XXXXXX";
+    std::vector<char> name(filename.begin(), filename.end());
+    name.push_back('\0');
+    file_ = mkstemp(name.data());
+    if (file_ < 0) {
+        Log::Warning("Frame capture : Cannot create spill file in %s", directory_.c_str());
+        return false;
+    }
+    unlink(name.data());
+
+    // slots aligned on memory pages, not more than the free space on disk
+    const gsize page = (gsize) sysconf(_SC_PAGESIZE);
+    slot_size_ = ((frame_size + page - 1) / page) * page;
+    slots_ = MIN(capacity_, spill_available(file_)) / slot_size_;
+    if (slots_ < 2) {
+        Log::Warning("Frame capture : Not enough space for spill file in %s", directory_.c_str());
+        close(file_);
+        file_ = -1;
+        return false;
+    }
+
+    // the whole ring is mapped, but the file grows only when frames are spilled
+    const off_t size = (off_t) (slots_ * slot_size_);
+    void *m = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+    if (m == MAP_FAILED) {
+        Log::Warning("Frame capture : Cannot map spill file");
+        close(file_);
+        file_ = -1;
+        return false;
+    }
+    map_ = static_cast<unsigned char *>(m);
+    frame_size_ = frame_size;
+    timing_.resize(slots_);
+
+    Log::Info("Frame capture : Up to %lu frames (%s) can spill in %s",
+              (unsigned long) slots_, BaseToolkit::byte_to_string(size).c_str(), directory_.c_str());
+
+    return true;
+}
+
+bool FrameSpill::push(GstBuffer *frame)
+{
+    // all frames have the same size, and the ring shall not be full
+    if (map_ == nullptr || gst_buffer_get_size(frame) != frame_size_ || count_ >= slots_) {
+        ++dropped_;
+        return false;
+    }
+
+    // grow the file by steps when reaching its end (slots are used in order until the ring wraps)
+    const guint64 slot = (head_ + count_) % slots_;
+    if (slot >= reserved_) {
+        const guint64 step = MIN(MAX(SPILL_GROW_SIZE / slot_size_, (guint64) 1), slots_ - reserved_);
+        if ( !spill_reserve(file_, (off_t) (reserved_ * slot_size_), (off_t) (step * slot_size_)) ) {
+            ++dropped_;
+            return false;
+        }
+        reserved_ += step;
+    }
+
+    gst_buffer_extract(frame, 0, map_ + slot * slot_size_, frame_size_);
+    timing_[slot].pts = GST_BUFFER_PTS(frame);
+    timing_[slot].duration = GST_BUFFER_DURATION(frame);
+    ++count_;
+
+    return true;
+}
+
+GstBuffer *FrameSpill::pop()
+{
+    if (count_ < 1)
+        return nullptr;
+
+    unsigned char *data = map_ + head_ * slot_size_;
+    GstBuffer *frame = gst_buffer_new_allocate(NULL, frame_size_, NULL);
+    gst_buffer_fill(frame, 0, data, frame_size_);
+    GST_BUFFER_PTS(frame) = timing_[head_].pts;
+    GST_BUFFER_DURATION(frame) = timing_[head_].duration;
+
+    // pages of this slot are not needed in memory anymore
+    madvise(data, slot_size_, MADV_DONTNEED);
+
+    head_ = (head_ + 1) % slots_;
+    --count_;
+
+    return frame;
+}
 
 
 FrameGrabber::FrameGrabber(): finished_(false), initialized_(false), active_(false),
-    endofstream_(false), accept_buffer_(false), buffering_full_(false), pause_(false),
+    endofstream_(false), accept_buffer_(false), buffering_full_(false), pause_(false), flush_(false),
     pipeline_(nullptr), src_(nullptr), caps_(nullptr), timer_(nullptr), timer_firstframe_(0),
     timer_pauseframe_(0), timestamp_(0), duration_(0), pause_duration_(0), frame_count_(0),
-    buffering_size_(MIN_BUFFER_SIZE), buffering_count_(0), timestamp_on_clock_(true)
+    buffering_size_(MIN_BUFFER_SIZE), buffering_count_(0), timestamp_on_clock_(true),
+    spill_(nullptr), spill_eos_(false)
 {
     // unique id
     id_ = BaseToolkit::uniqueId();
@@ -295,6 +646,9 @@ FrameGrabber::~FrameGrabber()
         gst_element_get_state (pipeline_, &state, NULL, GST_CLOCK_TIME_NONE);
         gst_object_unref (pipeline_);
     }
+
+    if (spill_ != nullptr)
+        delete spill_;
 }
 
 bool FrameGrabber::finished() const
@@ -336,9 +690,25 @@ void FrameGrabber::stop ()
 {
     // TODO if not initialized wait for initializer
 
+    // record the frames still being read back
+    if (active_) {
+        flush_ = true;
+        FrameGrabbing::manager().flush();
+        flush_ = false;
+    }
+
     // stop recording
     active_ = false;
 
+    // frames spilled on disk are sent before end of stream
+    if (spill_ != nullptr) {
+        std::lock_guard<std::mutex> lock(spill_lock_);
+        if (spill_->frames() > 0) {
+            spill_eos_ = true;
+            return;
+        }
+    }
+
     // send end of stream
     gst_element_send_event (pipeline_, gst_event_new_eos ());
 
@@ -358,8 +728,12 @@ std::string FrameGrabber::info() const
 void FrameGrabber::callback_need_data (GstAppSrc *, guint , gpointer p)
 {
     FrameGrabber *grabber = static_cast<FrameGrabber *>(p);
-    if (grabber)
+    if (grabber) {
+        // give back frames spilled on disk first
+        if (grabber->spill_ != nullptr)
+            grabber->unspill();
         grabber->accept_buffer_ = true;
+    }
 }
 
 // appsrc has enough data and we can stop sending
@@ -374,6 +748,43 @@ void FrameGrabber::callback_enough_data (GstAppSrc *, gpointer p)
     }
 }
 
+// send the oldest frames spilled on disk (called from the streaming thread)
+// until the queue of appsrc is full, to drain the file faster than real time
+void FrameGrabber::unspill ()
+{
+    std::lock_guard<std::mutex> lock(spill_lock_);
+
+    const guint64 max = gst_app_src_get_max_bytes (src_);
+    GstBuffer *frame = spill_->pop();
+    while (frame != nullptr) {
+        gst_app_src_push_buffer (src_, frame);
+        frame = nullptr;
+        if ( max > 0 && gst_app_src_get_current_level_bytes (src_) < max )
+            frame = spill_->pop();
+    }
+
+    // end of stream was delayed until all frames were sent
+    if (spill_eos_ && spill_->frames() < 1) {
+        spill_eos_ = false;
+        gst_app_src_end_of_stream (src_);
+    }
+}
+
+// keep frame on disk if the encoder is behind; false if it can be pushed
+bool FrameGrabber::spill (GstBuffer *frame)
+{
+    std::lock_guard<std::mutex> lock(spill_lock_);
+
+    // frames are kept in order: once some are on disk, all go to disk
+    if ( spill_->frames() < 1 && buffering_count_ + MIN_BUFFER_SIZE <= buffering_size_ )
+        return false;
+
+    if ( !spill_->push(frame) && spill_->dropped() == 1 )
+        Log::Warning("Frame capture : Spill file is full; frames are lost.");
+
+    return true;
+}
+
 GstPadProbeReturn FrameGrabber::callback_event_probe(GstPad *, GstPadProbeInfo * info, gpointer p)
 {
   GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
@@ -393,6 +804,37 @@ std::string FrameGrabber::initialize(FrameGrabber *rec, GstCaps *caps)
     return rec->init(caps);
 }
 
+// buffer with the memory of a frame of the pool, and its own metadata;
+// the frame returns to the pool when this buffer is released
+// (a copy would share the memory, and the pool would then discard the frame)
+struct FrameWrap {
+    GstBuffer *buffer;
+    GstMapInfo map;
+};
+
+static void frame_unwrap(gpointer data)
+{
+    FrameWrap *w = (FrameWrap *) data;
+    gst_buffer_unmap(w->buffer, &w->map);
+    gst_buffer_unref(w->buffer);
+    delete w;
+}
+
+static GstBuffer *frame_wrap(GstBuffer *buffer)
+{
+    FrameWrap *w = new FrameWrap;
+    if ( !gst_buffer_map(buffer, &w->map, GST_MAP_READ) ) {
+        delete w;
+        return gst_buffer_copy(buffer);
+    }
+    w->buffer = gst_buffer_ref(buffer);
+
+    GstBuffer *frame = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, w->map.data, w->map.size,
+                                                   0, w->map.size, w, frame_unwrap);
+    gst_buffer_copy_into(frame, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+    return frame;
+}
+
 void FrameGrabber::addFrame (GstBuffer *buffer, GstCaps *caps)
 {
     // ignore
@@ -445,7 +887,8 @@ void FrameGrabber::addFrame (GstBuffer *buffer, GstCaps *caps)
         // how much buffer is used
         buffering_count_ = gst_app_src_get_current_level_bytes(src_);
 
-        if (accept_buffer_ && !pause_) {
+        // with a spill file, frames are accepted even if the encoder is full
+        if ( (accept_buffer_ || spill_ != nullptr) && !pause_) {
             GstClockTime t = 0;
 
             // initialize timer on first occurence
@@ -467,7 +910,8 @@ void FrameGrabber::addFrame (GstBuffer *buffer, GstCaps *caps)
             }
 
             // if time is zero (first frame) or if delta time is passed one frame duration (with a margin)
-            if ( t == 0 || (t - duration_) > (frame_duration_ - 3000) ) {
+            // (frames given on stop were rendered before and all arrive now)
+            if ( t == 0 || flush_ || (t - duration_) > (frame_duration_ - 3000) ) {
 
                 // count frames
                 frame_count_++;
@@ -475,44 +919,57 @@ void FrameGrabber::addFrame (GstBuffer *buffer, GstCaps *caps)
                 // set duration to an exact multiples of frame duration
                 duration_ = ( t / frame_duration_) * frame_duration_;
 
+                GstBuffer *frame = nullptr;
+
                 if (timestamp_on_clock_)
                     // automatic frame presentation time stamp
                     // Pipeline set to "do-timestamp"=TRUE
                     // set timestamp to actual time
                     timestamp_ = duration_;
-                else {
+                else
                     // monotonic timestamp increment to keep fixed FPS
                     // Pipeline set to "do-timestamp"=FALSE
                     timestamp_ += frame_duration_;
+
+                // spilled frames are sent later: their time stamp cannot be automatic
+                if (!timestamp_on_clock_ || spill_ != nullptr) {
+                    // the frame is shared by all grabbers: get our own buffer
+                    // with the same memory (to set its time stamp)
+                    frame = frame_wrap(buffer);
                     // force frame presentation timestamp
-                    buffer->pts = timestamp_;
+                    frame->pts = timestamp_;
                     // set frame duration
-                    buffer->duration = frame_duration_;
+                    frame->duration = frame_duration_;
                 }
-
-                // when buffering is (almost) full, refuse buffer 1 frame over 2
-                if (buffering_full_)
-                    accept_buffer_ = frame_count_%2;
                 else
-                {
-                    // enter buffering_full_ mode if the space left in buffering is for only few frames
-                    // (this prevents filling the buffer entirely)
-                    if ( buffering_size_ - buffering_count_ < MIN_BUFFER_SIZE ) {
+                    // increment ref counter to make sure the frame remains available
+                    frame = gst_buffer_ref(buffer);
+
+                // keep the frame on disk instead of skipping frames
+                if (spill_ != nullptr && spill(frame))
+                    gst_buffer_unref (frame);
+                else {
+                    // when buffering is (almost) full, refuse buffer 1 frame over 2
+                    if (buffering_full_)
+                        accept_buffer_ = frame_count_%2;
+                    else
+                    {
+                        // enter buffering_full_ mode if the space left in buffering is for only few frames
+                        // (this prevents filling the buffer entirely)
+                        if ( buffering_size_ - buffering_count_ < MIN_BUFFER_SIZE ) {
 #ifndef NDEBUG
-                        Log::Info("Frame capture : Using %s of %s Buffer.",
-                                  BaseToolkit::byte_to_string(buffering_count_).c_str(),
-                                  BaseToolkit::byte_to_string(buffering_size_).c_str());
+                            Log::Info("Frame capture : Using %s of %s Buffer.",
+                                      BaseToolkit::byte_to_string(buffering_count_).c_str(),
+                                      BaseToolkit::byte_to_string(buffering_size_).c_str());
 #endif
-                        buffering_full_ = true;
+                            buffering_full_ = true;
+                        }
                     }
-                }
 
-                // increment ref counter to make sure the frame remains available
-                gst_buffer_ref(buffer);
-
-                // push frame
-                gst_app_src_push_buffer (src_, buffer);
-                // NB: buffer will be unrefed by the appsrc
+                    // push frame
+                    gst_app_src_push_buffer (src_, frame);
+                    // NB: buffer will be unrefed by the appsrc
+                }
             }
         }
     }
@@ -5,20 +5,28 @@
 #include <future>
 #include <list>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/video/video.h>
 
 
-// use glReadPixel or glGetTextImage
-// read pixels & pbo should be the fastest
-// https://stackoverflow.com/questions/38140527/glreadpixels-vs-glgetteximage
-#define USE_GLREADPIXEL
 #define DEFAULT_GRABBER_FPS 30
 #define MIN_BUFFER_SIZE 33177600  // 33177600 bytes = 1 frames 4K, 9 frames 720p
+#define MIN_READBACK_DEPTH 2
+#define MAX_READBACK_DEPTH 8
+#define READBACK_FLUSH_TIMEOUT 100000000  // 100 ms wait for each frame read back on stop
+#define SPILL_GROW_SIZE 268435456  // spill file grows by 256 MB
 
 class FrameBuffer;
+class FrameSpill;
+class Surface;
+class YUVPackShader;
+struct __GLsync;
 
 
 /**
@@ -70,6 +78,7 @@ protected:
     std::atomic<bool> accept_buffer_;
     std::atomic<bool> buffering_full_;
     std::atomic<bool> pause_;
+    bool flush_;
 
     // gstreamer pipeline
     GstElement   *pipeline_;
@@ -88,6 +97,13 @@ protected:
     guint64      buffering_count_;
     bool         timestamp_on_clock_;
 
+    // overflow of frames on disk when the encoder falls behind
+    FrameSpill   *spill_;
+    mutable std::mutex spill_lock_;
+    bool         spill_eos_;
+    bool spill (GstBuffer *frame);
+    void unspill ();
+
     // async threaded initializer
     std::future<std::string> initializer_;
     static std::string initialize(FrameGrabber *rec, GstCaps *caps);
@@ -98,6 +114,52 @@ protected:
     static GstPadProbeReturn callback_event_probe(GstPad *, GstPadProbeInfo *info, gpointer user_data);
 };
 
+/**
+ * @brief The FrameSpill class is a ring of raw frames in a memory-mapped file
+ *
+ * Recorders spill frames into it when the encoder falls behind and
+ * the buffer in memory is full; frames are given back in order once the
+ * encoder catches up. The file is removed as soon as it is created, and
+ * grows on disk by steps as frames are spilled.
+ */
+class FrameSpill
+{
+public:
+    FrameSpill(const std::string &directory, guint64 capacity);
+    ~FrameSpill();
+
+    // create the file for frames of the given size; false if not possible
+    bool allocate(gsize frame_size);
+
+    // copy a frame at the end of the ring; false if full or failed
+    bool push(GstBuffer *frame);
+    // new buffer with the oldest frame of the ring; nullptr if empty
+    GstBuffer *pop();
+
+    inline guint64 frames() const { return count_; }
+    inline guint64 bytes() const { return count_ * slot_size_; }
+    inline guint64 capacity() const { return capacity_; }
+    inline guint64 dropped() const { return dropped_; }
+
+private:
+    std::string directory_;
+    guint64 capacity_;
+    int file_;
+    unsigned char *map_;
+    gsize frame_size_;
+    gsize slot_size_;
+    guint64 slots_;
+    guint64 reserved_;
+    guint64 head_;
+    guint64 count_;
+    guint64 dropped_;
+    struct Timing {
+        GstClockTime pts;
+        GstClockTime duration;
+    };
+    std::vector<Timing> timing_;
+};
+
 /**
  * @brief The FrameGrabbing class manages all frame grabbers
  *
@@ -134,6 +196,14 @@ public:
     void stopAll();
     void clearAll();
 
+    // give the frames being read back to grabbers (waiting for the GPU)
+    // NB: only effective in the thread grabbing frames
+    void flush();
+
+    // statistics of asynchronous readback
+    inline double readbackLatency() const { return latency_; }
+    inline guint64 droppedFrames() const { return dropped_; }
+
 protected:
 
     // only for friend Session
@@ -142,14 +212,42 @@ protected:
 private:
     std::list<FrameGrabber *> grabbers_;
     std::map<FrameGrabber *, FrameGrabber *> grabbers_chain_;
-    guint pbo_[2];
-    guint pbo_index_;
-    guint pbo_next_index_;
     guint size_;
     guint width_;
     guint height_;
     bool  use_alpha_;
+    GstVideoFormat format_;
     GstCaps *caps_;
+    GstBufferPool *pool_;
+
+    // GPU conversion of RGB frames into YUV planes before readback
+    FrameBuffer *conversion_buffer_;
+    Surface *conversion_surface_;
+    YUVPackShader *conversion_shader_;
+    void discardConversion();
+
+    // ring of pixel buffer objects, each guarded by a fence
+    struct Readback {
+        guint pbo;
+        struct __GLsync *fence;
+        gint64 issued;
+        Readback() : pbo(0), fence(nullptr), issued(0) {}
+    };
+    std::vector<Readback> readback_;
+    guint readback_write_;
+    guint readback_read_;
+    guint readback_pending_;
+    void discardReadback();
+    std::thread::id thread_;
+    bool collecting_;
+    void collect(bool wait);
+
+    // give a frame to all grabbers
+    void sendFrame(GstBuffer *buffer);
+
+    // statistics
+    double latency_;
+    guint64 dropped_;
 };
 
 
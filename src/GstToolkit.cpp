@@ -22,6 +22,15 @@
 #include <iomanip>
 using namespace std;
 
+// thread priority
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 #include <gst/gl/gl.h>
 
 #include "GstToolkit.h"
@@ -464,3 +473,104 @@ GstToolkit::PipelineConfigSet GstToolkit::getPipelineConfigs(const std::string &
 
     return configs;
 }
+
+void GstToolkit::background_priority()
+{
+#if defined(__linux__)
+    setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), 19);
+#elif defined(__APPLE__)
+    setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#endif
+}
+
+//
+// Task pool of background pipelines
+//
+// GstTask threads normally come from the shared GLib thread pool, and are
+// reused by other pipelines afterwards. Streaming threads of background
+// pipelines are created by this pool instead, and end with their task, so
+// that their low priority never leaks to live pipelines.
+//
+typedef struct { GstTaskPool parent; } BackgroundTaskPool;
+typedef struct { GstTaskPoolClass parent_class; } BackgroundTaskPoolClass;
+
+G_DEFINE_TYPE (BackgroundTaskPool, background_task_pool, GST_TYPE_TASK_POOL)
+
+struct BackgroundTask {
+    GstTaskPoolFunction func;
+    gpointer user_data;
+};
+
+static gpointer background_task_run (gpointer data)
+{
+    BackgroundTask *task = static_cast<BackgroundTask *>(data);
+    GstToolkit::background_priority();
+    task->func(task->user_data);
+    delete task;
+    return NULL;
+}
+
+static void background_task_pool_prepare (GstTaskPool *, GError **)
+{
+    // no thread pool
+}
+
+static void background_task_pool_cleanup (GstTaskPool *)
+{
+}
+
+static gpointer background_task_pool_push (GstTaskPool *, GstTaskPoolFunction func,
+                                           gpointer user_data, GError **error)
+{
+    BackgroundTask *task = new BackgroundTask { func, user_data };
+    GThread *thread = g_thread_try_new ("background", background_task_run, task, error);
+    if (thread == NULL)
+        delete task;
+    return thread;
+}
+
+static void background_task_pool_join (GstTaskPool *, gpointer id)
+{
+    if (id != NULL)
+        g_thread_join ((GThread *) id);
+}
+
+static void background_task_pool_class_init (BackgroundTaskPoolClass *klass)
+{
+    GstTaskPoolClass *pool_class = GST_TASK_POOL_CLASS (klass);
+    pool_class->prepare = background_task_pool_prepare;
+    pool_class->cleanup = background_task_pool_cleanup;
+    pool_class->push = background_task_pool_push;
+    pool_class->join = background_task_pool_join;
+}
+
+static void background_task_pool_init (BackgroundTaskPool *)
+{
+}
+
+// tasks of the pipeline are announced when created, to give them our pool
+static GstBusSyncReply callback_stream_status (GstBus *, GstMessage *msg, gpointer pool)
+{
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_STREAM_STATUS) {
+        GstStreamStatusType type;
+        GstElement *owner = nullptr;
+        gst_message_parse_stream_status(msg, &type, &owner);
+        if (type == GST_STREAM_STATUS_TYPE_CREATE) {
+            const GValue *val = gst_message_get_stream_status_object(msg);
+            if (val && G_VALUE_TYPE(val) == GST_TYPE_TASK)
+                gst_task_set_pool (GST_TASK (g_value_get_object(val)), GST_TASK_POOL (pool));
+        }
+    }
+    return GST_BUS_PASS;
+}
+
+void GstToolkit::set_background_priority(GstElement *pipeline)
+{
+    GstTaskPool *pool = GST_TASK_POOL (gst_object_ref_sink (g_object_new (background_task_pool_get_type (), NULL)));
+    gst_task_pool_prepare (pool, NULL);
+
+    // the bus keeps the pool until the handler is replaced or the bus is freed
+    GstBus *bus = gst_element_get_bus (pipeline);
+    gst_bus_set_sync_handler (bus, callback_stream_status, pool, (GDestroyNotify) gst_object_unref);
+    gst_object_unref (bus);
+}
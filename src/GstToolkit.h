@@ -31,6 +31,12 @@ std::list<std::string> all_plugin_features(const std::string &pluginname);
 bool has_feature (const std::string &name);
 bool enable_feature (const std::string &name, bool enable);
 
+// lower the scheduling priority of the calling thread
+void background_priority();
+// run all streaming threads of the pipeline at low priority, in threads
+// of their own (never reused by other pipelines); call before PLAYING
+void set_background_priority(GstElement *pipeline);
+
 
 struct PipelineConfig {
     gint width;
@@ -1032,10 +1032,10 @@ void ImGuiVisitor::visit (DelayFilter& f)
 //    ImGui::SameLine(0, IMGUI_SAME_LINE);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     float d = f.delay();
-    if (ImGui::SliderFloat("##Delay", &d, 0.f, 2.f, "%.2f s"))
+    if (ImGui::SliderFloat("##Delay", &d, 0.f, MAX_DELAY, "%.2f s", 2.f))
         f.setDelay(d);
     if (ImGui::IsItemHovered() && io.MouseWheel != 0.f ){
-        d = CLAMP( d + 0.01f * io.MouseWheel, 0.f, 2.f);
+        d = CLAMP( d + 0.01f * io.MouseWheel, 0.f, MAX_DELAY);
         f.setDelay(d);
         oss << "Delay " << std::setprecision(3) << d << " s";
         Action::manager().store(oss.str());
@@ -100,20 +100,22 @@ glm::vec4 FilteringProgram::iMouse = glm::vec4(0.f,0.f,0.f,0.f);
 ///                                 ////
 ////////////////////////////////////////
 
-FilteringProgram::FilteringProgram() : name_("Default"), code_({"shaders/filters/default.glsl",""}), two_pass_filter_(false)
+FilteringProgram::FilteringProgram() : name_("Default"), code_({"shaders/filters/default.glsl",""}), two_pass_filter_(false),
+    per_pixel_filter_(true)
 {
 
 }
 
 FilteringProgram::FilteringProgram(const std::string &name, const std::string &first_pass, const std::string &second_pass,
-                         const std::map<std::string, float> &parameters) :
-    name_(name), code_({first_pass, second_pass}), parameters_(parameters)
+                         const std::map<std::string, float> &parameters, bool per_pixel) :
+    name_(name), code_({first_pass, second_pass}), per_pixel_filter_(per_pixel), parameters_(parameters)
 {
     two_pass_filter_ = !second_pass.empty();
 }
 
 FilteringProgram::FilteringProgram(const FilteringProgram &other) :
-    name_(other.name_), code_(other.code_), two_pass_filter_(other.two_pass_filter_), parameters_(other.parameters_)
+    name_(other.name_), code_(other.code_), two_pass_filter_(other.two_pass_filter_),
+    per_pixel_filter_(other.per_pixel_filter_), parameters_(other.parameters_)
 {
 
 }
@@ -126,6 +128,7 @@ FilteringProgram& FilteringProgram::operator= (const FilteringProgram& other)
         this->parameters_.clear();
         this->parameters_ = other.parameters_;
         this->two_pass_filter_ = other.two_pass_filter_;
+        this->per_pixel_filter_ = other.per_pixel_filter_;
     }
 
     return *this;
@@ -174,6 +177,7 @@ void FilteringProgram::removeParameter(const std::string &p)
 ImageFilteringShader::ImageFilteringShader(): ImageShader()
 {
     program_ = &custom_shading_;
+    code_version_ = 0;
 
     shader_code_ = fragmentHeader + filterDefault + fragmentFooter;
     custom_shading_.setShaders("shaders/image.vs", shader_code_);
@@ -207,32 +211,37 @@ void ImageFilteringShader::use()
 {
     ImageShader::use();
 
+    setFilterUniforms(program_);
+}
+
+void ImageFilteringShader::setFilterUniforms(ShadingProgram *program)
+{
     //
     // Shader input uniforms
     //
-    program_->setUniform("iTime", float(iTime_) );
-    program_->setUniform("iFrame", int(iFrame_) );
+    program->setUniform("iTime", float(iTime_) );
+    program->setUniform("iFrame", int(iFrame_) );
 
     // scale iMouse to resolution
-    program_->setUniform("iMouse", FilteringProgram::iMouse );
+    program->setUniform("iMouse", FilteringProgram::iMouse );
 
     // Calculate iTimeDelta
     double elapsed = g_timer_elapsed (timer_, NULL);
     g_timer_reset(timer_);
-    program_->setUniform("iTimeDelta", float(elapsed) );
+    program->setUniform("iTimeDelta", float(elapsed) );
 
     // calculate iDate
     std::time_t now = std::time(0);
     std::tm *local = std::localtime(&now);
     glm::vec4 iDate(local->tm_year+1900, local->tm_mon, local->tm_mday, local->tm_hour*3600+local->tm_min*60+local->tm_sec);
-    program_->setUniform("iDate", iDate);
+    program->setUniform("iDate", iDate);
 
     //
     // loop over uniforms
     //
     for (auto u = uniforms_.begin(); u != uniforms_.end(); ) {
         // set uniform to current value
-        if ( program_->setUniform(u->first, u->second) )
+        if ( program->setUniform(u->first, u->second) )
             // uniform variable could be set, keep it
             ++u;
         else {
@@ -258,6 +267,7 @@ void ImageFilteringShader::setCode(const std::string &code, std::promise<std::st
     if (code != code_)
     {
         code_ = code;
+        ++code_version_;
         // ensure code to compile is correct
         if (code_.empty())
             code_ = filterDefault;
@@ -278,6 +288,8 @@ void ImageFilteringShader::copy(ImageFilteringShader const& S)
     ImageShader::copy(S);
 
     // change the shading code for fragment
+    code_ = S.code_;
+    ++code_version_;
     shader_code_ = S.shader_code_;
     custom_shading_.setShaders("shaders/image.vs", shader_code_);
 }
@@ -289,7 +301,7 @@ void ImageFilteringShader::copy(ImageFilteringShader const& S)
 ///                                 ////
 ////////////////////////////////////////
 
-ImageFilter::ImageFilter (): FrameBufferFilter(), buffers_({nullptr, nullptr})
+ImageFilter::ImageFilter (): FrameBufferFilter(), buffer_(nullptr)
 {
     // surface and shader for first pass
     shaders_.first  = new ImageFilteringShader;
@@ -302,10 +314,8 @@ ImageFilter::ImageFilter (): FrameBufferFilter(), buffers_({nullptr, nullptr})
 
 ImageFilter::~ImageFilter ()
 {
-    if ( buffers_.first!= nullptr )
-        delete buffers_.first;
-    if ( buffers_.second!= nullptr )
-        delete buffers_.second;
+    if ( buffer_!= nullptr )
+        delete buffer_;
 
     delete surfaces_.first;
     delete surfaces_.second;
@@ -346,10 +356,19 @@ void ImageFilter::update (float dt)
     }
 }
 
+ImageFilteringShader *ImageFilter::fusableShader() const
+{
+    // NB: filter needs to be drawn once to setup its program
+    if ( input_ != nullptr && program_.isPerPixel() )
+        return shaders_.first;
+
+    return nullptr;
+}
+
 uint ImageFilter::texture () const
 {
-    if (buffers_.first && buffers_.second)
-        return program_.isTwoPass() ? buffers_.second->texture() : buffers_.first->texture();
+    if (buffer_)
+        return buffer_->texture();
 
     if (input_)
         return input_->texture();
@@ -359,8 +378,8 @@ uint ImageFilter::texture () const
 
 glm::vec3 ImageFilter::resolution () const
 {
-    if (buffers_.first && buffers_.second)
-        return program_.isTwoPass() ? buffers_.second->resolution() : buffers_.first->resolution();
+    if (buffer_)
+        return buffer_->resolution();
 
     if (input_)
         return input_->resolution();
@@ -379,39 +398,55 @@ void ImageFilter::draw (FrameBuffer *input)
         // create first-pass surface and shader, taking as texture the input framebuffer
         surfaces_.first->setTextureIndex( input_->texture() );
         shaders_.first->mask_texture = input_->texture();
-        // (re)create framebuffer for result of first-pass
-        if (buffers_.first != nullptr)
-            delete buffers_.first;
-        // FBO
-        buffers_.first = new FrameBuffer( input_->resolution(), input_->flags() );
-        // enforce framebuffer if first-pass is created now, filled with input framebuffer
-        input_->blit( buffers_.first );
-        // create second-pass surface and shader, taking as texture the first-pass framebuffer
-        surfaces_.second->setTextureIndex( buffers_.first->texture() );
         shaders_.second->mask_texture = input_->texture();
-        // (re)create framebuffer for result of second-pass
-        if (buffers_.second != nullptr)
-            delete buffers_.second;
-        buffers_.second = new FrameBuffer( buffers_.first->resolution(), buffers_.first->flags() );
         // forced draw
         forced = true;
     }
 
+    // (re)create framebuffer for result
+    forced |= prepareOutput( input_->resolution(), input_->flags() );
+
     if ( enabled() || forced )
-    {
-        // FIRST PASS
-        // render input surface into frame buffer
-        buffers_.first->begin();
-        surfaces_.first->draw(glm::identity<glm::mat4>(), buffers_.first->projection());
-        buffers_.first->end();
-
-        // SECOND PASS
-        if ( program_.isTwoPass() ) {
-            // render filtered surface from first pass into frame buffer
-            buffers_.second->begin();
-            surfaces_.second->draw(glm::identity<glm::mat4>(), buffers_.second->projection());
-            buffers_.second->end();
-        }
+        drawPasses( input_->resolution(), input_->flags() );
+}
+
+bool ImageFilter::prepareOutput(glm::vec3 resolution, int flags)
+{
+    // NB: multisampling can be disabled when framebuffer is initialized
+    if ( buffer_ != nullptr && glm::ivec2(buffer_->resolution()) == glm::ivec2(resolution) &&
+         (buffer_->flags() | FrameBuffer::FrameBuffer_multisampling) == (flags | FrameBuffer::FrameBuffer_multisampling) )
+        return false;
+
+    if (buffer_ != nullptr)
+        delete buffer_;
+    buffer_ = new FrameBuffer( resolution, flags );
+
+    return true;
+}
+
+void ImageFilter::drawPasses(glm::vec3 first_resolution, int first_flags)
+{
+    // result of first pass goes in a scratch framebuffer if there is a second pass
+    FrameBuffer *first = buffer_;
+    if ( program_.isTwoPass() )
+        first = FrameBufferPool::acquire( first_resolution, first_flags );
+
+    // FIRST PASS
+    // render input surface into frame buffer
+    first->begin();
+    surfaces_.first->draw(glm::identity<glm::mat4>(), first->projection());
+    first->end();
+
+    // SECOND PASS
+    if ( first != buffer_ ) {
+        // second-pass surface takes as texture the first-pass framebuffer
+        surfaces_.second->setTextureIndex( first->texture() );
+        // render filtered surface from first pass into frame buffer
+        buffer_->begin();
+        surfaces_.second->draw(glm::identity<glm::mat4>(), buffer_->projection());
+        buffer_->end();
+        // scratch framebuffer can be used by others
+        FrameBufferPool::release( first );
     }
 }
 
@@ -577,56 +612,32 @@ void ResampleFilter::draw (FrameBuffer *input)
         // create first-pass surface and shader, taking as texture the input framebuffer
         surfaces_.first->setTextureIndex( input_->texture() );
         shaders_.first->mask_texture = input_->texture();
-        // (re)create framebuffer for result of first-pass
-        if (buffers_.first != nullptr)
-            delete buffers_.first;
-        // set resolution depending on resample factor
-        glm::vec3 res = input_->resolution();
-        switch (factor_) {
-        case RESAMPLE_DOUBLE:
-            res *= 2.;
-            break;
-        case RESAMPLE_HALF:
-        case RESAMPLE_QUARTER:
-            res /= 2.;
-            break;
-        default:
-        case RESAMPLE_INVALID:
-            break;
-        }
-        buffers_.first = new FrameBuffer( res, input_->flags() );
-        // enforce framebuffer if first-pass is created now, filled with input framebuffer
-        input_->blit( buffers_.first );
-
-        // SECOND PASS for QUARTER resolution (divide by 2 after first pass divide by 2)
-        // create second-pass surface and shader, taking as texture the first-pass framebuffer
-        surfaces_.second->setTextureIndex( buffers_.first->texture() );
         shaders_.second->mask_texture = input_->texture();
-        // (re)create framebuffer for result of second-pass
-        if (buffers_.second != nullptr)
-            delete buffers_.second;
-        res /= 2.;
-        buffers_.second = new FrameBuffer( res, buffers_.first->flags() );
         // forced draw
         forced = true;
     }
 
-    if ( enabled() || forced )
-    {
-        // FIRST PASS
-        // render input surface into frame buffer
-        buffers_.first->begin();
-        surfaces_.first->draw(glm::identity<glm::mat4>(), buffers_.first->projection());
-        buffers_.first->end();
-
-        // SECOND PASS
-        if ( program().isTwoPass() ) {
-            // render filtered surface from first pass into frame buffer
-            buffers_.second->begin();
-            surfaces_.second->draw(glm::identity<glm::mat4>(), buffers_.second->projection());
-            buffers_.second->end();
-        }
+    // set resolution depending on resample factor
+    glm::vec3 res = input_->resolution();
+    switch (factor_) {
+    case RESAMPLE_DOUBLE:
+        res *= 2.;
+        break;
+    case RESAMPLE_HALF:
+    case RESAMPLE_QUARTER:
+        res /= 2.;
+        break;
+    default:
+    case RESAMPLE_INVALID:
+        break;
     }
+
+    // (re)create framebuffer for result
+    // SECOND PASS for QUARTER resolution (divide by 2 after first pass divide by 2)
+    forced |= prepareOutput( program().isTwoPass() ? res / 2.f : res, input_->flags() );
+
+    if ( enabled() || forced )
+        drawPasses( res, input_->flags() );
 }
 
 void ResampleFilter::accept (Visitor& v)
@@ -656,7 +667,7 @@ std::vector< FilteringProgram > BlurFilter::programs_ = {
     FilteringProgram("Fast",     "shaders/filters/blur.glsl", "", { })
 };
 
-BlurFilter::BlurFilter (): ImageFilter(), method_(BLUR_INVALID), mipmap_buffer_(nullptr)
+BlurFilter::BlurFilter (): ImageFilter(), method_(BLUR_INVALID)
 {
     mipmap_surface_ = new Surface;
 }
@@ -664,8 +675,6 @@ BlurFilter::BlurFilter (): ImageFilter(), method_(BLUR_INVALID), mipmap_buffer_(
 BlurFilter::~BlurFilter ()
 {
     delete mipmap_surface_;
-    if ( mipmap_buffer_!= nullptr )
-        delete mipmap_buffer_;
 }
 
 void BlurFilter::setMethod(int method)
@@ -718,58 +727,32 @@ void BlurFilter::draw (FrameBuffer *input)
 
         // create zero-pass surface taking as texture the input framebuffer
         mipmap_surface_->setTextureIndex( input_->texture() );
-
-        // FBO with mipmapping
-        // (re)create framebuffer for mipmapped input
-        if ( mipmap_buffer_!= nullptr )
-            delete mipmap_buffer_;
-        FrameBuffer::FrameBufferFlags f = input_->flags();
-        mipmap_buffer_ = new FrameBuffer( input_->resolution(), f | FrameBuffer::FrameBuffer_mipmap );
-        // enforce framebuffer created now, filled with input framebuffer
-        input_->blit( mipmap_buffer_ );
-
-        // create first-pass surface and shader, taking as texture the input framebuffer
-        surfaces_.first->setTextureIndex( mipmap_buffer_->texture() );
         shaders_.first->mask_texture = input_->texture();
-        // (re)create framebuffer for result of first-pass
-        if (buffers_.first != nullptr)
-            delete buffers_.first;
-        buffers_.first = new FrameBuffer( input_->resolution(), f | FrameBuffer::FrameBuffer_mipmap );
-        // enforce framebuffer of first-pass is created now, filled with input framebuffer
-        mipmap_buffer_->blit( buffers_.first );
-
-        // create second-pass surface and shader, taking as texture the first-pass framebuffer
-        surfaces_.second->setTextureIndex( buffers_.first->texture() );
         shaders_.second->mask_texture = input_->texture();
-        // (re)create framebuffer for result of second-pass
-        if (buffers_.second != nullptr)
-            delete buffers_.second;
-        buffers_.second = new FrameBuffer( input_->resolution(), f );
         // forced draw
         forced = true;
     }
 
+    // (re)create framebuffer for result (with mipmapping if single pass)
+    int f = input_->flags();
+    forced |= prepareOutput( input_->resolution(), program().isTwoPass() ? f : f | FrameBuffer::FrameBuffer_mipmap );
+
     if ( enabled() || forced )
     {
         // ZERO PASS
-        // render input surface into frame buffer with Mipmapping (Levels of Details)
-        mipmap_buffer_->begin();
-        mipmap_surface_->draw(glm::identity<glm::mat4>(), mipmap_buffer_->projection());
-        mipmap_buffer_->end();
-
-        // FIRST PASS
-        // render mipmapped texture into frame buffer
-        buffers_.first->begin();
-        surfaces_.first->draw(glm::identity<glm::mat4>(), buffers_.first->projection());
-        buffers_.first->end();
-
-        // SECOND PASS
-        if ( program().isTwoPass() ) {
-            // render filtered surface from first pass into frame buffer
-            buffers_.second->begin();
-            surfaces_.second->draw(glm::identity<glm::mat4>(), buffers_.second->projection());
-            buffers_.second->end();
-        }
+        // render input surface into scratch frame buffer with Mipmapping (Levels of Details)
+        FrameBuffer *mipmap = FrameBufferPool::acquire( input_->resolution(), f | FrameBuffer::FrameBuffer_mipmap );
+        mipmap->begin();
+        mipmap_surface_->draw(glm::identity<glm::mat4>(), mipmap->projection());
+        mipmap->end();
+
+        // FIRST PASS (and SECOND PASS)
+        // render mipmapped texture into frame buffers
+        surfaces_.first->setTextureIndex( mipmap->texture() );
+        drawPasses( input_->resolution(), f | FrameBuffer::FrameBuffer_mipmap );
+
+        // scratch framebuffer can be used by others
+        FrameBufferPool::release( mipmap );
     }
 }
 
@@ -871,8 +854,8 @@ std::vector< FilteringProgram > SmoothFilter::programs_ = {
     FilteringProgram("Erosion",  "shaders/filters/erosion.glsl",    "",     { { "Radius", 0.5} }),
     FilteringProgram("Dilation", "shaders/filters/dilation.glsl",   "",     { { "Radius", 0.5} }),
     FilteringProgram("Denoise",  "shaders/filters/denoise.glsl",    "",     { { "Threshold", 0.5} }),
-    FilteringProgram("Noise",    "shaders/filters/noise.glsl",      "",     { { "Amount", 0.25} }),
-    FilteringProgram("Grain",    "shaders/filters/grain.glsl",      "",     { { "Amount", 0.5} })
+    FilteringProgram("Noise",    "shaders/filters/noise.glsl",      "",     { { "Amount", 0.25} }, true),
+    FilteringProgram("Grain",    "shaders/filters/grain.glsl",      "",     { { "Amount", 0.5} }, true)
 };
 
 SmoothFilter::SmoothFilter (): ImageFilter(), method_(SMOOTH_INVALID)
@@ -1010,9 +993,9 @@ const char* AlphaFilter::operation_label[AlphaFilter::ALPHA_INVALID] = {
 };
 
 std::vector< FilteringProgram > AlphaFilter::programs_ = {
-    FilteringProgram("Chromakey","shaders/filters/chromakey.glsl",   "",  { { "Threshold", 0.5}, { "Red", 0.0}, { "Green", 1.0}, { "Blue", 0.0}, { "Tolerance", 0.5} } ),
-    FilteringProgram("Lumakey",  "shaders/filters/lumakey.glsl",     "",  { { "Threshold", 0.5}, { "Luminance", 0.0}, { "Tolerance", 0.5} } ),
-    FilteringProgram("coloralpha","shaders/filters/coloralpha.glsl", "",  { { "Red", 0.0}, { "Green", 1.0}, { "Blue", 0.0} } )
+    FilteringProgram("Chromakey","shaders/filters/chromakey.glsl",   "",  { { "Threshold", 0.5}, { "Red", 0.0}, { "Green", 1.0}, { "Blue", 0.0}, { "Tolerance", 0.5} }, true ),
+    FilteringProgram("Lumakey",  "shaders/filters/lumakey.glsl",     "",  { { "Threshold", 0.5}, { "Luminance", 0.0}, { "Tolerance", 0.5} }, true ),
+    FilteringProgram("coloralpha","shaders/filters/coloralpha.glsl", "",  { { "Red", 0.0}, { "Green", 1.0}, { "Blue", 0.0} }, true )
 };
 
 AlphaFilter::AlphaFilter (): ImageFilter(), operation_(ALPHA_INVALID)
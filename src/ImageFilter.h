@@ -23,6 +23,9 @@ class FilteringProgram
     // true if code is given for second pass
     bool two_pass_filter_;
 
+    // true if code only reads the input at the pixel it computes
+    bool per_pixel_filter_;
+
     // list of parameters : uniforms names and values
     std::map< std::string, float > parameters_;
 
@@ -30,7 +33,7 @@ public:
 
     FilteringProgram();
     FilteringProgram(const std::string &name, const std::string &first_pass, const std::string &second_pass,
-                     const std::map<std::string, float> &parameters);
+                     const std::map<std::string, float> &parameters, bool per_pixel = false);
     FilteringProgram(const FilteringProgram &other);
 
     FilteringProgram& operator= (const FilteringProgram& other);
@@ -40,8 +43,8 @@ public:
     inline void setName(const std::string &name) { name_ = name; }
     inline std::string name() const { return name_; }
 
-    // set the code
-    inline void setCode(const std::pair< std::string, std::string > &code) { code_ = code; }
+    // set the code (not known to be per pixel)
+    inline void setCode(const std::pair< std::string, std::string > &code) { code_ = code; per_pixel_filter_ = false; }
 
     // get the code
     std::pair< std::string, std::string > code();
@@ -49,6 +52,9 @@ public:
     // if has second pass
     inline bool isTwoPass() const { return two_pass_filter_; }
 
+    // if can be fused with color correction (single pass, per pixel)
+    inline bool isPerPixel() const { return per_pixel_filter_ && !two_pass_filter_; }
+
     // set the list of parameters
     inline void setParameters(const std::map< std::string, float > &parameters) { parameters_ = parameters; }
 
@@ -78,6 +84,7 @@ class ImageFilteringShader : public ImageShader
     // fragment shader GLSL code
     std::string shader_code_;
     std::string code_;
+    uint code_version_;
 
 public:
     // for iTimedelta
@@ -100,6 +107,12 @@ public:
 
     // set the code of the filter
     void setCode(const std::string &code, std::promise<std::string> *ret = nullptr);
+    inline std::string code() const { return code_; }
+    // incremented when the code changes
+    inline uint codeVersion() const { return code_version_; }
+
+    // set uniforms of the filter in given program
+    void setFilterUniforms(ShadingProgram *program);
 
 };
 
@@ -123,6 +136,10 @@ public:
     void setProgramParameters(const std::map< std::string, float > &parameters);
     void setProgramParameter(const std::string &p, float value);
 
+    // shader of a per pixel program, to be fused with color correction
+    // (the filter does not need to draw if fused)
+    ImageFilteringShader *fusableShader() const;
+
     // implementation of FrameBufferFilter
     Type type() const override { return FrameBufferFilter::FILTER_IMAGE; }
     uint texture () const override;
@@ -136,9 +153,15 @@ public:
 protected:
 
     std::pair< Surface *, Surface *> surfaces_;
-    std::pair< FrameBuffer *, FrameBuffer * > buffers_;
     std::pair< ImageFilteringShader *, ImageFilteringShader *> shaders_;
     void updateParameters();
+
+    // output of the last pass (first pass of two is rendered in a pooled buffer)
+    FrameBuffer *buffer_;
+    // (re)create output if resolution or flags changed, returns true if created
+    bool prepareOutput(glm::vec3 resolution, int flags);
+    // render first pass, and second pass if the program has one
+    void drawPasses(glm::vec3 first_resolution, int first_flags);
 };
 
 
@@ -205,7 +228,6 @@ private:
     static std::vector< FilteringProgram > programs_;
 
     Surface *mipmap_surface_;
-    FrameBuffer *mipmap_buffer_;
 };
 
 
@@ -17,18 +17,67 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
 **/
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include <map>
+
 #include "Visitor.h"
+#include "BaseToolkit.h"
+#include "Resource.h"
+#include "ImageFilter.h"
 #include "ImageProcessingShader.h"
 
 ShadingProgram imageProcessingShadingProgram("shaders/image.vs", "shaders/imageprocessing.fs");
 
+// programs fusing filter and image processing, by hash of filter code
+static std::map<size_t, ShadingProgram *> filteredProcessingPrograms;
+
+static std::string filteredProcessingUniforms = "uniform float     iTime;\n"
+                                                "uniform float     iTimeDelta;\n"
+                                                "uniform int       iFrame;\n"
+                                                "uniform vec4      iDate;\n"
+                                                "uniform vec4      iMouse;\n";
+
+static ShadingProgram *filteredProcessingProgram(const std::string &code)
+{
+    size_t key = std::hash<std::string>{}(code);
+
+    auto it = filteredProcessingPrograms.find(key);
+    if (it != filteredProcessingPrograms.end())
+        return it->second;
+
+    // image processing code, with filter enabled and the code of filter appended
+    std::string fragment = Resource::getText("shaders/imageprocessing.fs");
+    size_t version = fragment.find('\n') + 1;
+    fragment.insert(version, "#define FILTERED\n");
+    fragment += filteredProcessingUniforms + code;
+
+    ShadingProgram *p = new ShadingProgram("shaders/image.vs", fragment);
+    filteredProcessingPrograms[key] = p;
+
+    return p;
+}
+
 
-ImageProcessingShader::ImageProcessingShader(): Shader()
+ImageProcessingShader::ImageProcessingShader(): Shader(), filter_(nullptr), filter_version_(0)
 {
     program_ = &imageProcessingShadingProgram;
     ImageProcessingShader::reset();
 }
 
+void ImageProcessingShader::setFilter(ImageFilteringShader *filter)
+{
+    // select program of color correction, fused with filter if any
+    // (searched only when the filter or its code changed)
+    if (filter == nullptr)
+        program_ = &imageProcessingShadingProgram;
+    else if (filter != filter_ || filter->codeVersion() != filter_version_) {
+        program_ = filteredProcessingProgram( filter->code() );
+        filter_version_ = filter->codeVersion();
+    }
+    filter_ = filter;
+}
+
 void ImageProcessingShader::use()
 {
     Shader::use();
@@ -45,6 +94,10 @@ void ImageProcessingShader::use()
     program_->setUniform("gamma", gamma);
     program_->setUniform("levels", levels);
 
+    // uniforms of the filter
+    if (filter_ != nullptr)
+        filter_->setFilterUniforms(program_);
+
 }
 
 void ImageProcessingShader::reset()
@@ -83,3 +136,22 @@ void ImageProcessingShader::accept(Visitor& v)
 //    Shader::accept(v);
     v.visit(*this);
 }
+
+size_t ImageProcessingShader::hash() const
+{
+    size_t h = Shader::hash();
+    h = BaseToolkit::hash( &brightness, sizeof(float), h );
+    h = BaseToolkit::hash( &contrast, sizeof(float), h );
+    h = BaseToolkit::hash( &saturation, sizeof(float), h );
+    h = BaseToolkit::hash( &hueshift, sizeof(float), h );
+    h = BaseToolkit::hash( &threshold, sizeof(float), h );
+    h = BaseToolkit::hash( glm::value_ptr(gamma), sizeof(glm::vec4), h );
+    h = BaseToolkit::hash( glm::value_ptr(levels), sizeof(glm::vec4), h );
+    h = BaseToolkit::hash( &nbColors, sizeof(int), h );
+    h = BaseToolkit::hash( &invert, sizeof(int), h );
+    // fused filter and its code
+    h = BaseToolkit::hash( &filter_, sizeof(ImageFilteringShader *), h );
+    if (filter_ != nullptr)
+        h = BaseToolkit::hash( &filter_version_, sizeof(uint), h );
+    return h;
+}
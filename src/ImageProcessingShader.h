@@ -3,6 +3,8 @@
 
 #include "Shader.h"
 
+class ImageFilteringShader;
+
 class ImageProcessingShader : public Shader
 {
 public:
@@ -14,6 +16,7 @@ public:
     void accept(Visitor& v) override;
 
     void copy(ImageProcessingShader const& S);
+    size_t hash() const override;
 
     // color effects
     float brightness; // [-1 1]
@@ -28,6 +31,14 @@ public:
     int nbColors;
     int invert;
 
+    // per pixel filter applied before color correction, in the same pass
+    // (nullptr to apply color correction only)
+    void setFilter(ImageFilteringShader *filter);
+    inline ImageFilteringShader *filter() const { return filter_; }
+
+private:
+    ImageFilteringShader *filter_;
+    uint filter_version_;
 };
 
 
@@ -24,6 +24,7 @@
 #include "defines.h"
 #include "Visitor.h"
 #include "Resource.h"
+#include "BaseToolkit.h"
 #include "IconsFontAwesome5.h"
 
 #include "ImageShader.h"
@@ -38,6 +39,10 @@ std::vector< ShadingProgram > maskPrograms = {
     ShadingProgram("shaders/simple.vs", "shaders/mask_horizontal.fs"),
     ShadingProgram("shaders/simple.vs", "shaders/mask_vertical.fs")
 };
+ShadingProgram yuvShadingProgram("shaders/texture.vs", "shaders/image_yuv.fs");
+ShadingProgram yuvPackShadingProgram("shaders/texture.vs", "shaders/image_rgb2yuv.fs");
+ShadingProgram historyStoreShadingProgram("shaders/texture.vs", "shaders/history_store.fs");
+ShadingProgram historyRestoreShadingProgram("shaders/texture.vs", "shaders/history_restore.fs");
 
 const char* MaskShader::mask_icons[4]  = { ICON_FA_WINDOW_CLOSE, ICON_FA_EDIT, ICON_FA_SHAPES, ICON_FA_CLONE };
 const char* MaskShader::mask_names[4]  = { "No mask", "Paint mask", "Shape mask", "Source mask" };
@@ -95,6 +100,13 @@ void ImageShader::accept(Visitor& v) {
     v.visit(*this);
 }
 
+size_t ImageShader::hash() const
+{
+    size_t h = BaseToolkit::hash( &mask_texture, sizeof(uint), Shader::hash() );
+    h = BaseToolkit::hash( &stipple, sizeof(float), h );
+    return BaseToolkit::hash( glm::value_ptr(iNodes), sizeof(glm::mat4), h );
+}
+
 
 MaskShader::MaskShader(): Shader(), mode(0)
 {
@@ -160,3 +172,148 @@ void MaskShader::accept(Visitor& v) {
 }
 
 
+
+
+YUVShader::YUVShader(): Shader(), format(I420)
+{
+    // static program shader
+    program_ = &yuvShadingProgram;
+    // reset instance
+    YUVShader::reset();
+}
+
+void YUVShader::use()
+{
+    Shader::use();
+
+    // set conversion
+    program_->setUniform("format", (int) format);
+    program_->setUniform("yuvMatrix", yuvMatrix);
+    program_->setUniform("iChannel2", 2);
+
+    // setup chroma textures (NV12 has only one plane for UV)
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture  (GL_TEXTURE_2D, plane_texture[0]);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture  (GL_TEXTURE_2D, format == NV12 ? 0 : plane_texture[1]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void YUVShader::reset()
+{
+    Shader::reset();
+
+    // opaque video
+    blending = BLEND_NONE;
+    format = I420;
+    plane_texture[0] = plane_texture[1] = 0;
+
+    // default to ITU-R BT.601, limited range
+    setColorimetry(0.299f, 0.114f);
+}
+
+void YUVShader::setColorimetry(float Kr, float Kb, bool fullrange)
+{
+    yuvMatrix = conversionMatrix(Kr, Kb, fullrange);
+}
+
+glm::mat4 YUVShader::conversionMatrix(float Kr, float Kb, bool fullrange)
+{
+    // Y'CbCr to R'G'B' matrix for coefficients Kr, Kb
+    const float Kg = 1.f - Kr - Kb;
+    glm::mat3 M = glm::mat3( glm::vec3( 1.f, 1.f, 1.f ),                                           // column Y
+                             glm::vec3( 0.f, -2.f * Kb * (1.f - Kb) / Kg, 2.f * (1.f - Kb) ),      // column Cb
+                             glm::vec3( 2.f * (1.f - Kr), -2.f * Kr * (1.f - Kr) / Kg, 0.f ) );    // column Cr
+
+    // scale and offset of 8 bits values
+    glm::vec3 scale  = fullrange ? glm::vec3(1.f) : glm::vec3(255.f / 219.f, 255.f / 224.f, 255.f / 224.f);
+    glm::vec3 offset = fullrange ? glm::vec3(0.f, 128.f / 255.f, 128.f / 255.f)
+                                 : glm::vec3(16.f / 255.f, 128.f / 255.f, 128.f / 255.f);
+
+    // RGB = M * scale * (YUV - offset), written as a 4x4 matrix applied to (Y, U, V, 1)
+    glm::mat3 MS = M * glm::mat3( glm::vec3(scale.x, 0.f, 0.f),
+                                  glm::vec3(0.f, scale.y, 0.f),
+                                  glm::vec3(0.f, 0.f, scale.z) );
+    glm::mat4 conversion = glm::mat4( MS );
+    conversion[3] = glm::vec4( -(MS * offset), 1.f );
+
+    return conversion;
+}
+
+YUVPackShader::YUVPackShader(): Shader(), format(YUVShader::I420)
+{
+    // static program shader
+    program_ = &yuvPackShadingProgram;
+    // reset instance
+    YUVPackShader::reset();
+}
+
+void YUVPackShader::use()
+{
+    Shader::use();
+
+    // set layout of planes and conversion
+    program_->setUniform("format", (int) format);
+    program_->setUniform("frameSize", frameSize);
+    program_->setUniform("offsetU", (int) plane_offset[0]);
+    program_->setUniform("offsetV", (int) plane_offset[1]);
+    program_->setUniform("strideY", (int) plane_stride[0]);
+    program_->setUniform("strideUV", (int) plane_stride[1]);
+    program_->setUniform("rgbMatrix", rgbMatrix);
+}
+
+void YUVPackShader::reset()
+{
+    Shader::reset();
+
+    // pixels are written as is
+    blending = BLEND_NONE;
+    format = YUVShader::I420;
+    frameSize = glm::vec2(1.f);
+    plane_offset[0] = plane_offset[1] = 0;
+    plane_stride[0] = plane_stride[1] = 0;
+
+    // default to ITU-R BT.601, limited range
+    setColorimetry(0.299f, 0.114f);
+}
+
+void YUVPackShader::setColorimetry(float Kr, float Kb, bool fullrange)
+{
+    // RGB to YUV is the inverse of the YUV to RGB conversion
+    rgbMatrix = glm::inverse( YUVShader::conversionMatrix(Kr, Kb, fullrange) );
+}
+
+HistoryShader::HistoryShader(Modes m): Shader(), mode_(m)
+{
+    // static program shader
+    program_ = mode_ == RESTORE ? &historyRestoreShadingProgram : &historyStoreShadingProgram;
+    // reset instance
+    HistoryShader::reset();
+}
+
+void HistoryShader::use()
+{
+    Shader::use();
+
+    program_->setUniform("compact", compact);
+
+    // setup array texture of stored images
+    if (mode_ == RESTORE) {
+        program_->setUniform("iHistory", 1);
+        program_->setUniform("layer", layer);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture  (GL_TEXTURE_2D_ARRAY, history_texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+void HistoryShader::reset()
+{
+    Shader::reset();
+
+    // pixels are written as is
+    blending = BLEND_NONE;
+    compact = true;
+    history_texture = 0;
+    layer = 0;
+}
@@ -17,6 +17,7 @@ public:
     void reset() override;
     void accept(Visitor& v) override;
     void copy(ImageShader const& S);
+    size_t hash() const override;
 
     uint mask_texture;
 
@@ -67,4 +68,94 @@ public:
     static const char* mask_shapes[5];
 };
 
+class YUVShader : public Shader
+{
+
+public:
+    YUVShader();
+
+    void use() override;
+    void reset() override;
+
+    enum Formats {
+        I420 = 0,
+        NV12 = 1
+    };
+    uint format;
+
+    // textures of chroma planes
+    // (luma plane is the texture of the surface)
+    uint plane_texture[2];
+
+    // set YUV to RGB conversion matrix
+    // from luma coefficients Kr and Kb, and range
+    void setColorimetry(float Kr, float Kb, bool fullrange = false);
+    static glm::mat4 conversionMatrix(float Kr, float Kb, bool fullrange = false);
+
+    // uniforms
+    glm::mat4 yuvMatrix;
+};
+
+/**
+ * @brief The YUVPackShader class converts an RGB image into the
+ * planes of a YUV image (I420 or NV12), packed in an RGBA frame buffer
+ * so that its readback gives the bytes of the YUV image in memory order.
+ */
+class YUVPackShader : public Shader
+{
+
+public:
+    YUVPackShader();
+
+    void use() override;
+    void reset() override;
+
+    // YUVShader::Formats
+    uint format;
+
+    // layout of the YUV image in memory (in bytes)
+    // offset of U and V planes (UV plane for NV12)
+    uint plane_offset[2];
+    // stride of luma and chroma planes
+    uint plane_stride[2];
+
+    // set RGB to YUV conversion matrix
+    // from luma coefficients Kr and Kb, and range
+    void setColorimetry(float Kr, float Kb, bool fullrange = false);
+
+    // uniforms
+    glm::vec2 frameSize;
+    glm::mat4 rgbMatrix;
+};
+
+/**
+ * @brief The HistoryShader class stores images in the layers of an
+ * array texture, and restores them. Opaque images are stored in compact
+ * form (YCoCg with chroma subsampled in a checkerboard pattern, 2 bytes
+ * per pixel), images with alpha are stored in RGBA.
+ */
+class HistoryShader : public Shader
+{
+
+public:
+    enum Modes {
+        STORE = 0,
+        RESTORE = 1
+    };
+    HistoryShader(Modes m = STORE);
+
+    void use() override;
+    void reset() override;
+
+    // compact storage (otherwise RGBA)
+    bool compact;
+
+    // array texture and layer to restore
+    uint history_texture;
+    int layer;
+
+private:
+    Modes mode_;
+};
+
 #endif // IMAGESHADER_H
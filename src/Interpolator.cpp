@@ -20,158 +20,219 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
 **/
 
+#include <algorithm>
+#include <cmath>
+
 #include "defines.h"
 #include "Log.h"
 #include "Source.h"
 #include "ImageProcessingShader.h"
-#include "UpdateCallback.h"
 
 #include "Interpolator.h"
 
+// offsets of parameters in the flat array of a source
+#define INTERPOLATOR_VIEW_STRIDE 13
+#define INTERPOLATOR_PROCESSING  (4 * INTERPOLATOR_VIEW_STRIDE)
+#define INTERPOLATOR_INVERT      (INTERPOLATOR_PROCESSING + 14)
 
-SourceInterpolator::SourceInterpolator(Source *subject, const SourceCore &target) :
-    subject_(subject), from_(static_cast<SourceCore>(*subject)), to_(target), current_cursor_(0.f)
-{
+static const View::Mode interpolated_views[4] = { View::MIXING, View::GEOMETRY, View::LAYER, View::TEXTURE };
 
+void Interpolator::pack(const SourceCore &s, float *p)
+{
+    for (int v = 0; v < 4; ++v) {
+        const Group *g = s.group(interpolated_views[v]);
+        float *q = p + v * INTERPOLATOR_VIEW_STRIDE;
+        for (int i = 0; i < 3; ++i) {
+            q[i]     = g->translation_[i];
+            q[3 + i] = g->scale_[i];
+            q[6 + i] = g->rotation_[i];
+        }
+        for (int i = 0; i < 4; ++i)
+            q[9 + i] = g->crop_[i];
+    }
 
+    const ImageProcessingShader *ip = s.processingShader();
+    float *q = p + INTERPOLATOR_PROCESSING;
+    q[0] = ip->brightness;
+    q[1] = ip->contrast;
+    q[2] = ip->saturation;
+    q[3] = ip->hueshift;
+    q[4] = ip->threshold;
+    q[5] = (float) ip->nbColors;
+    for (int i = 0; i < 4; ++i) {
+        q[6 + i]  = ip->gamma[i];
+        q[10 + i] = ip->levels[i];
+    }
+    p[INTERPOLATOR_INVERT] = (float) ip->invert;
 }
 
-
-void SourceInterpolator::interpolateGroup(View::Mode m)
+void Interpolator::unpack(const float *p, Source *s)
 {
-    current_state_.group(m)->translation_ =
-            (1.f - current_cursor_) * from_.group(m)->translation_
-            + current_cursor_ * to_.group(m)->translation_;
-    current_state_.group(m)->scale_ =
-            (1.f - current_cursor_) * from_.group(m)->scale_
-            + current_cursor_ * to_.group(m)->scale_;
-    current_state_.group(m)->rotation_ =
-            (1.f - current_cursor_) * from_.group(m)->rotation_
-            + current_cursor_ * to_.group(m)->rotation_;
-    current_state_.group(m)->crop_ =
-            (1.f - current_cursor_) * from_.group(m)->crop_
-            + current_cursor_ * to_.group(m)->crop_;
-
-    CopyCallback *anim = new CopyCallback( current_state_.group(m) );
-    subject_->group(m)->update_callbacks_.clear();
-    subject_->group(m)->update_callbacks_.push_back(anim);
+    for (int v = 0; v < 4; ++v) {
+        Group *g = s->group(interpolated_views[v]);
+        const float *q = p + v * INTERPOLATOR_VIEW_STRIDE;
+        g->translation_ = glm::vec3(q[0], q[1], q[2]);
+        g->scale_ = glm::vec3(q[3], q[4], q[5]);
+        g->rotation_ = glm::vec3(q[6], q[7], q[8]);
+        g->crop_ = glm::vec4(q[9], q[10], q[11], q[12]);
+    }
+
+    ImageProcessingShader *ip = s->processingShader();
+    const float *q = p + INTERPOLATOR_PROCESSING;
+    ip->brightness = q[0];
+    ip->contrast = q[1];
+    ip->saturation = q[2];
+    ip->hueshift = q[3];
+    ip->threshold = q[4];
+    ip->nbColors = (int) std::round(q[5]);
+    ip->gamma = glm::vec4(q[6], q[7], q[8], q[9]);
+    ip->levels = glm::vec4(q[10], q[11], q[12], q[13]);
+    ip->invert = (int) p[INTERPOLATOR_INVERT];
+
+    s->touch();
 }
 
-void SourceInterpolator::interpolateImageProcessing()
+Interpolator::Interpolator() : keys_(1), cores_(1), current_cursor_(0.f)
 {
-    current_state_.processingShader()->brightness =
-            (1.f - current_cursor_) * from_.processingShader()->brightness
-            + current_cursor_ * to_.processingShader()->brightness;
-
-    current_state_.processingShader()->contrast =
-            (1.f - current_cursor_) * from_.processingShader()->contrast
-            + current_cursor_ * to_.processingShader()->contrast;
-
-    current_state_.processingShader()->saturation =
-            (1.f - current_cursor_) * from_.processingShader()->saturation
-            + current_cursor_ * to_.processingShader()->saturation;
-
-    current_state_.processingShader()->hueshift =
-            (1.f - current_cursor_) * from_.processingShader()->hueshift
-            + current_cursor_ * to_.processingShader()->hueshift;
-
-    current_state_.processingShader()->threshold =
-            (1.f - current_cursor_) * from_.processingShader()->threshold
-            + current_cursor_ * to_.processingShader()->threshold;
-
-    current_state_.processingShader()->nbColors =
-            (1.f - current_cursor_) * from_.processingShader()->nbColors
-            + current_cursor_ * to_.processingShader()->nbColors;
-
-    current_state_.processingShader()->gamma =
-            (1.f - current_cursor_) * from_.processingShader()->gamma
-            + current_cursor_ * to_.processingShader()->gamma;
 
-    current_state_.processingShader()->levels =
-            (1.f - current_cursor_) * from_.processingShader()->levels
-            + current_cursor_ * to_.processingShader()->levels;
-
-    subject_->processingShader()->copy( *current_state_.processingShader() );
-
-// not interpolated : invert , filterid
 }
 
-float SourceInterpolator::current() const
+Interpolator::~Interpolator()
 {
-    return current_cursor_;
+    clear();
 }
 
-void SourceInterpolator::apply(float percent)
+void Interpolator::clear()
 {
-    percent = CLAMP( percent, 0.f, 1.f);
-
-    if ( subject_ && ABS_DIFF(current_cursor_, percent) > EPSILON)
-    {
-        current_cursor_ = percent;
-
-        if (current_cursor_ < EPSILON) {
-            current_cursor_ = 0.f;
-            current_state_ = from_;
-            subject_->copy(current_state_);
-        }
-        else if (current_cursor_ > 1.f - EPSILON) {
-            current_cursor_ = 1.f;
-            current_state_ = to_;
-            subject_->copy(current_state_);
-        }
-        else {
-            interpolateGroup(View::MIXING);
-            interpolateGroup(View::GEOMETRY);
-            interpolateGroup(View::LAYER);
-            interpolateGroup(View::TEXTURE);
-            interpolateImageProcessing();
-//            Log::Info("SourceInterpolator::update %f", cursor);
-        }
-
-        subject_->touch();
-    }
+    sources_.clear();
+    index_.clear();
+    keys_.assign(1, std::vector<float>());
+    cores_.assign(1, std::vector<SourceCore>());
+    state_.clear();
+    weights_.clear();
+    current_cursor_ = 0.f;
 }
 
-Interpolator::Interpolator()
+void Interpolator::add (Source *s)
 {
-
+    if (!s || index_.count(s->id()) > 0)
+        return;
+
+    index_[s->id()] = sources_.size();
+    sources_.push_back(s);
+
+    // all keys start with the current state of the source
+    std::vector<float> p(INTERPOLATOR_STRIDE, 0.f);
+    pack(*s, p.data());
+    for (auto k = keys_.begin(); k != keys_.end(); ++k)
+        k->insert(k->end(), p.begin(), p.end());
+    state_.insert(state_.end(), p.begin(), p.end());
+    for (auto c = cores_.begin(); c != cores_.end(); ++c)
+        c->push_back( static_cast<SourceCore>(*s) );
+
+    weights_.clear();
 }
 
-Interpolator::~Interpolator()
+size_t Interpolator::addKey ()
 {
-    clear();
+    keys_.push_back( keys_.front() );
+    cores_.push_back( cores_.front() );
+    weights_.clear();
+
+    return keys_.size() - 1;
 }
 
-void Interpolator::clear()
+void Interpolator::set (size_t key, uint64_t id, const SourceCore &target)
 {
-    for (auto i = interpolators_.begin(); i != interpolators_.end(); ) {
-        delete *i;
-        i = interpolators_.erase(i);
+    auto i = index_.find(id);
+    if ( key < keys_.size() && i != index_.end() ) {
+        pack(target, keys_[key].data() + i->second * INTERPOLATOR_STRIDE);
+        cores_[key][i->second] = target;
+        weights_.clear();
     }
 }
 
-
-void Interpolator::add (Source *s, const SourceCore &target)
+float Interpolator::current() const
 {
-    SourceInterpolator *i = new SourceInterpolator(s, target);
-    interpolators_.push_back(i);
+    return current_cursor_;
 }
 
-
-float Interpolator::current() const
+void Interpolator::apply(float percent)
 {
-    float ret = 0.f;
-    if (interpolators_.size() > 0)
-        ret = interpolators_.front()->current();
+    percent = CLAMP( percent, 0.f, 1.f);
+
+    if ( keys_.size() > 1 && ABS_DIFF(current_cursor_, percent) > EPSILON ) {
 
-    return ret;
+        // snap to keys at the extremities
+        if (percent < EPSILON)
+            percent = 0.f;
+        else if (percent > 1.f - EPSILON)
+            percent = 1.f;
+
+        std::vector<float> w(keys_.size(), 0.f);
+        w[0] = 1.f - percent;
+        w[1] = percent;
+        blend(w);
+
+        current_cursor_ = percent;
+    }
 }
 
-void Interpolator::apply(float percent)
+void Interpolator::blend(const std::vector<float> &weights)
 {
-    for (auto i = interpolators_.begin(); i != interpolators_.end(); ++i)
-        (*i)->apply( percent );
+    if (sources_.empty())
+        return;
+
+    // normalized weights, one per key
+    std::vector<float> w(keys_.size(), 0.f);
+    float sum = 0.f;
+    for (size_t k = 0; k < w.size() && k < weights.size(); ++k) {
+        w[k] = MAX(weights[k], 0.f);
+        sum += w[k];
+    }
+    if (sum < EPSILON) {
+        w[0] = 1.f;
+        sum = 1.f;
+    }
+    size_t dominant = 0;
+    for (size_t k = 0; k < w.size(); ++k) {
+        w[k] /= sum;
+        if (w[k] > w[dominant])
+            dominant = k;
+    }
 
-}
+    // nothing to do if weights did not change
+    if ( w.size() == weights_.size() && std::equal(w.begin(), w.end(), weights_.begin(),
+                    [](float a, float b) { return ABS_DIFF(a, b) < EPSILON; }) )
+        return;
+    weights_ = w;
+
+    // a key with all the weight is restored entirely
+    if ( w[dominant] > 1.f - EPSILON ) {
+        for (size_t s = 0; s < sources_.size(); ++s) {
+            sources_[s]->copy( cores_[dominant][s] );
+            sources_[s]->touch();
+        }
+        return;
+    }
 
+    // weighted sum of the flat arrays of keys
+    const size_t n = state_.size();
+    float * __restrict__ out = state_.data();
+    std::fill(out, out + n, 0.f);
+    for (size_t k = 0; k < keys_.size(); ++k) {
+        if (w[k] < EPSILON)
+            continue;
+        const float * __restrict__ in = keys_[k].data();
+        const float a = w[k];
+        for (size_t i = 0; i < n; ++i)
+            out[i] += a * in[i];
+    }
 
+    // apply to sources; discrete parameters come from the dominant key
+    for (size_t s = 0; s < sources_.size(); ++s) {
+        float *p = out + s * INTERPOLATOR_STRIDE;
+        p[INTERPOLATOR_INVERT] = keys_[dominant][s * INTERPOLATOR_STRIDE + INTERPOLATOR_INVERT];
+        unpack(p, sources_[s]);
+    }
+}
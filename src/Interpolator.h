@@ -1,29 +1,26 @@
 #ifndef INTERPOLATOR_H
 #define INTERPOLATOR_H
 
+#include <map>
+#include <vector>
+
 #include "Source.h"
 #include "SourceList.h"
 
-class SourceInterpolator
-{
-public:
-    SourceInterpolator(Source *subject, const SourceCore &target);
-
-    void apply (float percent);
-    float current() const;
-
-protected:
-    Source *subject_;
-
-    SourceCore from_;
-    SourceCore to_;
-    SourceCore current_state_;
-    float current_cursor_;
-
-    void interpolateGroup (View::Mode m);
-    void interpolateImageProcessing ();
-};
-
+// Number of interpolated parameters of a source: transform and crop in
+// 4 views (4 x 13) and image processing (14), padded for vector units
+#define INTERPOLATOR_STRIDE 72
+
+//
+// Interpolator of the state of sources between keys
+//
+// The parameters of all sources are packed in one flat array of floats per
+// key, where the first key is the state of sources when the interpolator
+// was created. Interpolation is a weighted sum of these arrays, written
+// with plain contiguous loops the compiler vectorizes.
+// A full copy of the state of sources is also kept for each key, and is
+// restored when a key has all the weight.
+//
 class Interpolator
 {
 public:
@@ -31,14 +28,34 @@ public:
     ~Interpolator();
 
     void clear ();
-    void add (Source *s, const SourceCore &target );
 
+    // add a source; its current state is given to all keys
+    void add (Source *s);
+    // add a key, initialized with the current state of all sources
+    size_t addKey ();
+    // set the target state of a source in a key
+    void set (size_t key, uint64_t id, const SourceCore &target);
+    inline size_t numKeys () const { return keys_.size(); }
+    inline const std::vector<Source *> &sources () const { return sources_; }
+
+    // interpolate between the first key (percent 0) and the second (percent 1)
     void apply (float percent);
-    float current() const;
+    float current () const;
+
+    // weighted blend of all keys, one weight per key
+    void blend (const std::vector<float> &weights);
 
 protected:
-    std::list<SourceInterpolator *> interpolators_;
+    std::vector<Source *> sources_;
+    std::map<uint64_t, size_t> index_;
+    std::vector< std::vector<float> > keys_;
+    std::vector< std::vector<SourceCore> > cores_;
+    std::vector<float> state_;
+    std::vector<float> weights_;
+    float current_cursor_;
 
+    static void pack (const SourceCore &s, float *p);
+    static void unpack (const float *p, Source *s);
 };
 
 #endif // INTERPOLATOR_H
@@ -19,7 +19,16 @@
 
 #include <string>
 #include <list>
-#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 using namespace std;
 
 #include "defines.h"
@@ -27,43 +36,348 @@ using namespace std;
 #include "DialogToolkit.h"
 #include "Log.h"
 
+#define LOG_CAPACITY 1024           // records in the ring
+#define LOG_MAX_LENGTH 1024         // characters of a record
+#define LOG_MAX_SUBSYSTEM 16        // characters of a subsystem name
+#define LOG_HISTORY 4096            // lines displayed in the log window
+#define LOG_RATE_SLOTS 256          // distinct messages watched by rate limiter
+#define LOG_RATE_BURST 20           // same messages accepted per second
+#define LOG_FILE_MAX_SIZE 10485760  // 10 MB per log file
+#define LOG_FILE_COUNT 3            // number of rotated log files kept
+
+typedef enum {
+    LEVEL_INFO = 0,
+    LEVEL_NOTIFY,
+    LEVEL_WARNING,
+    LEVEL_ERROR
+} LogLevel;
+
+const char *log_level_prefix[4] = { "", ICON_FA_INFO_CIRCLE " ", ICON_FA_EXCLAMATION_TRIANGLE " Warning - ", "Error - " };
+const char *log_level_name[4] = { "INFO", "NOTIFY", "WARNING", "ERROR" };
+
+//
+// Fixed capacity ring of log records, written by any thread without lock
+//
+// Each writer takes a ticket, and the record at (ticket % LOG_CAPACITY) is
+// protected by its sequence number: odd while being written, and equal to
+// 2 * (ticket + 1) when ready. A writer only takes the record once the
+// writer of the previous round is done with it, and gives up if a writer
+// of a later round already took it. Readers never lock; they copy a record
+// and check that its sequence did not change during the copy. Records not
+// read before the ring wraps around are lost (and counted).
+//
+struct LogRecord
+{
+    std::atomic<uint64_t> sequence;
+    LogLevel level;
+    uint64_t timestamp;     // microseconds since epoch
+    size_t   thread;
+    char     subsystem[LOG_MAX_SUBSYSTEM];
+    char     text[LOG_MAX_LENGTH];
+};
+
+LogRecord log_ring[LOG_CAPACITY];
+std::atomic<uint64_t> log_ring_head(0);
+
+thread_local char thread_subsystem[LOG_MAX_SUBSYSTEM] = "";
+
+void ring_write(LogLevel level, const char *text)
+{
+    uint64_t ticket = log_ring_head.fetch_add(1, std::memory_order_relaxed);
+    LogRecord &r = log_ring[ticket % LOG_CAPACITY];
+
+    // take the record when it is not being written
+    uint64_t s = r.sequence.load(std::memory_order_relaxed);
+    for (;;) {
+        // a writer of a later round has it: our record is lost
+        if (s > 2 * ticket)
+            return;
+        // a writer of a previous round is still writing
+        if (s % 2) {
+            std::this_thread::yield();
+            s = r.sequence.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (r.sequence.compare_exchange_weak(s, 2 * ticket + 1, std::memory_order_acquire))
+            break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    r.level = level;
+    r.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    r.thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    memcpy(r.subsystem, thread_subsystem, LOG_MAX_SUBSYSTEM);
+    snprintf(r.text, LOG_MAX_LENGTH, "%s", text);
+
+    r.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+void ring_printf(LogLevel level, const char *fmt, ...)
+{
+    char text[LOG_MAX_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, LOG_MAX_LENGTH, fmt, args);
+    va_end(args);
+    ring_write(level, text);
+}
+
+// read record of given ticket into copy
+// returns 1 if read, 0 if not written yet, -1 if lost (overwritten)
+int ring_read(uint64_t ticket, LogRecord &copy)
+{
+    const LogRecord &r = log_ring[ticket % LOG_CAPACITY];
+    const uint64_t ready = 2 * ticket + 2;
+
+    uint64_t before = r.sequence.load(std::memory_order_acquire);
+    if (before < ready)
+        return 0;
+    if (before > ready)
+        return -1;
+
+    copy.level = r.level;
+    copy.timestamp = r.timestamp;
+    copy.thread = r.thread;
+    memcpy(copy.subsystem, r.subsystem, LOG_MAX_SUBSYSTEM);
+    memcpy(copy.text, r.text, LOG_MAX_LENGTH);
+    copy.subsystem[LOG_MAX_SUBSYSTEM-1] = '\0';
+    copy.text[LOG_MAX_LENGTH-1] = '\0';
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = r.sequence.load(std::memory_order_relaxed);
+    return after == before ? 1 : -1;
+}
+
+// read all available records after the cursor, and call fun for each
+// returns number of records lost
+template <typename F>
+uint64_t ring_drain(uint64_t &cursor, LogRecord &copy, F fun)
+{
+    uint64_t lost = 0;
+    uint64_t head = log_ring_head.load(std::memory_order_acquire);
+
+    // skip records already overwritten
+    if (head > cursor + LOG_CAPACITY) {
+        lost += head - LOG_CAPACITY - cursor;
+        cursor = head - LOG_CAPACITY;
+    }
+
+    while (cursor < head) {
+        int r = ring_read(cursor, copy);
+        // stop at record not finished
+        if (r == 0)
+            break;
+        if (r > 0)
+            fun(copy);
+        else
+            ++lost;
+        ++cursor;
+    }
+
+    return lost;
+}
+
+//
+// Rate limiter of repeated information messages, identified by their text
+//
+struct RateEntry
+{
+    std::atomic<size_t> key;
+    std::atomic<uint64_t> second;
+    std::atomic<uint32_t> count;
+};
+
+RateEntry log_rates[LOG_RATE_SLOTS];
+
+// returns -1 if message should be dropped,
+// or the number of messages dropped previously
+int rate_limit(const char *text)
+{
+    const size_t key = std::hash<std::string>{}(text);
+    RateEntry &e = log_rates[ key % LOG_RATE_SLOTS ];
+    uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // new message in this slot
+    if (e.key.exchange(key) != key) {
+        e.second = now;
+        e.count = 1;
+        return 0;
+    }
+
+    // new period for this message: report messages dropped in previous one
+    if (e.second.exchange(now) != now) {
+        uint32_t c = e.count.exchange(1);
+        return c > LOG_RATE_BURST ? (int) (c - LOG_RATE_BURST) : 0;
+    }
+
+    return e.count.fetch_add(1) < LOG_RATE_BURST ? 0 : -1;
+}
+
+void log_write(LogLevel level, const char *fmt, va_list args)
+{
+    char text[LOG_MAX_LENGTH];
+    vsnprintf(text, LOG_MAX_LENGTH, fmt, args);
+
+    // warnings and notifications are never skipped
+    int dropped = level == LEVEL_INFO ? rate_limit(text) : 0;
+    if (dropped < 0)
+        return;
+
+    if (dropped > 0)
+        ring_printf(level, "(%d similar messages skipped) %s", dropped, text);
+    else
+        ring_write(level, text);
+}
+
+void Log::SetSubsystem(const char *name)
+{
+    snprintf(thread_subsystem, LOG_MAX_SUBSYSTEM, "%s", name);
+}
 
-static std::mutex mtx;
+//
+// Asynchronous file sink, with rotation of files
+//
+std::string log_filename;
+std::thread log_file_thread;
+std::atomic<bool> log_file_running(false);
+
+void rotate_log_files()
+{
+    for (int i = LOG_FILE_COUNT - 1; i > 0; --i) {
+        std::string from = i > 1 ? log_filename + "." + std::to_string(i - 1) : log_filename;
+        std::string to = log_filename + "." + std::to_string(i);
+        std::rename(from.c_str(), to.c_str());
+    }
+}
+
+void write_log_file()
+{
+    Log::SetSubsystem("Log");
+
+    FILE *file = fopen(log_filename.c_str(), "a");
+    if (file == nullptr)
+        return;
+
+    // start with the logs still in the ring
+    uint64_t cursor = log_ring_head.load() > LOG_CAPACITY ? log_ring_head.load() - LOG_CAPACITY : 0;
+    LogRecord copy;
+
+    bool running = true;
+    while (running) {
+        running = log_file_running.load();
+
+        uint64_t lost = ring_drain(cursor, copy, [file](const LogRecord &r){
+            time_t t = (time_t) (r.timestamp / 1000000);
+            char date[32];
+            strftime(date, 32, "%Y-%m-%d %H:%M:%S", localtime(&t));
+            fprintf(file, "%s.%03d %-7s [%04x %s] %s\n", date, (int) (r.timestamp / 1000 % 1000),
+                    log_level_name[r.level], (unsigned) (r.thread & 0xFFFF), r.subsystem, r.text);
+        });
+        if (lost > 0)
+            fprintf(file, "%lu messages lost\n", (unsigned long) lost);
+        fflush(file);
+
+        // rotate files when too big
+        if (ftell(file) > LOG_FILE_MAX_SIZE) {
+            fclose(file);
+            rotate_log_files();
+            file = fopen(log_filename.c_str(), "w");
+            if (file == nullptr)
+                return;
+        }
+
+        if (running)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    fclose(file);
+}
+
+void Log::SetLogFile(const char *filename)
+{
+    Log::Terminate();
+
+    if (filename == nullptr || strlen(filename) < 1)
+        return;
+
+    log_filename = std::string(filename);
+    log_file_running = true;
+    log_file_thread = std::thread(write_log_file);
+
+    // ensure the thread is joined on any exit (before its destruction)
+    static bool terminate_at_exit = false;
+    if (!terminate_at_exit)
+        terminate_at_exit = std::atexit(Log::Terminate) == 0;
+
+    Log::Info("Logging to file %s", filename);
+}
+
+void Log::Terminate()
+{
+    if (log_file_thread.joinable()) {
+        log_file_running = false;
+        log_file_thread.join();
+    }
+}
+
+//
+// Display of logs, only accessed by the rendering thread
+//
+list<string> notifications;
+list<string> warnings;
+float notifications_timeout = 0.f;
 
 struct AppLog
 {
-    ImGuiTextBuffer     Buf;
+    std::deque<string>  Lines;
+    uint64_t            LineNumber;
+    uint64_t            Cursor;
+    LogRecord           Copy;
     ImGuiTextFilter     Filter;
-    ImVector<int>       LineOffsets; 
     bool                LogInTitle;
 
-    AppLog()
+    AppLog() : LineNumber(0), Cursor(0), LogInTitle(false)
     {
-        Clear();
     }
 
     void Clear()
     {
-        mtx.lock();
-        Buf.clear();
-        LineOffsets.clear();
-        LineOffsets.push_back(0);
-        LogInTitle = false;
-        mtx.unlock();
+        Lines.clear();
     }
 
-    void AddLog(const char* fmt, va_list args)
+    void AddLine(const char *text)
     {
-        mtx.lock();
-        int old_size = Buf.size();
-        Buf.appendf("%04d  ", LineOffsets.size()); // this adds 6 characters to show line number
-        Buf.appendfv(fmt, args);
-        Buf.append("\n");
-
-        for (int new_size = Buf.size(); old_size < new_size; old_size++)
-            if (Buf[old_size] == '\n')
-                LineOffsets.push_back(old_size + 1);
-        mtx.unlock();
+        char line[LOG_MAX_LENGTH + 8];
+        snprintf(line, LOG_MAX_LENGTH + 8, "%04d  %s", (int) (LineNumber++ % 10000), text); // this adds 6 characters to show line number
+        Lines.push_back(line);
+        if (Lines.size() > LOG_HISTORY)
+            Lines.pop_front();
+    }
+
+    // read new records from the ring
+    void Update()
+    {
+        uint64_t lost = ring_drain(Cursor, Copy, [this](const LogRecord &r){
+            string text = log_level_prefix[r.level];
+            if (r.subsystem[0] != '\0')
+                text += string("[") + r.subsystem + "] ";
+            text += r.text;
+            AddLine(text.c_str());
+
+            // will display a notification
+            if (r.level == LEVEL_NOTIFY) {
+                notifications.push_back(r.text);
+                notifications_timeout = 0.f;
+            }
+            // will display a warning dialog
+            else if (r.level == LEVEL_WARNING)
+                warnings.push_back(r.text);
+        });
+
+        if (lost > 0)
+            AddLine( (std::to_string(lost) + " messages lost").c_str() );
     }
 
     void Draw(const char* title, bool* p_open = NULL)
@@ -79,11 +393,9 @@ struct AppLog
 
         if (*p_open) {
             // if open but Collapsed, create title of window with last line of logs
-            if (LogInTitle) {
+            if (LogInTitle && !Lines.empty()) {
                 char lastlogline[128];
-                size_t lenght =  LineOffsets[LineOffsets.Size-1] - LineOffsets[LineOffsets.Size-2] - 1;
-                memset(lastlogline, '\0', 128);
-                memcpy(lastlogline, Buf.begin() + LineOffsets[LineOffsets.Size-2], MIN(127, lenght));
+                snprintf(lastlogline, 128, "%s", Lines.back().c_str() + 6);
                 snprintf(window_title, 1024, "%s - %s ###LOGVIMIX", title, lastlogline);
             }
         }
@@ -124,51 +436,28 @@ struct AppLog
         ImGuiToolkit::PushFont(ImGuiToolkit::FONT_MONO);
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
-        mtx.lock();
-
-        const char* buf = Buf.begin();
-        const char* buf_end = Buf.end();
         if (Filter.IsActive())
         {
-            // In this example we don't use the clipper when Filter is enabled.
-            // This is because we don't have a random access on the result on our filter.
-            // A real application processing logs with ten of thousands of entries may want to store the result of search/filter.
-            // especially if the filtering function is not trivial (e.g. reg-exp).
-            for (int line_no = 0; line_no < LineOffsets.Size; line_no++)
+            // no clipper when Filter is enabled (no random access on the result of filter)
+            for (auto it = Lines.begin(); it != Lines.end(); ++it)
             {
-                const char* line_start = buf + LineOffsets[line_no];
-                const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-                if (Filter.PassFilter(line_start, line_end))
-                    ImGui::TextUnformatted(line_start, line_end);
+                if (Filter.PassFilter(it->c_str()))
+                    ImGui::TextUnformatted(it->c_str());
             }
         }
         else
         {
-            // The simplest and easy way to display the entire buffer:
-            //   ImGui::TextUnformatted(buf_begin, buf_end);
-            // And it'll just work. TextUnformatted() has specialization for large blob of text and will fast-forward to skip non-visible lines.
-            // Here we instead demonstrate using the clipper to only process lines that are within the visible area.
-            // If you have tens of thousands of items and their processing cost is non-negligible, coarse clipping them on your side is recommended.
-            // Using ImGuiListClipper requires A) random access into your data, and B) items all being the  same height,
-            // both of which we can handle since we an array pointing to the beginning of each line of text.
-            // When using the filter (in the block of code above) we don't have random access into the data to display anymore, which is why we don't use the clipper.
-            // Storing or skimming through the search result would make it possible (and would be recommended if you want to search through tens of thousands of entries)
+            // use the clipper to only process lines that are within the visible area.
             ImGuiListClipper clipper;
-            clipper.Begin(LineOffsets.Size);
+            clipper.Begin((int) Lines.size());
             while (clipper.Step())
             {
                 for (int line_no = clipper.DisplayStart; line_no < clipper.DisplayEnd; line_no++)
-                {
-                    const char* line_start = buf + LineOffsets[line_no] + (numbering?0:6);
-                    const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-                    ImGui::TextUnformatted(line_start, line_end);
-                }
+                    ImGui::TextUnformatted(Lines[line_no].c_str() + (numbering?0:6));
             }
             clipper.End();
         }
 
-        mtx.unlock();
-
         ImGui::PopStyleVar();
         ImGui::PopFont();
 
@@ -182,58 +471,42 @@ struct AppLog
 };
 
 AppLog logs;
-list<string> notifications;
-list<string> warnings;
-float notifications_timeout = 0.f;
 
 void Log::Info(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    logs.AddLog(fmt, args);
+    log_write(LEVEL_INFO, fmt, args);
     va_end(args);
 }
 
 void Log::ShowLogWindow(bool* p_open)
 {
+    logs.Update();
     logs.Draw( IMGUI_TITLE_LOGS, p_open);
 }
 
 void Log::Notify(const char* fmt, ...)
 {
-    ImGuiTextBuffer buf;
-
     va_list args;
     va_start(args, fmt);
-    buf.appendfv(fmt, args);
+    log_write(LEVEL_NOTIFY, fmt, args);
     va_end(args);
-
-    // will display a notification
-    notifications.push_back(buf.c_str());
-    notifications_timeout = 0.f;
-
-    // always log
-    Log::Info(ICON_FA_INFO_CIRCLE " %s", buf.c_str());
 }
 
 void Log::Warning(const char* fmt, ...)
 {
-    ImGuiTextBuffer buf;
-
     va_list args;
     va_start(args, fmt);
-    buf.appendfv(fmt, args);
+    log_write(LEVEL_WARNING, fmt, args);
     va_end(args);
-
-    // will display a warning dialog
-    warnings.push_back(buf.c_str());
-
-    // always log
-    Log::Info(ICON_FA_EXCLAMATION_TRIANGLE " Warning - %s", buf.c_str());
 }
 
 void Log::Render(bool *showWarnings)
 {
+    // read new logs
+    logs.Update();
+
     bool show_warnings = !warnings.empty();
     bool show_notification = !notifications.empty();
 
@@ -327,15 +600,14 @@ void Log::Render(bool *showWarnings)
 
 void Log::Error(const char* fmt, ...)
 {
-    ImGuiTextBuffer buf;
+    char buf[LOG_MAX_LENGTH];
 
     va_list args;
     va_start(args, fmt);
-    buf.appendfv(fmt, args);
+    vsnprintf(buf, LOG_MAX_LENGTH, fmt, args);
     va_end(args);
 
-    DialogToolkit::ErrorDialog(buf.c_str());
+    DialogToolkit::ErrorDialog(buf);
 
-    Log::Info("Error - %s\n", buf.c_str());
+    ring_printf(LEVEL_ERROR, "%s", buf);
 }
-
@@ -9,6 +9,13 @@ namespace Log
     void Warning(const char* fmt, ...);
     void Error(const char* fmt, ...);
 
+    // name of the subsystem logging from the calling thread
+    void SetSubsystem(const char *name);
+
+    // write logs to a file (asynchronous, rotating)
+    void SetLogFile(const char *filename);
+    void Terminate();
+
     // Draw logs
     void ShowLogWindow(bool* p_open = nullptr);
 
@@ -17,6 +17,13 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
 **/
 
+#include <map>
+#include <deque>
+#include <ctime>
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
+
 #include <gst/gst.h>
 
 //  Desktop OpenGL function loader
@@ -31,6 +38,13 @@
 #include "GstToolkit.h"
 #include "Metronome.h"
 #include "Settings.h"
+#include "FrameBuffer.h"
+#include "Primitives.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "tinyxml2Toolkit.h"
+using namespace tinyxml2;
 
 #include "MediaPlayer.h"
 
@@ -39,6 +53,8 @@
 #endif
 
 #define DISCOVER_TIMOUT 15
+#define MEDIA_INFO_CACHE_FILE "media.xml"
+#define MEDIA_INFO_CACHE_MAX 1000
 
 #if GST_VERSION_MAJOR > 0 && GST_VERSION_MINOR > 18
 #define USE_GST_PLAYBIN
@@ -68,6 +84,7 @@ MediaPlayer::MediaPlayer()
     seeking_ = false;
     rewind_on_disable_ = false;
     force_software_decoding_ = false;
+    yuv_texturing_ = false;
     rate_ = 1.0;
     rate_change_ = RATE_CHANGE_NONE;
     decoder_name_ = "";
@@ -94,8 +111,32 @@ MediaPlayer::MediaPlayer()
     pbo_index_ = 0;
     pbo_next_index_ = 0;
 
+    // no YUV texturing by default
+    yuv_n_planes_ = 0;
+    yuv_format_ = GST_VIDEO_FORMAT_UNKNOWN;
+    yuv_textures_[0] = yuv_textures_[1] = yuv_textures_[2] = 0;
+    yuv_buffer_ = nullptr;
+    yuv_surface_ = nullptr;
+    yuv_shader_ = nullptr;
+
     // OpenGL texture
     textureindex_ = 0;
+    generation_ = 0;
+
+    // no cache of frames by default
+    cache_limit_ = 0;
+    cache_setting_ = 0;
+    cache_size_ = 0;
+    cache_frame_size_ = 0;
+    cache_serving_ = false;
+    cache_filling_ = false;
+    cache_center_ = GST_CLOCK_TIME_NONE;
+    cache_target_ = GST_CLOCK_TIME_NONE;
+    cache_fill_begin_ = GST_CLOCK_TIME_NONE;
+    cache_fill_end_ = GST_CLOCK_TIME_NONE;
+    cache_timer_ = g_timer_new ();
+    preload_ = false;
+    preloaded_ = false;
 }
 
 MediaPlayer::~MediaPlayer()
@@ -109,6 +150,18 @@ MediaPlayer::~MediaPlayer()
     // cleanup picture buffer
     if (pbo_[0])
         glDeleteBuffers(2, pbo_);
+
+    // cleanup YUV planes and conversion
+    for (guint i = 0; i < 3; ++i) {
+        if (yuv_textures_[i])
+            glDeleteTextures(1, &yuv_textures_[i]);
+    }
+    if (yuv_surface_)
+        delete yuv_surface_; // NB: deletes yuv_shader_
+    if (yuv_buffer_)
+        delete yuv_buffer_;
+
+    g_timer_destroy(cache_timer_);
 }
 
 void MediaPlayer::accept(Visitor& v) {
@@ -117,6 +170,10 @@ void MediaPlayer::accept(Visitor& v) {
 
 guint MediaPlayer::texture() const
 {
+    // YUV frames are converted into RGB frame buffer
+    if (yuv_buffer_ != nullptr)
+        return yuv_buffer_->texture();
+
     if (textureindex_ == 0)
         return Resource::getTextureBlack();
 
@@ -125,7 +182,7 @@ guint MediaPlayer::texture() const
 
 #define LIMIT_DISCOVERER
 
-MediaInfo MediaPlayer::UriDiscoverer(const std::string &uri)
+static MediaInfo discoverUri(const std::string &uri)
 {
 #ifdef MEDIA_PLAYER_DEBUG
     Log::Info("Checking uri '%s'", uri.c_str());
@@ -256,7 +313,7 @@ MediaInfo MediaPlayer::UriDiscoverer(const std::string &uri)
 
                 // test audio
                 GList *audios = gst_discoverer_info_get_audio_streams(info);
-                video_stream_info.hasaudio = g_list_length(audios) > 0 && Settings::application.accept_audio;
+                video_stream_info.hasaudio = g_list_length(audios) > 0;
                 gst_discoverer_stream_info_list_free(audios);
             }
 
@@ -283,6 +340,247 @@ MediaInfo MediaPlayer::UriDiscoverer(const std::string &uri)
     return video_stream_info;
 }
 
+// cache of media information, stored in settings directory
+// (up to MEDIA_INFO_CACHE_MAX most recently used files), and validated
+// in background by a new discovery
+struct MediaInfoEntry {
+    unsigned long mtime = 0;
+    unsigned long size = 0;
+    unsigned long used = 0;   // time of last use
+    bool validated = false;
+    MediaInfo media;
+};
+static std::map<std::string, MediaInfoEntry> mediaInfoCache;
+static std::deque<std::string> mediaInfoQueue;
+static std::mutex mediaInfoLock;
+static std::condition_variable mediaInfoCondition;
+static bool mediaInfoChanged = false;
+
+static bool sameMediaInfo(const MediaInfo &a, const MediaInfo &b)
+{
+    return a.width == b.width && a.par_width == b.par_width && a.height == b.height &&
+           a.framerate_n == b.framerate_n && a.framerate_d == b.framerate_d &&
+           a.codec_name == b.codec_name && a.isimage == b.isimage && a.interlaced == b.interlaced &&
+           a.seekable == b.seekable && a.end == b.end && a.hasaudio == b.hasaudio;
+}
+
+// keep only the most recently used entries
+// NB: must be called with mediaInfoLock locked
+static void mediaInfoCachePrune()
+{
+    if (mediaInfoCache.size() <= MEDIA_INFO_CACHE_MAX)
+        return;
+
+    std::vector<unsigned long> used;
+    used.reserve(mediaInfoCache.size());
+    for (auto it = mediaInfoCache.begin(); it != mediaInfoCache.end(); ++it)
+        used.push_back(it->second.used);
+    auto limit = used.end() - MEDIA_INFO_CACHE_MAX;
+    std::nth_element(used.begin(), limit, used.end());
+
+    // (entries used at the same time as the limit are kept)
+    for (auto it = mediaInfoCache.begin(); it != mediaInfoCache.end(); ) {
+        if (it->second.used < *limit)
+            it = mediaInfoCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+// NB: must be called with mediaInfoLock locked
+static void mediaInfoCacheLoad()
+{
+    XMLDocument doc;
+    std::string filename = SystemToolkit::full_filename(SystemToolkit::settings_path(), MEDIA_INFO_CACHE_FILE);
+    if ( XMLResultError(doc.LoadFile(filename.c_str()), false) )
+        return;
+
+    const XMLElement *cache = doc.FirstChildElement("MediaInfoCache");
+    if (cache == nullptr)
+        return;
+
+    for (const XMLElement *m = cache->FirstChildElement("Media"); m; m = m->NextSiblingElement("Media")) {
+        const char *uri = m->Attribute("uri");
+        if (uri == nullptr)
+            continue;
+        // forget files which do not exist anymore
+        gchar *location = gst_uri_get_location(uri);
+        bool exists = location && SystemToolkit::file_exists(location);
+        g_free(location);
+        if (!exists) {
+            mediaInfoChanged = true;
+            continue;
+        }
+        MediaInfoEntry entry;
+        entry.mtime = (unsigned long) m->Unsigned64Attribute("mtime");
+        entry.size  = (unsigned long) m->Unsigned64Attribute("size");
+        entry.used  = (unsigned long) m->Unsigned64Attribute("used");
+        entry.media.width = m->UnsignedAttribute("width");
+        entry.media.par_width = m->UnsignedAttribute("par_width");
+        entry.media.height = m->UnsignedAttribute("height");
+        entry.media.bitrate = m->UnsignedAttribute("bitrate");
+        entry.media.framerate_n = m->UnsignedAttribute("framerate_n");
+        entry.media.framerate_d = m->UnsignedAttribute("framerate_d", 1);
+        entry.media.isimage = m->BoolAttribute("isimage");
+        entry.media.interlaced = m->BoolAttribute("interlaced");
+        entry.media.seekable = m->BoolAttribute("seekable");
+        entry.media.hasaudio = m->BoolAttribute("hasaudio");
+        entry.media.dt = m->Unsigned64Attribute("dt", GST_CLOCK_TIME_NONE);
+        entry.media.end = m->Unsigned64Attribute("end", GST_CLOCK_TIME_NONE);
+        const char *codec = m->Attribute("codec");
+        if (codec)
+            entry.media.codec_name = codec;
+        const char *log = m->Attribute("log");
+        if (log)
+            entry.media.log = log;
+        entry.media.valid = true;
+        mediaInfoCache[uri] = entry;
+    }
+
+    mediaInfoCachePrune();
+}
+
+// NB: must be called with mediaInfoLock locked
+static void mediaInfoCacheSave()
+{
+    mediaInfoCachePrune();
+
+    XMLDocument doc;
+    XMLElement *cache = doc.NewElement("MediaInfoCache");
+    doc.InsertEndChild(cache);
+
+    for (auto it = mediaInfoCache.begin(); it != mediaInfoCache.end(); ++it) {
+        const MediaInfo &media = it->second.media;
+        XMLElement *m = doc.NewElement("Media");
+        m->SetAttribute("uri", it->first.c_str());
+        m->SetAttribute("mtime", (uint64_t) it->second.mtime);
+        m->SetAttribute("size", (uint64_t) it->second.size);
+        m->SetAttribute("used", (uint64_t) it->second.used);
+        m->SetAttribute("width", media.width);
+        m->SetAttribute("par_width", media.par_width);
+        m->SetAttribute("height", media.height);
+        m->SetAttribute("bitrate", media.bitrate);
+        m->SetAttribute("framerate_n", media.framerate_n);
+        m->SetAttribute("framerate_d", media.framerate_d);
+        m->SetAttribute("codec", media.codec_name.c_str());
+        m->SetAttribute("isimage", media.isimage);
+        m->SetAttribute("interlaced", media.interlaced);
+        m->SetAttribute("seekable", media.seekable);
+        m->SetAttribute("hasaudio", media.hasaudio);
+        m->SetAttribute("dt", (uint64_t) media.dt);
+        m->SetAttribute("end", (uint64_t) media.end);
+        if (!media.log.empty())
+            m->SetAttribute("log", media.log.c_str());
+        cache->InsertEndChild(m);
+    }
+
+    XMLSaveDoc(&doc, SystemToolkit::full_filename(SystemToolkit::settings_path(), MEDIA_INFO_CACHE_FILE));
+}
+
+static void mediaInfoValidation()
+{
+    Log::SetSubsystem("Media");
+
+    std::unique_lock<std::mutex> lock(mediaInfoLock);
+
+    while (true) {
+        // wait for a media to validate, or for changes to save
+        mediaInfoCondition.wait(lock, []{ return !mediaInfoQueue.empty() || mediaInfoChanged; });
+
+        if (mediaInfoQueue.empty()) {
+            mediaInfoCacheSave();
+            mediaInfoChanged = false;
+            continue;
+        }
+
+        std::string uri = mediaInfoQueue.front();
+        mediaInfoQueue.pop_front();
+
+        // discover without locking the cache
+        lock.unlock();
+        MediaInfo media = discoverUri(uri);
+        lock.lock();
+
+        auto it = mediaInfoCache.find(uri);
+        if (it == mediaInfoCache.end())
+            continue;
+        it->second.validated = true;
+
+        // update or remove cached information if it was not correct
+        if ( !media.valid || !sameMediaInfo(media, it->second.media) ) {
+            Log::Info("Media information of '%s' changed; reload to update.", uri.c_str());
+            if (media.valid)
+                it->second.media = media;
+            else
+                mediaInfoCache.erase(it);
+            mediaInfoChanged = true;
+        }
+    }
+}
+
+// NB: must be called with mediaInfoLock locked
+static void mediaInfoStart()
+{
+    static bool started = false;
+    if (!started) {
+        started = true;
+        mediaInfoCacheLoad();
+        std::thread(mediaInfoValidation).detach();
+    }
+}
+
+MediaInfo MediaPlayer::UriDiscoverer(const std::string &uri)
+{
+    MediaInfo media;
+
+    // cached information is valid for the same file modification time and size
+    gchar *location = gst_uri_get_location(uri.c_str());
+    std::string path = location ? location : "";
+    g_free(location);
+    unsigned long mtime = SystemToolkit::file_modification_time(path);
+    unsigned long size = SystemToolkit::file_size(path);
+
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(mediaInfoLock);
+        mediaInfoStart();
+
+        auto it = mediaInfoCache.find(uri);
+        if (it != mediaInfoCache.end() && it->second.mtime == mtime && it->second.size == size) {
+            media = it->second.media;
+            it->second.used = (unsigned long) std::time(nullptr);
+            cached = true;
+            // validate once in background
+            if (!it->second.validated) {
+                it->second.validated = true;
+                mediaInfoQueue.push_back(uri);
+                mediaInfoCondition.notify_one();
+            }
+        }
+    }
+
+    // discover media if not in cache
+    if (!cached) {
+        media = discoverUri(uri);
+        if (media.valid) {
+            std::lock_guard<std::mutex> lock(mediaInfoLock);
+            MediaInfoEntry &entry = mediaInfoCache[uri];
+            entry.mtime = mtime;
+            entry.size = size;
+            entry.used = (unsigned long) std::time(nullptr);
+            entry.validated = true;
+            entry.media = media;
+            mediaInfoChanged = true;
+            mediaInfoCondition.notify_one();
+        }
+    }
+
+    // audio is used only if accepted
+    media.hasaudio = media.hasaudio && Settings::application.accept_audio;
+
+    return media;
+}
+
 void MediaPlayer::open (const std::string & filename, const std::string &uri)
 {
     // set path
@@ -439,11 +737,22 @@ void MediaPlayer::execute_open()
     // instruct the sink to send samples synched in time
     gst_base_sink_set_sync (GST_BASE_SINK(sink), true);
 
+    // decide once to use native YUV frames for videos (converted to RGB by the GPU)
+    // (preloaded frames are more compact in YUV)
+    if (textureindex_ == 0 && yuv_buffer_ == nullptr)
+        yuv_texturing_ = (Settings::application.render.yuv_texturing || preload_) && !media_.isimage;
+
     // instruct sink to use the required caps
     std::string capstring = "video/x-raw,format=RGBA,width="+ std::to_string(media_.width) +
             ",height=" + std::to_string(media_.height);
+    if (yuv_texturing_)
+        capstring = "video/x-raw,format=(string){I420,NV12},width="+ std::to_string(media_.width) +
+                ",height=" + std::to_string(media_.height);
     GstCaps *caps = gst_caps_from_string(capstring.c_str());
-    if (!gst_video_info_from_caps (&v_frame_video_info_, caps)) {
+    // NB: YUV format is negotiated and confirmed at preroll (default to I420)
+    if (yuv_texturing_)
+        gst_video_info_set_format (&v_frame_video_info_, GST_VIDEO_FORMAT_I420, media_.width, media_.height);
+    else if (!gst_video_info_from_caps (&v_frame_video_info_, caps)) {
         Log::Warning("MediaPlayer %s Could not configure video frame info", std::to_string(id_).c_str());
         failed_ = true;
         return;
@@ -628,11 +937,22 @@ void MediaPlayer::execute_open()
     // instruct the sink to send samples synched in time
     gst_base_sink_set_sync (GST_BASE_SINK(sink), true);
 
+    // decide once to use native YUV frames for videos (converted to RGB by the GPU)
+    // (preloaded frames are more compact in YUV)
+    if (textureindex_ == 0 && yuv_buffer_ == nullptr)
+        yuv_texturing_ = (Settings::application.render.yuv_texturing || preload_) && !media_.isimage;
+
     // instruct sink to use the required caps
     std::string capstring = "video/x-raw,format=RGBA,width="+ std::to_string(media_.width) +
             ",height=" + std::to_string(media_.height);
+    if (yuv_texturing_)
+        capstring = "video/x-raw,format=(string){I420,NV12},width="+ std::to_string(media_.width) +
+                ",height=" + std::to_string(media_.height);
     GstCaps *caps = gst_caps_from_string(capstring.c_str());
-    if (!gst_video_info_from_caps (&v_frame_video_info_, caps)) {
+    // NB: YUV format is negotiated and confirmed at preroll (default to I420)
+    if (yuv_texturing_)
+        gst_video_info_set_format (&v_frame_video_info_, GST_VIDEO_FORMAT_I420, media_.width, media_.height);
+    else if (!gst_video_info_from_caps (&v_frame_video_info_, caps)) {
         Log::Warning("MediaPlayer %s Could not configure video frame info", std::to_string(id_).c_str());
         failed_ = true;
         return;
@@ -793,7 +1113,11 @@ void MediaPlayer::close()
     }
 
     // cleanup eventual remaining frame memory
-    for(guint i = 0; i < N_VFRAME; i++) {
+    cache_serving_ = false;
+    cache_filling_ = false;
+    preloaded_ = false;
+    cache_clear();
+    for(guint i = 0; i < N_VFRAME + 1; i++) {
         frame_[i].access.lock();
         frame_[i].unmap();
         frame_[i].status = INVALID;
@@ -854,6 +1178,15 @@ void MediaPlayer::enable(bool on)
         if (enabled_)
             requested_state = desired_state_;
 
+        // frames served from cache: pipeline runs only to fill the cache
+        // (and is stopped once preloaded)
+        if (cache_serving_) {
+            requested_state = (enabled_ && cache_filling_) ? GST_STATE_PLAYING : GST_STATE_PAUSED;
+            if (preloaded_)
+                requested_state = GST_STATE_NULL;
+            g_timer_start(cache_timer_);
+        }
+
         //  apply state change
         GstStateChangeReturn ret = gst_element_set_state (pipeline_, requested_state);
         if (ret == GST_STATE_CHANGE_FAILURE) {
@@ -937,6 +1270,19 @@ void MediaPlayer::execute_play_command(bool on)
             execute_seek_command(timeline_.previous(timeline_.last()));
     }
 
+    // play backward from cache
+    if ( cache_limit_ > 0 && !cache_serving_ && rate_ < 0.0 )
+        execute_seek_command();
+    // resume pipeline to play forward
+    else if ( cache_serving_ && !preload_ && rate_ > 0.0 && desired_state_ == GST_STATE_PLAYING )
+        execute_seek_command();
+
+    // pipeline state is managed by the cache
+    if ( cache_serving_ ) {
+        g_timer_start(cache_timer_);
+        return;
+    }
+
     // all ready, apply state change immediately
     GstStateChangeReturn ret = gst_element_set_state (pipeline_, desired_state_);
     if (ret == GST_STATE_CHANGE_FAILURE) {
@@ -1044,6 +1390,9 @@ void MediaPlayer::step(uint milisecond)
     if ( ( rate_ < 0.0 && position_ <= timeline_.next(0)  )
          || ( rate_ > 0.0 && position_ >= timeline_.previous(timeline_.last()) ) )
         rewind();
+    // step in cache
+    else if (cache_serving_)
+        execute_seek_command( rate_ > 0.0 ? position_ + timeline_.step() : position_ - timeline_.step() );
     else {
         // step event
         if (milisecond < media_.dt)
@@ -1110,6 +1459,13 @@ void MediaPlayer::jump(uint milisecond)
     if (!enabled_ || !isPlaying())
         return;
 
+    // jump in cache
+    if (cache_serving_) {
+        GstClockTime d = CLAMP(milisecond, 1, 1000) * GST_MSECOND;
+        execute_seek_command( rate_ > 0.0 ? position_ + d : (position_ > d ? position_ - d : 0) );
+        return;
+    }
+
     gst_element_send_event (pipeline_, gst_event_new_step (GST_FORMAT_TIME,
                                                            CLAMP(milisecond, 1, 1000) * GST_MSECOND,
                                                            ABS(rate_),
@@ -1179,6 +1535,15 @@ void MediaPlayer::init_texture(guint index)
 
 void MediaPlayer::fill_texture(guint index)
 {
+    // texture content changes
+    ++generation_;
+
+    // native YUV frames are uploaded by planes
+    if (yuv_texturing_) {
+        fill_texture_yuv(index);
+        return;
+    }
+
     // is this the first frame ?
     if (textureindex_ < 1)
     {
@@ -1227,6 +1592,175 @@ void MediaPlayer::fill_texture(guint index)
     }
 }
 
+void MediaPlayer::init_texture_yuv(guint index)
+{
+    GstVideoFrame *vframe = &frame_[index].vframe;
+
+    // delete previous planes (if format changed)
+    for (guint i = 0; i < 3; ++i) {
+        if (yuv_textures_[i])
+            glDeleteTextures(1, &yuv_textures_[i]);
+        yuv_textures_[i] = 0;
+    }
+
+    // create a texture for each plane (Y, U and V for I420, Y and UV for NV12)
+    yuv_format_ = GST_VIDEO_FRAME_FORMAT(vframe);
+    yuv_n_planes_ = MINI(GST_VIDEO_FRAME_N_PLANES(vframe), 3u);
+    guint offset = 0;
+    glActiveTexture(GL_TEXTURE0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (guint i = 0; i < yuv_n_planes_; ++i) {
+        // layout of plane in memory (contiguous in PBO)
+        yuv_planes_[i].offset = offset;
+        yuv_planes_[i].width  = GST_VIDEO_FRAME_COMP_WIDTH(vframe, i);
+        yuv_planes_[i].height = GST_VIDEO_FRAME_COMP_HEIGHT(vframe, i);
+        yuv_planes_[i].rowlength = GST_VIDEO_FRAME_PLANE_STRIDE(vframe, i) / GST_VIDEO_FRAME_COMP_PSTRIDE(vframe, i);
+        yuv_planes_[i].size = GST_VIDEO_FRAME_PLANE_STRIDE(vframe, i) * yuv_planes_[i].height;
+        offset += yuv_planes_[i].size;
+
+        // chroma plane of NV12 interleaves U and V in two channels
+        bool rg = ( i > 0 && yuv_format_ == GST_VIDEO_FORMAT_NV12 );
+
+        glGenTextures(1, &yuv_textures_[i]);
+        glBindTexture(GL_TEXTURE_2D, yuv_textures_[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, rg ? GL_RG8 : GL_R8, yuv_planes_[i].width, yuv_planes_[i].height);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, yuv_planes_[i].rowlength);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yuv_planes_[i].width, yuv_planes_[i].height,
+                        rg ? GL_RG : GL_RED, GL_UNSIGNED_BYTE, GST_VIDEO_FRAME_PLANE_DATA(vframe, i));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // create frame buffer and shader to convert YUV into RGB
+    if (yuv_buffer_ == nullptr) {
+        yuv_buffer_ = new FrameBuffer(media_.width, media_.height);
+        yuv_shader_ = new YUVShader;
+        yuv_surface_ = new Surface(yuv_shader_);
+    }
+    yuv_shader_->format = (yuv_format_ == GST_VIDEO_FORMAT_NV12) ? YUVShader::NV12 : YUVShader::I420;
+    yuv_shader_->plane_texture[0] = yuv_textures_[1];
+    yuv_shader_->plane_texture[1] = yuv_textures_[2];
+    yuv_surface_->setTextureIndex( yuv_textures_[0] );
+
+    // set conversion matrix from colorimetry of the video (default to BT.601)
+    const GstVideoColorimetry *colorimetry = &GST_VIDEO_INFO_COLORIMETRY(&vframe->info);
+    gdouble Kr = 0.299, Kb = 0.114;
+    gst_video_color_matrix_get_Kr_Kb(colorimetry->matrix, &Kr, &Kb);
+    yuv_shader_->setColorimetry( (float) Kr, (float) Kb, colorimetry->range == GST_VIDEO_COLOR_RANGE_0_255);
+
+    // set pbo image size for all planes
+    pbo_size_ = offset;
+
+    // create pixel buffer objects,
+    if (pbo_[0])
+        glDeleteBuffers(2, pbo_);
+    glGenBuffers(2, pbo_);
+
+    for(int i = 0; i < 2; i++ ) {
+        // create 2 PBOs
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[i]);
+        // glBufferDataARB with NULL pointer reserves only memory space.
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, pbo_size_, 0, GL_STREAM_DRAW);
+        // fill in with reset picture
+        GLubyte* ptr = (GLubyte*) glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (ptr)  {
+            // update data directly on the mapped buffer
+            for (guint p = 0; p < yuv_n_planes_; ++p)
+                memmove(ptr + yuv_planes_[p].offset, GST_VIDEO_FRAME_PLANE_DATA(vframe, p), yuv_planes_[p].size);
+            // release pointer to mapping buffer
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else {
+            // did not work, disable PBO
+            glDeleteBuffers(2, pbo_);
+            pbo_[0] = pbo_[1] = 0;
+            pbo_size_ = 0;
+            break;
+        }
+    }
+
+    // should be good to go, wrap it up
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pbo_index_ = 0;
+    pbo_next_index_ = 1;
+
+    // initialize decoderName once (forced update)
+    decoder_name_ = "";
+    Log::Info("MediaPlayer %s Uses %s decoding and OpenGL %s YUV texturing.", std::to_string(id_).c_str(),
+              decoderName().c_str(), gst_video_format_to_string(yuv_format_));
+}
+
+void MediaPlayer::fill_texture_yuv(guint index)
+{
+    GstVideoFrame *vframe = &frame_[index].vframe;
+
+    // is this the first frame, or did the format change ?
+    if (yuv_buffer_ == nullptr || yuv_format_ != GST_VIDEO_FRAME_FORMAT(vframe))
+    {
+        // initialize planes textures
+        init_texture_yuv(index);
+    }
+    else {
+        glActiveTexture(GL_TEXTURE0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // use dual Pixel Buffer Object
+        if (pbo_size_ > 0) {
+            // In dual PBO mode, increment current index first then get the next index
+            pbo_index_ = (pbo_index_ + 1) % 2;
+            pbo_next_index_ = (pbo_index_ + 1) % 2;
+
+            // bind PBO to read pixels
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[pbo_index_]);
+            // copy each plane from PBO to its texture object
+            for (guint i = 0; i < yuv_n_planes_; ++i) {
+                bool rg = ( i > 0 && yuv_format_ == GST_VIDEO_FORMAT_NV12 );
+                glBindTexture(GL_TEXTURE_2D, yuv_textures_[i]);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, yuv_planes_[i].rowlength);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yuv_planes_[i].width, yuv_planes_[i].height,
+                                rg ? GL_RG : GL_RED, GL_UNSIGNED_BYTE, (void *) (uintptr_t) yuv_planes_[i].offset);
+            }
+            // bind the next PBO to write pixels
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[pbo_next_index_]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, pbo_size_, 0, GL_STREAM_DRAW);
+            // map the buffer object into client's memory
+            GLubyte* ptr = (GLubyte*) glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+            if (ptr) {
+                for (guint i = 0; i < yuv_n_planes_; ++i)
+                    memmove(ptr + yuv_planes_[i].offset, GST_VIDEO_FRAME_PLANE_DATA(vframe, i), yuv_planes_[i].size);
+                // release pointer to mapping buffer
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            // done with PBO
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else {
+            // without PBO, use standard opengl (slower)
+            for (guint i = 0; i < yuv_n_planes_; ++i) {
+                bool rg = ( i > 0 && yuv_format_ == GST_VIDEO_FORMAT_NV12 );
+                glBindTexture(GL_TEXTURE_2D, yuv_textures_[i]);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, yuv_planes_[i].rowlength);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yuv_planes_[i].width, yuv_planes_[i].height,
+                                rg ? GL_RG : GL_RED, GL_UNSIGNED_BYTE, GST_VIDEO_FRAME_PLANE_DATA(vframe, i));
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // convert YUV planes into the RGB frame buffer
+    yuv_buffer_->begin(false);
+    yuv_surface_->draw(glm::identity<glm::mat4>(), yuv_buffer_->projection());
+    yuv_buffer_->end();
+}
+
 void MediaPlayer::update()
 {
     // discard
@@ -1263,6 +1797,13 @@ void MediaPlayer::update()
     if ( (!enabled_ && !force_update_) || (singleFrame() && textureindex_>0 ) )
         return;
 
+    // frames served from cache
+    if (cache_serving_) {
+        cache_update();
+        force_update_ = false;
+        return;
+    }
+
     // local variables before trying to update
     guint read_index = 0;
     bool need_loop = false;
@@ -1352,6 +1893,13 @@ void MediaPlayer::update()
     if (need_loop && desired_state_ == GST_STATE_PLAYING)  // avoid repeated call
         execute_loop_command();
 
+    // keep in cache the frames around position
+    cache_center_ = position_;
+
+    // start preloading once the first frame is displayed
+    if (preload_ && position_ != GST_CLOCK_TIME_NONE && !seeking_)
+        cache_preload();
+
     force_update_ = false;
 }
 
@@ -1374,8 +1922,22 @@ void MediaPlayer::execute_seek_command(GstClockTime target, bool force)
     if ( pipeline_ == nullptr || !media_.seekable )
         return;
 
+    // play backward, preloaded, or go to a cached frame when paused: no pipeline flush
+    GstClockTime t = (target == GST_CLOCK_TIME_NONE) ? position_ : target;
+    if ( cache_limit_ > 0 && !media_.isimage && t != GST_CLOCK_TIME_NONE ) {
+        if ( rate_ < 0.0 || (preload_ && cache_serving_) ||
+             ( desired_state_ != GST_STATE_PLAYING && cache_lookup(t) != GST_CLOCK_TIME_NONE ) ) {
+            cache_enter(t);
+            return;
+        }
+    }
+
+    // otherwise pipeline takes over (at current position if it was serving from cache)
+    bool resync = cache_serving_;
+    cache_leave();
+
     // ignore request to current position
-    if ( ABS_DIFF(target, position_) < timeline_.step())
+    if ( !resync && ABS_DIFF(target, position_) < timeline_.step())
         return;
 
     // seek position : default to target
@@ -1417,6 +1979,10 @@ void MediaPlayer::execute_seek_command(GstClockTime target, bool force)
     else
         Log::Info("MediaPlayer %s Seek failed", std::to_string(id_).c_str());
 
+    // restore pipeline state after serving from cache
+    if (resync && enabled_)
+        gst_element_set_state (pipeline_, desired_state_);
+
     // Force update
     if (force) {
         gst_element_get_state (pipeline_, NULL, NULL, GST_CLOCK_TIME_NONE);
@@ -1449,6 +2015,12 @@ void MediaPlayer::setPlaySpeed(double s)
     if (pipeline_ == nullptr || !media_.seekable)
         return;
 
+    // backward play is served from cache: no change of pipeline rate
+    if ( cache_limit_ > 0 && (cache_serving_ || rate_ < 0.0) ) {
+        execute_seek_command();
+        return;
+    }
+
     //
     // Apply rate change with gstreamer seek
     //
@@ -1539,8 +2111,319 @@ double MediaPlayer::updateFrameRate() const
 
 // CALLBACKS
 
+void MediaPlayer::setFrameCache(guint megabytes)
+{
+    cache_setting_ = (size_t) megabytes * 1048576;
+
+    // size of cache is set by preload
+    if (preload_)
+        return;
+
+    cache_limit_ = cache_setting_;
+
+    // disabled: pipeline takes over
+    if (cache_limit_ == 0) {
+        if (cache_serving_)
+            execute_seek_command();
+        cache_clear();
+    }
+}
+
+void MediaPlayer::setPreload(bool on)
+{
+    if (preload_ == on)
+        return;
+
+    preload_ = on;
+    if (!preload_)
+        cache_limit_ = cache_setting_;
+
+    // changing mode requires reload
+    reopen();
+}
+
+void MediaPlayer::cache_preload()
+{
+    // all frames must fit in memory
+    size_t needed = (timeline_.numFrames() + 2) * GST_VIDEO_INFO_SIZE(&v_frame_video_info_);
+    if ( media_.isimage || needed > (size_t) PRELOAD_MAX_MB * 1048576 ) {
+        Log::Warning("MediaPlayer %s Cannot preload more than %d MB in memory.", std::to_string(id_).c_str(), PRELOAD_MAX_MB);
+        preload_ = false;
+        cache_limit_ = cache_setting_;
+        return;
+    }
+    cache_limit_ = needed;
+
+    // serve frames from cache while the whole timeline is decoded
+    cache_enter(position_);
+    if ( !cache_decode(timeline_.begin(), timeline_.end()) )
+        cache_preload_cancel(position_);
+}
+
+void MediaPlayer::cache_preload_cancel(GstClockTime target)
+{
+    Log::Warning("MediaPlayer %s Preload incomplete; playing from file.", std::to_string(id_).c_str());
+
+    // back to the frame cache set by user
+    preload_ = false;
+    preloaded_ = false;
+    cache_limit_ = cache_setting_;
+    cache_clear();
+
+    // restart the pipeline if it was stopped, and let it take over
+    gst_element_set_state (pipeline_, GST_STATE_PAUSED);
+    gst_element_get_state (pipeline_, NULL, NULL, GST_CLOCK_TIME_NONE);
+    execute_seek_command(target);
+}
+
+size_t MediaPlayer::frameCacheUsage()
+{
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    return cache_size_;
+}
+
+// synchronize the appsink of pipeline (named 'sink', or 'appsink' with playbin)
+static void setSinkSync(GstElement *pipeline, bool on)
+{
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+    if (!sink)
+        sink = gst_bin_get_by_name (GST_BIN (pipeline), "appsink");
+    if (sink) {
+        gst_base_sink_set_sync (GST_BASE_SINK(sink), on);
+        gst_object_unref (sink);
+    }
+}
+
+void MediaPlayer::cache_insert(GstBuffer *buf)
+{
+    if (buf->pts == GST_CLOCK_TIME_NONE)
+        return;
+
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    if (cache_.count(buf->pts) > 0)
+        return;
+
+    // deep copy to release the decoder buffer
+    GstBuffer *copy = gst_buffer_copy_deep(buf);
+    cache_frame_size_ = gst_buffer_get_size(copy);
+    cache_size_ += cache_frame_size_;
+    cache_[buf->pts] = copy;
+
+    // remove frames farthest from the display position
+    GstClockTime center = cache_center_;
+    if (center == GST_CLOCK_TIME_NONE)
+        center = buf->pts;
+    while (cache_size_ > cache_limit_ && cache_.size() > 1) {
+        auto first = cache_.begin();
+        auto last = std::prev(cache_.end());
+        auto it = ABS_DIFF(first->first, center) > ABS_DIFF(last->first, center) ? first : last;
+        cache_size_ -= gst_buffer_get_size(it->second);
+        gst_buffer_unref(it->second);
+        cache_.erase(it);
+    }
+}
+
+GstClockTime MediaPlayer::cache_lookup(GstClockTime target)
+{
+    std::lock_guard<std::mutex> lock(cache_lock_);
+
+    // nearest frame to target
+    GstClockTime pts = GST_CLOCK_TIME_NONE;
+    auto it = cache_.lower_bound(target);
+    if (it != cache_.end())
+        pts = it->first;
+    if (it != cache_.begin()) {
+        --it;
+        if (pts == GST_CLOCK_TIME_NONE || target - it->first < pts - target)
+            pts = it->first;
+    }
+
+    // valid only if not further than a frame
+    if (pts != GST_CLOCK_TIME_NONE && ABS_DIFF(pts, target) > timeline_.step())
+        pts = GST_CLOCK_TIME_NONE;
+
+    return pts;
+}
+
+bool MediaPlayer::cache_display(GstClockTime pts)
+{
+    // get the frame without keeping the cache locked
+    GstBuffer *buf = nullptr;
+    cache_lock_.lock();
+    auto it = cache_.find(pts);
+    if (it != cache_.end())
+        buf = gst_buffer_ref(it->second);
+    cache_lock_.unlock();
+    if (buf == nullptr)
+        return false;
+
+    // fill the texture with the frame reserved for cache
+    Frame &f = frame_[N_VFRAME];
+    bool filled = gst_video_frame_map (&f.vframe, &v_frame_video_info_, buf, GST_MAP_READ );
+    if (filled) {
+        f.full = true;
+        fill_texture(N_VFRAME);
+        // double update when paused and dual PBO (ensure frame is displayed now)
+        if (desired_state_ != GST_STATE_PLAYING && pbo_size_ > 0)
+            fill_texture(N_VFRAME);
+        f.unmap();
+    }
+
+    gst_buffer_unref(buf);
+    return filled;
+}
+
+void MediaPlayer::cache_enter(GstClockTime target)
+{
+    // pause pipeline, unless it fills the cache
+    if (!cache_serving_) {
+        cache_serving_ = true;
+        cache_filling_ = false;
+        gst_element_set_state (pipeline_, GST_STATE_PAUSED);
+    }
+
+    cache_target_ = CLAMP(target, timeline_.begin(), timeline_.end());
+    g_timer_start(cache_timer_);
+    force_update_ = true;
+}
+
+void MediaPlayer::cache_leave()
+{
+    if (!cache_serving_)
+        return;
+
+    cache_serving_ = false;
+    cache_filling_ = false;
+
+    // sink returns to synchronized play
+    setSinkSync(pipeline_, true);
+}
+
+void MediaPlayer::cache_fill(GstClockTime target)
+{
+    // duration of half the cache
+    size_t frame_size = cache_frame_size_ > 0 ? cache_frame_size_ : media_.width * media_.height * 4;
+    GstClockTime span = MAX(cache_limit_ / frame_size / 2, 2) * timeline_.step();
+
+    // lowest frame cached contiguously before target
+    GstClockTime low = GST_CLOCK_TIME_NONE;
+    cache_lock_.lock();
+    auto it = cache_.upper_bound(target);
+    if (it != cache_.begin() && target - std::prev(it)->first <= timeline_.step()) {
+        --it;
+        while (it != cache_.begin() && it->first - std::prev(it)->first < 3 * timeline_.step() / 2)
+            --it;
+        low = it->first;
+    }
+    cache_lock_.unlock();
+
+    // enough frames ahead, or reached beginning
+    if (low != GST_CLOCK_TIME_NONE && ( target - low > span / 2 || low <= timeline_.first() ) )
+        return;
+
+    // ignore if already filling this segment
+    GstClockTime end = (low == GST_CLOCK_TIME_NONE) ? target + timeline_.step() : low;
+    if (cache_filling_ && end > cache_fill_begin_ && end <= cache_fill_end_)
+        return;
+    GstClockTime begin = end > timeline_.begin() + span ? end - span : timeline_.begin();
+
+    cache_decode(begin, end);
+}
+
+bool MediaPlayer::cache_decode(GstClockTime begin, GstClockTime end)
+{
+    // decode segment forward, as fast as possible
+    setSinkSync(pipeline_, false);
+    GstEvent *seek_event = gst_event_new_seek (1.0, GST_FORMAT_TIME,
+                                               (GstSeekFlags) (GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+                                               GST_SEEK_TYPE_SET, begin, GST_SEEK_TYPE_SET, end);
+    if ( gst_element_send_event(pipeline_, seek_event) ) {
+        cache_filling_ = true;
+        cache_fill_begin_ = begin;
+        cache_fill_end_ = end;
+        if (enabled_)
+            gst_element_set_state (pipeline_, GST_STATE_PLAYING);
+        return true;
+    }
+    return false;
+}
+
+void MediaPlayer::cache_update()
+{
+    // time elapsed since last update
+    double elapsed = g_timer_elapsed(cache_timer_, NULL);
+    g_timer_start(cache_timer_);
+
+    // advance target in time when playing
+    GstClockTime target = cache_target_;
+    if (desired_state_ == GST_STATE_PLAYING) {
+        gint64 t = (gint64) cache_target_ + (gint64) (rate_ * elapsed * (double) GST_SECOND);
+        target = (GstClockTime) CLAMP(t, (gint64) timeline_.first(), (gint64) timeline_.last());
+        // skip gaps in timeline
+        TimeInterval gap;
+        if (timeline_.getGapAt(target, gap) && gap.is_valid())
+            target = rate_ > 0.0 ? gap.end : ( gap.begin > timeline_.step() ? gap.begin - timeline_.step() : 0 );
+    }
+
+    // display cached frame at target
+    GstClockTime pts = cache_lookup(target);
+    if (pts != GST_CLOCK_TIME_NONE) {
+        cache_target_ = target;
+        if (pts != position_ && cache_display(pts))
+            position_ = pts;
+    }
+    // not in cache: pipeline takes over to play forward
+    // (backward or preloading, wait for the frames to be decoded)
+    else if (rate_ > 0.0 && !preload_) {
+        execute_seek_command();
+        return;
+    }
+    // missing from preloaded frames: pipeline takes over
+    else if (preload_ && !cache_filling_) {
+        cache_preload_cancel(target);
+        return;
+    }
+    cache_center_ = position_;
+
+    // decode frames ahead in background
+    if (rate_ < 0.0 && !preload_)
+        cache_fill(cache_target_);
+
+    // all frames preloaded: stop pipeline
+    if (preload_ && !preloaded_ && !cache_filling_) {
+        preloaded_ = true;
+        gst_element_set_state (pipeline_, GST_STATE_NULL);
+        Log::Info("MediaPlayer %s Preloaded in memory (%lu MB)", std::to_string(id_).c_str(),
+                  (unsigned long) (frameCacheUsage() / 1048576) );
+    }
+
+    // manage loop mode at extremities
+    if ( desired_state_ == GST_STATE_PLAYING && pts != GST_CLOCK_TIME_NONE &&
+        ( (rate_ < 0.0 && position_ <= timeline_.first()) || (rate_ > 0.0 && position_ >= timeline_.last()) ) )
+        execute_loop_command();
+}
+
+void MediaPlayer::cache_clear()
+{
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    for (auto it = cache_.begin(); it != cache_.end(); ++it)
+        gst_buffer_unref(it->second);
+    cache_.clear();
+    cache_size_ = 0;
+    cache_center_ = GST_CLOCK_TIME_NONE;
+}
+
 bool MediaPlayer::fill_frame(GstBuffer *buf, FrameStatus status)
 {
+    // frames decoded while serving from cache are not displayed
+    if (cache_serving_) {
+        if (buf != NULL)
+            cache_insert(buf);
+        else
+            cache_filling_ = false;
+        return true;
+    }
+
     // Do NOT overwrite an unread EOS
     if ( frame_[write_index_].status == EOS )
         write_index_ = (write_index_ + 1) % N_VFRAME;
@@ -1572,12 +2455,18 @@ bool MediaPlayer::fill_frame(GstBuffer *buf, FrameStatus status)
         // successfully filled the frame
         frame_[write_index_].full = true;
 
-        // validate frame format
-        if( GST_VIDEO_INFO_IS_RGB(&(frame_[write_index_].vframe).info) && GST_VIDEO_INFO_N_PLANES(&(frame_[write_index_].vframe).info) == 1)
+        // validate frame format (RGBA single plane, or YUV multi planes)
+        const GstVideoInfo *vinfo = &(frame_[write_index_].vframe).info;
+        if( ( !yuv_texturing_ && GST_VIDEO_INFO_IS_RGB(vinfo) && GST_VIDEO_INFO_N_PLANES(vinfo) == 1 ) ||
+            (  yuv_texturing_ && GST_VIDEO_INFO_IS_YUV(vinfo) && GST_VIDEO_INFO_N_PLANES(vinfo) > 1 ) )
         {
             // set presentation time stamp
             frame_[write_index_].position = buf->pts;
 
+            // keep a copy of the frame
+            if (cache_limit_ > 0)
+                cache_insert(buf);
+
             // set the start position (i.e. pts of first frame we got)
             if (timeline_.first() == GST_CLOCK_TIME_NONE) {
                 timeline_.setFirst(buf->pts);
@@ -1645,6 +2534,13 @@ GstFlowReturn MediaPlayer::callback_new_preroll (GstAppSink *sink, gpointer p)
         MediaPlayer *m = static_cast<MediaPlayer *>(p);
         if (m && m->opened_) {
 
+            // get the YUV format negotiated
+            if (m->yuv_texturing_) {
+                GstCaps *caps = gst_sample_get_caps (sample);
+                if (caps)
+                    gst_video_info_from_caps (&m->v_frame_video_info_, caps);
+            }
+
             // get buffer from sample
             GstBuffer *buf = gst_sample_get_buffer (sample);
 
@@ -1652,7 +2548,7 @@ GstFlowReturn MediaPlayer::callback_new_preroll (GstAppSink *sink, gpointer p)
             if ( !m->fill_frame(buf, MediaPlayer::PREROLL) )
                 ret = GST_FLOW_ERROR;
             // loop negative rate: emulate an EOS
-            else if (m->playSpeed() < 0.f && !(buf->pts > 0) ) {
+            else if (m->playSpeed() < 0.f && !m->cache_serving_ && !(buf->pts > 0) ) {
                 m->fill_frame(NULL, MediaPlayer::EOS);
             }
         }
@@ -1687,7 +2583,7 @@ GstFlowReturn MediaPlayer::callback_new_sample (GstAppSink *sink, gpointer p)
             if ( !m->fill_frame(buf, MediaPlayer::SAMPLE) )
                 ret = GST_FLOW_ERROR;
             // loop negative rate: emulate an EOS
-            else if (m->playSpeed() < 0.f && !(buf->pts > 0) ) {
+            else if (m->playSpeed() < 0.f && !m->cache_serving_ && !(buf->pts > 0) ) {
                 m->fill_frame(NULL, MediaPlayer::EOS);
             }
         }
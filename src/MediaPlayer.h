@@ -2,6 +2,7 @@
 #define __GST_MEDIA_PLAYER_H_
 
 #include <string>
+#include <map>
 #include <mutex>
 #include <future>
 
@@ -15,10 +16,15 @@
 
 // Forward declare classes referenced
 class Visitor;
+class FrameBuffer;
+class Surface;
+class YUVShader;
 
 #define MAX_PLAY_SPEED 20.0
 #define MIN_PLAY_SPEED 0.1
 #define N_VFRAME 5
+#define FRAME_CACHE_DEFAULT_MB 512
+#define PRELOAD_MAX_MB 2048
 
 struct MediaInfo {
 
@@ -245,6 +251,11 @@ public:
      * Must be called in OpenGL context
      * */
     guint texture() const;
+    /**
+     * Get the generation of the texture content,
+     * incremented each time a frame is filled in the texture
+     * */
+    inline uint64_t generation() const { return generation_; }
     /**
      * Get the name of the decoder used,
      * return 'software' if no hardware decoder is used
@@ -269,6 +280,21 @@ public:
      * */
     inline void setSyncToMetronome(Metronome::Synchronicity s) { metro_sync_ = s; }
     inline Metronome::Synchronicity syncToMetronome() const { return metro_sync_; }
+    /**
+     * Cache of recently decoded frames (size in MB, 0 to disable)
+     * Used to play backward and to seek without flushing the pipeline
+     * */
+    void setFrameCache(guint megabytes);
+    inline guint frameCache() const { return (guint) (cache_setting_ / 1048576); }
+    size_t frameCacheUsage();
+    /**
+     * Preload all frames in memory (decoded once, then
+     * the pipeline is stopped and frames are played from memory)
+     * NB: setPreload reopens the video
+     * */
+    void setPreload(bool on);
+    inline bool preload() const { return preload_; }
+    inline bool preloaded() const { return preloaded_; }
     /**
      * Adds a video effect into the gstreamer pipeline
      * NB: setVideoEffect reopens the video
@@ -308,6 +334,7 @@ public:
 
     /**
      * Discoverer to check uri and get media info
+     * (information is cached in settings, and validated in background)
      * */
     static MediaInfo UriDiscoverer(const std::string &uri);
     std::string log() const { return media_.log; }
@@ -320,6 +347,7 @@ private:
     std::string filename_;
     std::string uri_;
     guint textureindex_;
+    uint64_t generation_;
 
     // general properties of media
     MediaInfo media_;
@@ -342,6 +370,7 @@ private:
     bool rewind_on_disable_;
     bool force_software_decoding_;
     std::string decoder_name_;
+    bool yuv_texturing_;
     bool video_filter_available_;
     std::string video_filter_;
 
@@ -395,7 +424,7 @@ private:
         }
         void unmap();
     };
-    Frame frame_[N_VFRAME];
+    Frame frame_[N_VFRAME + 1]; // last frame is for display from cache
     guint write_index_;
     guint last_index_;
     std::mutex index_lock_;
@@ -405,6 +434,52 @@ private:
     guint pbo_index_, pbo_next_index_;
     guint pbo_size_;
 
+    // for YUV texturing
+    struct PlaneLayout {
+        guint offset;
+        guint size;
+        guint width;
+        guint height;
+        guint rowlength;
+    };
+    PlaneLayout yuv_planes_[3];
+    guint yuv_n_planes_;
+    GstVideoFormat yuv_format_;
+    guint yuv_textures_[3];
+    FrameBuffer *yuv_buffer_;
+    Surface *yuv_surface_;
+    YUVShader *yuv_shader_;
+
+    // cache of decoded frames, sorted by position
+    // when playing backward, frames are displayed from the cache
+    // while the pipeline decodes the previous frames forward
+    std::map<GstClockTime, GstBuffer *> cache_;
+    std::mutex cache_lock_;
+    std::atomic<size_t> cache_limit_;
+    size_t cache_setting_;
+    size_t cache_size_;
+    size_t cache_frame_size_;
+    std::atomic<bool> cache_serving_;
+    std::atomic<bool> cache_filling_;
+    std::atomic<GstClockTime> cache_center_;
+    GstClockTime cache_target_;
+    GstClockTime cache_fill_begin_;
+    GstClockTime cache_fill_end_;
+    GTimer *cache_timer_;
+    bool preload_;
+    bool preloaded_;
+    void cache_insert(GstBuffer *buf);
+    GstClockTime cache_lookup(GstClockTime target);
+    bool cache_display(GstClockTime pts);
+    void cache_enter(GstClockTime target);
+    void cache_leave();
+    void cache_fill(GstClockTime target);
+    bool cache_decode(GstClockTime begin, GstClockTime end);
+    void cache_preload();
+    void cache_preload_cancel(GstClockTime target);
+    void cache_update();
+    void cache_clear();
+
     // gst pipeline control
     void execute_open();
     void execute_play_command(bool on);
@@ -414,6 +489,8 @@ private:
     // gst frame filling
     void init_texture(guint index);
     void fill_texture(guint index);
+    void init_texture_yuv(guint index);
+    void fill_texture_yuv(guint index);
     bool fill_frame(GstBuffer *buf, FrameStatus status);
 
     // gst callbacks
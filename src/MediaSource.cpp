@@ -193,20 +193,28 @@ void MediaSource::render()
     if ( renderbuffer_ == nullptr )
         init();
     else {
-        // render the media player into frame buffer
-        // NB: this also applies the color correction shader
-        renderbuffer_->begin();
         // apply fading
         if (mediaplayer_->timelineFadingMode() != MediaPlayer::FADING_ALPHA)
             texturesurface_->shader()->color = glm::vec4( glm::vec3(mediaplayer_->currentTimelineFading()), 1.f);
         else
             texturesurface_->shader()->color = glm::vec4( glm::vec3(1.f), mediaplayer_->currentTimelineFading());
-        texturesurface_->draw(glm::identity<glm::mat4>(), renderbuffer_->projection());
-        renderbuffer_->end();
-        ready_ = true;
+
+        // render the media player into frame buffer, only if changed
+        // NB: this also applies the color correction shader
+        if ( needRender() ) {
+            renderbuffer_->begin();
+            texturesurface_->draw(glm::identity<glm::mat4>(), renderbuffer_->projection());
+            renderbuffer_->end();
+            ready_ = true;
+        }
     }
 }
 
+uint64_t MediaSource::generation() const
+{
+    return mediaplayer_->generation();
+}
+
 void MediaSource::accept(Visitor& v)
 {
     Source::accept(v);
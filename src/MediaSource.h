@@ -21,6 +21,7 @@ public:
     void reload () override;
     guint64 playtime () const override;
     void render() override;
+    uint64_t generation () const override;
     Failure failed() const override;
     uint texture() const override;
     void accept (Visitor& v) override;
@@ -23,9 +23,12 @@
 #include <iterator>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <mutex>
 #include <utility>
 
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 // #include <glm/gtx/vector_angle.hpp>
@@ -341,21 +344,71 @@ bool parsePLY(string ascii,
 
 
 
-Mesh::Mesh(const std::string& ply_path, const std::string& tex_path) : Primitive(), mesh_resource_(ply_path), texture_resource_(tex_path), textureindex_(0)
+// geometry of a PLY file, shared by all meshes created from it
+struct MeshGeometry {
+    vector<vec3> points;
+    vector<vec4> colors;
+    vector<vec2> texCoords;
+    vector<uint> indices;
+    uint primitive = 0;
+    GlmToolkit::AxisAlignedBoundingBox bbox;
+    // vertex arrays are not shared between OpenGL contexts
+    std::map<GLFWwindow *, uint> vao;
+};
+
+static std::map<std::string, MeshGeometry *> meshGeometries;
+static std::mutex meshGeometriesLock;
+
+static MeshGeometry *meshGeometry(const std::string& ply_path)
 {
-    if ( !parsePLY( Resource::getText(mesh_resource_), points_, colors_, texCoords_, indices_, drawMode_) )
+    std::lock_guard<std::mutex> lock(meshGeometriesLock);
+
+    // parse only once
+    auto g = meshGeometries.find(ply_path);
+    if ( g != meshGeometries.end() )
+        return g->second;
+
+    MeshGeometry *geometry = new MeshGeometry;
+    if ( !parsePLY( Resource::getText(ply_path), geometry->points, geometry->colors,
+                   geometry->texCoords, geometry->indices, geometry->primitive) )
     {
-        points_.clear();
-        colors_.clear();
-        texCoords_.clear();
-        indices_.clear();
+        geometry->points.clear();
+        geometry->colors.clear();
+        geometry->texCoords.clear();
+        geometry->indices.clear();
         Log::Warning("Mesh could not be created from %s", ply_path.c_str());
     }
+    else
+        geometry->bbox.extend(geometry->points);
+
+    meshGeometries[ply_path] = geometry;
+    return geometry;
+}
+
+Mesh::Mesh(const std::string& ply_path, const std::string& tex_path) : Primitive(), mesh_resource_(ply_path), texture_resource_(tex_path), textureindex_(0)
+{
+    geometry_ = meshGeometry(mesh_resource_);
+    drawMode_ = geometry_->primitive;
 
     // default non texture shader (deleted in Primitive)
     shader_ = new Shader;
 }
 
+Mesh::~Mesh()
+{
+    // vertex array is shared: not deleted in Primitive
+    vao_ = 0;
+}
+
+
+void Mesh::releaseContext(GLFWwindow *context)
+{
+    std::lock_guard<std::mutex> lock(meshGeometriesLock);
+
+    // vertex arrays are deleted with the context
+    for (auto g = meshGeometries.begin(); g != meshGeometries.end(); ++g)
+        g->second->vao.erase(context);
+}
 
 void Mesh::setTexture(uint textureindex)
 {
@@ -369,7 +422,27 @@ void Mesh::setTexture(uint textureindex)
 
 void Mesh::init()
 {
-    Primitive::init();
+    // get the vertex array of the geometry in the current context
+    {
+        std::lock_guard<std::mutex> lock(meshGeometriesLock);
+        GLFWwindow *context = glfwGetCurrentContext();
+        auto v = geometry_->vao.find(context);
+        if ( v == geometry_->vao.end() ) {
+            uint vao = 0;
+            if ( !geometry_->indices.empty() )
+                vao = createVertexArray(geometry_->points, geometry_->colors,
+                                        geometry_->texCoords, geometry_->indices);
+            v = geometry_->vao.emplace(context, vao).first;
+        }
+        vao_ = v->second;
+    }
+
+    // drawing indications
+    drawMode_  = geometry_->primitive;
+    drawCount_ = geometry_->indices.size();
+    bbox_      = geometry_->bbox;
+
+    Node::init();
 
     if (!texture_resource_.empty())
         setTexture(Resource::getTextureImage(texture_resource_));
@@ -391,6 +464,38 @@ void Mesh::draw(glm::mat4 modelview, glm::mat4 projection)
     }
 }
 
+void Mesh::drawInstances(const std::vector<glm::mat4> &modelviews, glm::mat4 projection)
+{
+    if ( !initialized() )
+        init();
+
+    if ( visible_ && shader_ && !modelviews.empty() ) {
+        if (textureindex_)
+            glBindTexture(GL_TEXTURE_2D, textureindex_);
+
+        shader_->projection = projection;
+        for (size_t i = 0; i < modelviews.size(); i += MESH_MAX_INSTANCES) {
+            size_t count = std::min( modelviews.size() - i, (size_t) MESH_MAX_INSTANCES);
+
+            // first instance uses modelview, next use the array of instances
+            shader_->modelview = modelviews[i] * transform_;
+            shader_->instances.clear();
+            for (size_t k = 1; k < count; ++k)
+                shader_->instances.push_back( modelviews[i + k] * transform_ );
+            shader_->use();
+
+            if (vao_) {
+                glBindVertexArray( vao_ );
+                glDrawElementsInstanced( drawMode_, drawCount_, GL_UNSIGNED_INT, 0, (GLsizei) count );
+                glBindVertexArray(0);
+            }
+        }
+        shader_->instances.clear();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
 void Mesh::accept(Visitor& v)
 {
     Primitive::accept(v);
@@ -2,20 +2,31 @@
 #define MESH_H
 
 #include <string>
+#include <vector>
 
 #include "Scene.h"
 
+// maximum number of instances in one draw call (see simple.vs and texture.vs)
+#define MESH_MAX_INSTANCES 16
+
+struct MeshGeometry;
+struct GLFWwindow;
+
 /**
  * @brief The Mesh class creates a Primitive node from a PLY File
  *
  *  PLY - Polygon File Format
  *  Also known as the Stanford Triangle Format
  *  http://paulbourke.net/dataformats/ply/
+ *
+ *  PLY files are parsed once and their vertex arrays are shared
+ *  by all meshes created from the same file.
  */
 class Mesh : public Primitive {
 
 public:
     Mesh(const std::string& ply_path, const std::string& tex_path = "");
+    ~Mesh();
 
     void setTexture(uint textureindex);
     inline uint texture() const { return textureindex_; }
@@ -24,6 +35,12 @@ public:
     void draw (glm::mat4 modelview, glm::mat4 projection) override;
     void accept (Visitor& v) override;
 
+    // draw the mesh once for each modelview, in as few draw calls as possible
+    void drawInstances (const std::vector<glm::mat4> &modelviews, glm::mat4 projection);
+
+    // forget the vertex arrays of the OpenGL context of a window (when destroyed)
+    static void releaseContext (GLFWwindow *context);
+
     inline std::string meshPath() const { return mesh_resource_; }
     inline std::string texturePath() const { return texture_resource_; }
 
@@ -31,7 +48,7 @@ protected:
     std::string mesh_resource_;
     std::string texture_resource_;
     uint textureindex_;
-
+    MeshGeometry *geometry_;
 };
 
 
@@ -608,6 +608,9 @@ bool Mixer::recreateSource(Source *s)
     // remove source Nodes from all views
     detachSource(s);
 
+    // history may be capturing the source
+    Action::manager().collect();
+
     // delete source
     session_->deleteSource(s);
 
@@ -630,6 +633,11 @@ void Mixer::deleteSource(Source *s)
         // remove source Nodes from all views
         detachSource(s);
 
+        // interpolations keep pointers to sources
+        // and history may be capturing the source
+        Action::manager().clearInterpolation();
+        Action::manager().collect();
+
         // delete source
         session_->deleteSource(s);
 
@@ -1491,6 +1499,7 @@ void Mixer::merge(SessionSource *source)
 
     // imported source itself should be removed
     detachSource(source);
+    Action::manager().collect();
     session_->deleteSource(source);
 
     // avoid display issues
@@ -1664,6 +1673,9 @@ void Mixer::paste(const std::string& clipboard)
 
 void Mixer::restore(tinyxml2::XMLElement *sessionNode)
 {
+    // history may be capturing sources to delete
+    Action::manager().collect();
+
     //
     // source lists
     //
@@ -1738,3 +1750,71 @@ void Mixer::restore(tinyxml2::XMLElement *sessionNode)
     ++View::need_deep_update_;
 }
 
+void Mixer::restore(tinyxml2::XMLElement *sessionNode, const SourceIdList &removed, const SourceIdList &order)
+{
+    // delete sources which are not in the restored status
+    for( auto it = removed.begin(); it != removed.end(); ++it) {
+        Source *s = findSource( *it );
+        if (s!=nullptr) {
+#ifdef ACTION_DEBUG
+            Log::Info("Delete   id %s\n", std::to_string( *it ).c_str());
+#endif
+            // remove the source from the mixer
+            detachSource( s );
+            // delete source from session
+            session_->deleteSource( s );
+        }
+    }
+
+    // load the sources which changed:
+    // - if a source exists, its attributes are updated
+    // - if a source does not exists, it is created inside the session
+    SourceIdList session_sources = session_->getIdList();
+    SessionLoader loader( session_ );
+    loader.load( sessionNode );
+
+    // attach created sources, and list all loaded sources
+    SourceList loaded_list;
+    std::map< uint64_t, Source* > loaded_sources = loader.getSources();
+    for ( auto lsit = loaded_sources.begin(); lsit != loaded_sources.end(); lsit++) {
+        if ( std::find(session_sources.begin(), session_sources.end(), (*lsit).first) == session_sources.end() ) {
+#ifdef ACTION_DEBUG
+            Log::Info("Recreate id %s\n", std::to_string((*lsit).first).c_str());
+#endif
+            attachSource( (*lsit).second );
+        }
+        loaded_list.push_back( (*lsit).second );
+    }
+
+    //
+    // mixing groups
+    //
+    // groups of loaded sources are rebuilt with all their sources
+    // (sources of a group which is unchanged are not loaded)
+    session_->unlink( loaded_list );
+    std::list< SourceIdList > loadergroups = loader.getMixingGroupsId();
+    for (auto git = loadergroups.begin(); git != loadergroups.end(); ++git)
+        (*git).sort();
+    loadergroups.sort();
+    loadergroups.unique();
+    for (auto git = loadergroups.begin(); git != loadergroups.end(); ++git) {
+        SourceList group;
+        for (auto sit = (*git).begin(); sit != (*git).end(); ++sit) {
+            SourceList::iterator s = session_->find( *sit );
+            if ( s != session_->end() )
+                group.push_back( *s );
+        }
+        session_->link( group, view(View::MIXING)->scene.fg() );
+    }
+
+    // reorder according to index order of restored status
+    int i = 0;
+    for ( auto id = order.begin(); id != order.end(); ++id) {
+        SourceList::iterator s = session_->find( *id );
+        if ( s != session_->end() )
+            session_->move( session_->index(s), i++ );
+    }
+
+    ++View::need_deep_update_;
+}
+
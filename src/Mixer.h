@@ -130,6 +130,8 @@ public:
 
     // version and undo management
     void restore(tinyxml2::XMLElement *sessionNode);
+    // partial restore: only the sources in sessionNode are updated or created
+    void restore(tinyxml2::XMLElement *sessionNode, const SourceIdList &removed, const SourceIdList &order);
 
 protected:
 
@@ -15,10 +15,14 @@
 
 #include "MultiFileRecorder.h"
 
+// maximum memory of images decoded ahead of encoding
+#define MULTIFILE_DECODE_MEMORY 268435456
+
 MultiFileRecorder::MultiFileRecorder() :
     fps_(0), width_(0), height_(0), bpp_(3),
     pipeline_(nullptr), src_(nullptr), frame_count_(0), timestamp_(0), frame_duration_(0),
-    cancel_(false), endofstream_(false), accept_buffer_(false), progress_(0.f)
+    cancel_(false), endofstream_(false), accept_buffer_(false),
+    decode_next_(0), decode_window_(0), encode_next_(0), progress_(0.f), speed_(0.f)
 {
     // default profile
     profile_ = VideoRecorder::H264_STANDARD;
@@ -54,67 +58,86 @@ void MultiFileRecorder::setProfile (VideoRecorder::Profile p)
 void MultiFileRecorder::callback_need_data (GstAppSrc *, guint , gpointer p)
 {
     MultiFileRecorder *grabber = static_cast<MultiFileRecorder *>(p);
-    if (grabber)
+    if (grabber) {
+        std::lock_guard<std::mutex> lock(grabber->decode_lock_);
         grabber->accept_buffer_ = true;
+    }
+    if (grabber)
+        grabber->decode_cond_.notify_all();
 }
 
 // appsrc has enough data and we can stop sending
 void MultiFileRecorder::callback_enough_data (GstAppSrc *, gpointer p)
 {
     MultiFileRecorder *grabber = static_cast<MultiFileRecorder *>(p);
-    if (grabber)
+    if (grabber) {
+        std::lock_guard<std::mutex> lock(grabber->decode_lock_);
         grabber->accept_buffer_ = false;
+    }
 }
 
-bool MultiFileRecorder::add_image (const std::string &image_filename)
+bool MultiFileRecorder::add_image (unsigned char *rgb)
 {
-    if (image_filename.empty())
+    if (rgb == nullptr)
         return false;
 
-    // read pix
-    int c = 0;
-    int w = 0;
-    int h = 0;
-    unsigned char* rgb = stbi_load(image_filename.c_str(), &w, &h, &c, bpp_);
-
-    if ( rgb && w == width_ && h == height_ && c == bpp_) {
+    // wrap the decoded pixels into a buffer, without copy
+    // (stbi memory is freed when gstreamer releases the buffer)
+    guint size = width_ * height_ * bpp_;
+    GstBuffer *buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, rgb, size, 0, size,
+                                                     rgb, (GDestroyNotify) stbi_image_free);
 
-        // new buffer
-        guint size = width_ * height_ * bpp_;
-        GstBuffer *buffer = gst_buffer_new_and_alloc (size);
+    //g_print("frame_added @ timestamp = %ld\n", timestamp_);
+    GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer) = timestamp_;
 
-        // map gst buffer into a memory  WRITE target
-        GstMapInfo map;
-        gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    // set frame duration
+    buffer->duration = frame_duration_;
 
-        // transfer pixels from memory to buffer memory
-        memmove(map.data, rgb, size);
+    // monotonic time increment to keep fixed FPS
+    timestamp_ += frame_duration_;
 
-        // un-map
-        gst_buffer_unmap (buffer, &map);
-
-        // free stbi memory
-        stbi_image_free( rgb );
+    // push frame
+    if ( gst_app_src_push_buffer (src_, buffer) != GST_FLOW_OK )
+        return false;
 
-        //g_print("frame_added @ timestamp = %ld\n", timestamp_);
-        GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer) = timestamp_;
+    return true;
+}
 
-        // set frame duration
-        buffer->duration = frame_duration_;
+void MultiFileRecorder::decode (MultiFileRecorder *rec)
+{
+    while (true) {
+
+        // take next image to decode, not too far ahead of encoding
+        size_t index = 0;
+        {
+            std::unique_lock<std::mutex> lock(rec->decode_lock_);
+            rec->decode_cond_.wait(lock, [rec]{
+                return rec->cancel_ || rec->decode_next_ >= rec->decode_files_.size()
+                        || rec->decode_next_ < rec->encode_next_ + rec->decode_window_; });
+            if ( rec->cancel_ || rec->decode_next_ >= rec->decode_files_.size() )
+                return;
+            index = rec->decode_next_++;
+        }
 
-        // monotonic time increment to keep fixed FPS
-        timestamp_ += frame_duration_;
+        // read pix
+        int c = 0;
+        int w = 0;
+        int h = 0;
+        unsigned char* rgb = stbi_load(rec->decode_files_[index].c_str(), &w, &h, &c, rec->bpp_);
 
-        // push frame
-        if ( gst_app_src_push_buffer (src_, buffer) != GST_FLOW_OK )
-            return false;
+        // discard images of wrong format
+        if ( rgb && ( w != rec->width_ || h != rec->height_ || c != rec->bpp_) ) {
+            stbi_image_free( rgb );
+            rgb = nullptr;
+        }
 
+        // give decoded image (null if failed)
+        {
+            std::lock_guard<std::mutex> lock(rec->decode_lock_);
+            rec->decoded_[index] = rgb;
+        }
+        rec->decode_cond_.notify_all();
     }
-    else
-        return false;
-
-
-    return true;
 }
 
 
@@ -177,6 +200,9 @@ bool MultiFileRecorder::start_record (const std::string &video_filename)
     // Set buffer size
     gst_app_src_set_max_bytes( src_, MIN_BUFFER_SIZE);
 
+    // not ready until appsrc needs data
+    accept_buffer_ = false;
+
     // specify recorder resolution and framerate in the source caps
     GstCaps *caps  = gst_caps_new_simple ("video/x-raw",
                                           "format", G_TYPE_STRING, bpp_ < 4 ? "RGB" : "RGBA",
@@ -201,10 +227,10 @@ bool MultiFileRecorder::start_record (const std::string &video_filename)
     }
 
     // wait ready
-    int max = 100;
-    accept_buffer_ = false;
-    while (!accept_buffer_ && --max > 0)
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+        std::unique_lock<std::mutex> lock(decode_lock_);
+        decode_cond_.wait_for(lock, std::chrono::milliseconds(500), [this]{ return accept_buffer_ == true; });
+    }
 
 
 //    // send request key frame upstream
@@ -288,13 +314,18 @@ void MultiFileRecorder::start ()
 {
     if ( promises_.empty() ) {
         filename_ = std::string();
+        cancel_ = false;
         promises_.emplace_back( std::async(std::launch::async, assemble, this) );
     }
 }
 
 void MultiFileRecorder::cancel ()
 {
-    cancel_ = true;
+    {
+        std::lock_guard<std::mutex> lock(decode_lock_);
+        cancel_ = true;
+    }
+    decode_cond_.notify_all();
 }
 
 bool MultiFileRecorder::finished ()
@@ -322,6 +353,7 @@ std::string  MultiFileRecorder::assemble (MultiFileRecorder *rec)
 
     // reset
     rec->progress_ = 0.f;
+    rec->speed_ = 0.f;
     rec->width_ = 0;
     rec->height_ = 0;
     rec->bpp_ = 0;
@@ -357,26 +389,70 @@ std::string  MultiFileRecorder::assemble (MultiFileRecorder *rec)
         // progressing
         rec->progress_ += inc_;
 
-        // loop over images to open
-        for (auto file = rec->files_.cbegin(); file != rec->files_.cend(); ++file) {
-
-            if ( rec->cancel_ )
-                break;
+        // decode images in parallel threads, in a window limited in memory
+        size_t frame_size = rec->width_ * rec->height_ * rec->bpp_;
+        size_t num_workers = MAX( (int) std::thread::hardware_concurrency() - 1, 1);
+        rec->decode_files_.assign( rec->files_.cbegin(), rec->files_.cend() );
+        rec->decoded_.clear();
+        rec->decode_next_ = 0;
+        rec->encode_next_ = 0;
+        // up to 4 images per thread, but the memory cap applies last (at least one image)
+        size_t window = MIN( (size_t) 4 * num_workers, MULTIFILE_DECODE_MEMORY / MAX(frame_size, 1) );
+        rec->decode_window_ = MAX( window, 1 );
+        num_workers = MIN( num_workers, rec->decode_window_ );
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < num_workers; ++w)
+            workers.emplace_back( decode, rec );
+
+        // encode images in order
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rec->decode_files_.size(); ++i) {
+
+            unsigned char *rgb = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(rec->decode_lock_);
+
+                // wait for image to be decoded
+                rec->decode_cond_.wait(lock, [rec, i]{ return rec->cancel_ || rec->decoded_.count(i) > 0; });
+                if ( rec->cancel_ )
+                    break;
+                rgb = rec->decoded_[i];
+                rec->decoded_.erase(i);
+
+                // pause in case appsrc buffer is full
+                rec->decode_cond_.wait_for(lock, std::chrono::seconds(1), [rec]{ return rec->cancel_ || rec->accept_buffer_; });
+
+                // move decoding window
+                rec->encode_next_ = i + 1;
+            }
+            rec->decode_cond_.notify_all();
 
-            if ( rec->add_image( *file ) )
+            if ( rec->add_image( rgb ) )
                 // validate file
                 rec->frame_count_++;
             else
-                Log::Info("MultiFileRecorder could not add %s.", file->c_str());
-
-            // pause in case appsrc buffer is full
-            int max = 100;
-            while (!rec->accept_buffer_ && --max > 0)
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                Log::Info("MultiFileRecorder could not add %s.", rec->decode_files_[i].c_str());
 
             // progressing
             rec->progress_ += inc_;
+            std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+            if ( elapsed.count() > 0.f )
+                rec->speed_ = (float) (i + 1) / elapsed.count();
+        }
+
+        // stop decoding
+        {
+            std::lock_guard<std::mutex> lock(rec->decode_lock_);
+            rec->decode_next_ = rec->decode_files_.size();
+        }
+        rec->decode_cond_.notify_all();
+        for (auto w = workers.begin(); w != workers.end(); ++w)
+            w->join();
+        for (auto d = rec->decoded_.begin(); d != rec->decoded_.end(); ++d) {
+            if (d->second)
+                stbi_image_free( d->second );
         }
+        rec->decoded_.clear();
 
         // Give more explanation for possible errors
         if ( rec->frame_count_ < rec->files_.size())
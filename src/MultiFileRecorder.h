@@ -5,7 +5,10 @@
 #include <string>
 #include <atomic>
 #include <vector>
+#include <map>
 #include <future>
+#include <mutex>
+#include <condition_variable>
 
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
@@ -39,14 +42,18 @@ public:
     inline int height () const { return height_; }
     inline float progress () const { return progress_; }
     inline guint64 numFrames () const { return frame_count_; }
+    inline float speed () const { return speed_; }
 
 protected:
     // gstreamer functions
     static std::string assemble (MultiFileRecorder *rec);
     bool start_record (const std::string &video_filename);
-    bool add_image    (const std::string &image_filename);
+    bool add_image    (unsigned char *rgb);
     bool end_record();
 
+    // parallel decoding of images
+    static void decode (MultiFileRecorder *rec);
+
     // gstreamer callbacks
     static void callback_need_data (GstAppSrc *, guint, gpointer user_data);
     static void callback_enough_data (GstAppSrc *, gpointer user_data);
@@ -72,8 +79,18 @@ private:
     std::atomic<bool> endofstream_;
     std::atomic<bool> accept_buffer_;
 
+    // images decoded in parallel, in a bounded window ahead of encoding
+    std::vector<std::string> decode_files_;
+    std::map<size_t, unsigned char *> decoded_;
+    size_t decode_next_;
+    size_t decode_window_;
+    size_t encode_next_;
+    std::mutex decode_lock_;
+    std::condition_variable decode_cond_;
+
     // progress and result
     float progress_;
+    float speed_;
     std::vector< std::future<std::string> >promises_;
 };
 
@@ -32,6 +32,7 @@
 #include "Settings.h"
 #include "Mixer.h"
 #include "Recorder.h"
+#include "Transcoder.h"
 #include "Connection.h"
 #include "Streamer.h"
 #include "Loopback.h"
@@ -43,7 +44,7 @@
 
 
 OutputPreviewWindow::OutputPreviewWindow() : WorkspaceWindow("OutputPreview"),
-    video_recorder_(nullptr), video_broadcaster_(nullptr), loopback_broadcaster_(nullptr),
+    video_recorder_(nullptr), replay_recorder_(nullptr), video_broadcaster_(nullptr), loopback_broadcaster_(nullptr),
     magnifying_glass(false)
 {
 
@@ -98,6 +99,23 @@ void OutputPreviewWindow::Update()
         video_recorder_->stop();
     }
 
+    // instant replay recorder follows settings (disabled if it failed)
+    bool replay_active = replay_recorder_ != nullptr;
+    FrameGrabbing::manager().verify( (FrameGrabber**) &replay_recorder_);
+    if (replay_active && replay_recorder_ == nullptr)
+        Settings::application.record.replay = false;
+    else if (Settings::application.record.replay && replay_recorder_ == nullptr) {
+        replay_recorder_ = new ReplayRecorder(SystemToolkit::base_filename( Mixer::manager().session()->filename()));
+        FrameGrabbing::manager().add(replay_recorder_);
+    }
+    else if (!Settings::application.record.replay && replay_recorder_ != nullptr && !replay_recorder_->saving()) {
+        replay_recorder_->stop();
+        replay_recorder_ = nullptr;
+    }
+
+    // background encoding of captured recordings
+    Transcoding::manager().update();
+
     // verify the frame grabbers are valid (change to nullptr if invalid)
     FrameGrabbing::manager().verify( (FrameGrabber**) &video_broadcaster_);
     FrameGrabbing::manager().verify( (FrameGrabber**) &shm_broadcaster_);
@@ -133,6 +151,12 @@ void OutputPreviewWindow::ToggleRecord(bool save_and_continue)
     }
 }
 
+void OutputPreviewWindow::SaveReplay()
+{
+    if (replay_recorder_)
+        replay_recorder_->save();
+}
+
 void OutputPreviewWindow::ToggleRecordPause()
 {
     if (video_recorder_) {
@@ -310,6 +334,27 @@ void OutputPreviewWindow::Render()
                     ImGui::PopStyleColor(1);
                 }
 
+                // save the last seconds kept by instant replay
+                if (replay_recorder_) {
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(IMGUI_COLOR_RECORD, 0.8f));
+                    if ( ImGui::MenuItem( MENU_SAVEREPLAY, nullptr, false, !replay_recorder_->saving()) )
+                        SaveReplay();
+                    ImGui::PopStyleColor(1);
+                }
+
+                // background encoding of captured recordings
+                Transcoder *job = Transcoding::manager().current();
+                if (job) {
+                    ImGui::Separator();
+                    std::string info = "Encoding " + std::to_string( (int) (100.f * job->progress()) ) + "%";
+                    if (Transcoding::manager().pending() > 1)
+                        info += " (" + std::to_string(Transcoding::manager().pending() - 1) + " queued)";
+                    ImGui::MenuItem(info.c_str(), nullptr, false, false);
+                    ImGui::ProgressBar(job->progress(), ImVec2(ImGui::GetTextLineHeightWithSpacing() * 9.f, 0), "");
+                    if ( ImGui::MenuItem( ICON_FA_TIMES "  Cancel encoding", nullptr, false, !job->cancelled()) )
+                        Transcoding::manager().cancel();
+                }
+
                 // Options menu if not recording
                 ImGui::Separator();
                 if (video_recorder_) {
@@ -556,6 +601,14 @@ void OutputPreviewWindow::Render()
             ImGui::Text(ICON_FA_CIRCLE);
             ImGui::PopStyleColor(1);
         }
+        // background encoding indicator
+        else if (Transcoding::manager().current())
+        {
+            ImGui::SetCursorScreenPos(ImVec2(draw_pos.x + r, draw_pos.y + r));
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(IMGUI_COLOR_RECORD, 0.5f));
+            ImGui::Text(ICON_FA_COG " %d%%", (int) (100.f * Transcoding::manager().current()->progress()) );
+            ImGui::PopStyleColor(1);
+        }
         // broadcast indicator
         float vertical = r;
         if (video_broadcaster_)
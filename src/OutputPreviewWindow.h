@@ -5,6 +5,7 @@
 #include "WorkspaceWindow.h"
 
 class VideoRecorder;
+class ReplayRecorder;
 class VideoBroadcast;
 class ShmdataBroadcast;
 class Loopback;
@@ -13,6 +14,7 @@ class OutputPreviewWindow : public WorkspaceWindow
 {
     // frame grabbers
     VideoRecorder *video_recorder_;
+    ReplayRecorder *replay_recorder_;
     VideoBroadcast *video_broadcaster_;
     ShmdataBroadcast *shm_broadcaster_;
     Loopback *loopback_broadcaster_;
@@ -33,6 +35,9 @@ public:
     void ToggleRecordPause();
     inline bool isRecording() const { return video_recorder_ != nullptr; }
 
+    void SaveReplay();
+    inline bool replayEnabled() const { return replay_recorder_ != nullptr; }
+
     void ToggleVideoBroadcast();
     inline bool videoBroadcastEnabled() const { return video_broadcaster_ != nullptr; }
 
@@ -17,6 +17,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
 **/
 
+#include <cmath>
+
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -48,12 +50,73 @@ void PickingVisitor::visit(Node &n)
     modelview_ *= n.transform_;
 }
 
+bool PickingVisitor::overlap(const Node &n) const
+{
+    // nothing interactive
+    if ( n.pickingBounds().isNull() )
+        return false;
+
+    // bounds in scene coordinates (modelview includes the node transform)
+    GlmToolkit::AxisAlignedBoundingBox bb = n.pickingBounds().transformed(modelview_);
+    if ( n.pickingMargin() > 0.f ) {
+        glm::vec3 margin = glm::vec3(n.pickingMargin(), n.pickingMargin(), 0.f);
+        bb.extend( bb.min() - margin );
+        bb.extend( bb.max() + margin );
+    }
+
+    // test overlap with selection area
+    if (points_.size() > 1) {
+        GlmToolkit::AxisAlignedBoundingBox bb_points;
+        bb_points.extend(points_);
+        return bb_points.intersect(bb);
+    }
+    // test single point
+    else if (points_.size() > 0)
+        return bb.contains(points_[0]);
+
+    return false;
+}
+
+GlmToolkit::AxisAlignedBoundingBox PickingVisitor::area(const Node &n) const
+{
+    // coordinates, with the margin of decorations in the node
+    GlmToolkit::AxisAlignedBoundingBox bb;
+    bb.extend(points_);
+    glm::vec3 margin = glm::vec3(n.pickingMargin(), n.pickingMargin(), 0.f);
+    bb.extend( bb.min() - margin );
+    bb.extend( bb.max() + margin );
+
+    // in local coordinates of the node (empty if cannot be inverted)
+    bb = bb.transformed( glm::inverse(modelview_) );
+    if ( !std::isfinite(bb.min().x) || !std::isfinite(bb.min().y) ||
+         !std::isfinite(bb.max().x) || !std::isfinite(bb.max().y) )
+        return GlmToolkit::AxisAlignedBoundingBox();
+
+    return bb;
+}
+
 void PickingVisitor::visit(Group &n)
 {
     if (!n.visible_ && !force_)
         return;
 
+    // skip the group if none of its children can be picked
+    if ( !n.pickingDirty() && !overlap(n) )
+        return;
+
     glm::mat4 mv = modelview_;
+
+    // groups with many children give those near the coordinates
+    std::vector<Node *> candidates;
+    if ( !n.pickingDirty() && n.pickingCandidates(area(n), candidates) ) {
+        for (auto node = candidates.begin(); node != candidates.end(); ++node) {
+            if ( (*node)->visible_ || force_)
+                (*node)->accept(*this);
+            modelview_ = mv;
+        }
+        return;
+    }
+
     for (NodeSet::iterator node = n.begin(); node != n.end(); ++node) {
         if ( (*node)->visible_ || force_)
             (*node)->accept(*this);
@@ -66,6 +129,10 @@ void PickingVisitor::visit(Switch &n)
     if ((!n.visible_ && !force_) || n.numChildren()<1)
         return;
 
+    // skip if none of its children can be picked
+    if ( !n.pickingDirty() && !overlap(n) )
+        return;
+
     glm::mat4 mv = modelview_;
     n.activeChild()->accept(*this);
     modelview_ = mv;
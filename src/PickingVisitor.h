@@ -6,6 +6,7 @@
 #include <utility>
 
 #include "Visitor.h"
+#include "GlmToolkit.h"
 
 /**
  * @brief The PickingVisitor class is used to
@@ -15,6 +16,10 @@
  *
  * Only a subset of interactive objects (surface and Decorations)
  * are interactive.
+ *
+ * Groups whose picking bounds (maintained during update)
+ * cannot match the coordinates are skipped, and groups with
+ * many children only visit those in the grid cells around.
  */
 class PickingVisitor: public Visitor
 {
@@ -22,6 +27,8 @@ class PickingVisitor: public Visitor
     std::vector<glm::vec3> points_;
     glm::mat4 modelview_;
     std::vector< std::pair<Node *, glm::vec2> > nodes_;
+    bool overlap(const Node &n) const;
+    GlmToolkit::AxisAlignedBoundingBox area(const Node &n) const;
 
 public:
 
@@ -53,6 +53,9 @@ Surface::Surface(Shader *s) : Primitive(s), textureindex_(0), mirror_(true)
                                         glm::vec2( 1.f, 1.f ), glm::vec2( 1.f, 0.f ) };
     indices_ = std::vector<uint> { 0, 1, 2, 3 };
     drawMode_ = GL_TRIANGLE_STRIP;
+
+    // surface is interactive
+    picking_bounds_.extend(points_);
 }
 
 
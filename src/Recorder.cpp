@@ -36,8 +36,10 @@
 #include "Settings.h"
 #include "GstToolkit.h"
 #include "SystemToolkit.h"
+#include "BaseToolkit.h"
 #include "Log.h"
 #include "Audio.h"
+#include "Transcoder.h"
 
 #include "Recorder.h"
 
@@ -304,8 +306,35 @@ const guint64 VideoRecorder::buffering_preset_value[6] = { MIN_BUFFER_SIZE, 1048
 const char*   VideoRecorder::framerate_preset_name[3]  = { "15 FPS", "25 FPS", "30 FPS" };
 const gint    VideoRecorder::framerate_preset_value[3] = { 15, 25, 30 };
 
+const char*   VideoRecorder::capture_mode_name[3] = { "Direct", "Raw", "Lossless" };
+const char*   VideoRecorder::capture_description[3] = {
+    "",
+    // uncompressed frames
+    "",
+    // FFV Huffyuv lossless intra-frame codec
+    "avenc_ffvhuff ! "
+};
+
+const char*   VideoRecorder::spill_preset_name[5]  = { "Off", "4 GB", "16 GB", "64 GB", "256 GB" };
+const guint64 VideoRecorder::spill_preset_value[5] = { 0, 4294967296, 17179869184, 68719476736, 274877906944 };
+
+
+std::string VideoRecorder::encoder_description(int profile)
+{
+    // test for a hardware accelerated encoder
+    if (Settings::application.render.gpu_decoding && (int) VideoRecorder::hardware_encoder.size() > 0 &&
+            GstToolkit::has_feature(VideoRecorder::hardware_encoder[profile]) ) {
 
-VideoRecorder::VideoRecorder(const std::string &basename) : FrameGrabber(), basename_(basename)
+        Log::Info("Video Recording using hardware accelerated encoder (%s)", VideoRecorder::hardware_encoder[profile].c_str());
+        return VideoRecorder::hardware_profile_description[profile];
+    }
+
+    // revert to software encoder
+    return VideoRecorder::profile_description[profile];
+}
+
+VideoRecorder::VideoRecorder(const std::string &basename) : FrameGrabber(), basename_(basename),
+    profile_(H264_STANDARD), capture_mode_(0), audio_(false)
 {
     // first run initialization of hardware encoders in linux
 #if GST_GL_HAVE_PLATFORM_GLX
@@ -336,24 +365,40 @@ std::string VideoRecorder::init(GstCaps *caps)
     frame_duration_ = gst_util_uint64_scale_int (1, GST_SECOND, framerate_preset_value[Settings::application.record.framerate_mode]);
     timestamp_on_clock_ = Settings::application.record.priority_mode < 1;
 
+    // overflow on disk when the buffer is full
+    int spill_mode = CLAMP(Settings::application.record.spill_mode, 0, 4);
+    if (spill_mode > 0) {
+        // spill next to the recordings unless a folder is given (never in temp, often in RAM)
+        std::string folder = Settings::application.record.spill_path;
+        if (folder.empty() || !SystemToolkit::file_exists(folder))
+            folder = Settings::application.record.path;
+        GstVideoInfo v_frame;
+        if ( SystemToolkit::file_exists(folder) && gst_video_info_from_caps (&v_frame, caps) ) {
+            // reserve the file when recording starts (NB: not in the rendering thread)
+            spill_ = new FrameSpill(SystemToolkit::full_filename(folder, ""), spill_preset_value[spill_mode]);
+            if ( !spill_->allocate( GST_VIDEO_INFO_SIZE(&v_frame) ) ) {
+                delete spill_;
+                spill_ = nullptr;
+                Log::Warning("Video Recording : Overflow on disk disabled.");
+            }
+        }
+    }
+
     // create a gstreamer pipeline
     std::string description = "appsrc name=src ! videoconvert ! queue ! ";
     if (Settings::application.record.profile < 0 || Settings::application.record.profile >= DEFAULT)
         Settings::application.record.profile = H264_STANDARD;
+    profile_ = (Profile) Settings::application.record.profile;
 
-    // test for a hardware accelerated encoder
-    if (Settings::application.render.gpu_decoding && (int) hardware_encoder.size() > 0 &&
-            GstToolkit::has_feature(hardware_encoder[Settings::application.record.profile]) ) {
-
-        description += hardware_profile_description[Settings::application.record.profile];
-        Log::Info("Video Recording using hardware accelerated encoder (%s)", hardware_encoder[Settings::application.record.profile].c_str());
-    }
-    // revert to software encoder
+    // capture in a cheap intermediate file, transcoded in background after recording
+    capture_mode_ = profile_ == JPEG_MULTI ? 0 : CLAMP(Settings::application.record.capture_mode, 0, 2);
+    if (capture_mode_ > 0)
+        description += capture_description[capture_mode_];
     else
-        description += profile_description[Settings::application.record.profile];
+        description += encoder_description(profile_);
 
     // setup muxer and prepare filename
-    if( Settings::application.record.profile == JPEG_MULTI) {
+    if( profile_ == JPEG_MULTI) {
         std::string folder = SystemToolkit::filename_dateprefix(Settings::application.record.path, basename_, "");
         if (SystemToolkit::create_directory(folder)) {
             filename_ = SystemToolkit::full_filename(folder, "%05d.jpg");
@@ -372,36 +417,40 @@ std::string VideoRecorder::init(GstCaps *caps)
                 description += "mux. ";
                 description += Audio::manager().pipeline(current_audio);
                 description += " ! audio/x-raw ! audioconvert ! audioresample ! ";
-                // select encoder depending on codec
-                if ( Settings::application.record.profile == VP8)
+                // select encoder depending on codec (uncompressed when capturing)
+                if ( capture_mode_ > 0 )
+                    description += "queue ! ";
+                else if ( profile_ == VP8)
                     description += "opusenc ! opusparse ! queue ! ";
                 else
                     description += "voaacenc ! aacparse ! queue ! ";
+                audio_ = true;
 
                 Log::Info("Video Recording with audio (%s)", Audio::manager().pipeline(current_audio).c_str());
             }
         }
 
-        if ( Settings::application.record.profile == VP8) {
-            // if sequencial file naming
-            if (Settings::application.record.naming_mode == 0 )
-                filename_ = SystemToolkit::filename_sequential(Settings::application.record.path, basename_, "webm");
-            // or prefixed with date
-            else
-                filename_ = SystemToolkit::filename_dateprefix(Settings::application.record.path, basename_, "webm");
-
-            description += "webmmux name=mux ! filesink name=sink";
+        std::string muxer = "qtmux";
+        std::string extension = "mov";
+        if ( profile_ == VP8) {
+            muxer = "webmmux";
+            extension = "webm";
         }
-        else {
-            // if sequencial file naming
-            if (Settings::application.record.naming_mode == 0 )
-                filename_ = SystemToolkit::filename_sequential(Settings::application.record.path, basename_, "mov");
-            // or prefixed with date
-            else
-                filename_ = SystemToolkit::filename_dateprefix(Settings::application.record.path, basename_, "mov");
-
-            description += "qtmux name=mux ! filesink name=sink";
+
+        // if sequencial file naming
+        if (Settings::application.record.naming_mode == 0 )
+            filename_ = SystemToolkit::filename_sequential(Settings::application.record.path, basename_, extension);
+        // or prefixed with date
+        else
+            filename_ = SystemToolkit::filename_dateprefix(Settings::application.record.path, basename_, extension);
+
+        // intermediate file is next to the final file
+        if (capture_mode_ > 0) {
+            capture_filename_ = filename_.substr(0, filename_.size() - extension.size() - 1) + "_capture.mkv";
+            muxer = "matroskamux";
         }
+
+        description += muxer + " name=mux ! filesink name=sink";
     }
 
     // parse pipeline descriptor
@@ -415,7 +464,7 @@ std::string VideoRecorder::init(GstCaps *caps)
 
     // setup file sink
     g_object_set (G_OBJECT (gst_bin_get_by_name (GST_BIN (pipeline_), "sink")),
-                  "location", filename_.c_str(),
+                  "location", capture_mode_ > 0 ? capture_filename_.c_str() : filename_.c_str(),
                   "sync", FALSE,
                   NULL);
 
@@ -428,7 +477,8 @@ std::string VideoRecorder::init(GstCaps *caps)
                       "format", GST_FORMAT_TIME,
                       NULL);
 
-        if (timestamp_on_clock_)
+        // NB: frames spilled on disk are time stamped when captured
+        if (timestamp_on_clock_ && spill_ == nullptr)
             g_object_set (G_OBJECT (src_),"do-timestamp", TRUE,NULL);
 
         // configure stream
@@ -472,7 +522,10 @@ std::string VideoRecorder::init(GstCaps *caps)
     // all good
     initialized_ = true;
 
-    return std::string("Video Recording started ") + profile_name[Settings::application.record.profile];
+    if (capture_mode_ > 0)
+        return std::string("Video Recording started ") + capture_mode_name[capture_mode_] + " capture for " + profile_name[profile_];
+
+    return std::string("Video Recording started ") + profile_name[profile_];
 
 }
 
@@ -497,6 +550,13 @@ void VideoRecorder::terminate()
         Log::Info("Video Recording : try a lower resolution / a lower framerate / a larger buffer size / a faster codec.");
     }
 
+    // encode the intermediate file in background
+    if (capture_mode_ > 0) {
+        Transcoding::manager().add( new Transcoder(capture_filename_, filename_, profile_, audio_) );
+        Log::Notify("Video Recording %s captured, encoding in background.", capture_filename_.c_str());
+        return;
+    }
+
     // remember and inform
     Settings::application.recentRecordings.push(filename_);
     Log::Notify("Video Recording %s is ready.", filename_.c_str());
@@ -504,8 +564,372 @@ void VideoRecorder::terminate()
 
 std::string VideoRecorder::info() const
 {
+    std::string spilled;
+    if (spill_ != nullptr) {
+        std::lock_guard<std::mutex> lock(spill_lock_);
+        if (spill_->frames() > 0)
+            spilled = " (" + BaseToolkit::byte_to_string(spill_->bytes()) + " on disk)";
+    }
+
     if (initialized_ && !active_ && !endofstream_)
-        return "Saving file...";
+        return "Saving file..." + spilled;
+
+    return FrameGrabber::info() + spilled;
+}
+
+
+ReplayRecorder::ReplayRecorder(const std::string &basename) : FrameGrabber(), basename_(basename),
+    encoded_caps_(nullptr), replay_duration_(0), gops_size_(0)
+{
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+    // wait for saving to finish
+    if (saving_.valid())
+        saving_.wait();
+
+    clear();
+    if (encoded_caps_ != nullptr)
+        gst_caps_unref (encoded_caps_);
+}
+
+std::string ReplayRecorder::init(GstCaps *caps)
+{
+    // ignore
+    if (caps == nullptr)
+        return std::string("Invalid caps");
+
+    // apply settings
+    buffering_size_ = MIN_BUFFER_SIZE;
+    frame_duration_ = gst_util_uint64_scale_int (1, GST_SECOND, VideoRecorder::framerate_preset_value[Settings::application.record.framerate_mode]);
+    timestamp_on_clock_ = Settings::application.record.priority_mode < 1;
+    replay_duration_ = MAX(Settings::application.record.replay_duration, 1) * GST_SECOND;
+
+    // create a gstreamer pipeline encoding in memory
+    // NB: leaky queue drops frames rather than delaying rendering if encoder is too slow
+    std::string description = "appsrc name=src ! videoconvert ! queue leaky=downstream ! ";
+    if (Settings::application.record.profile < 0 || Settings::application.record.profile >= VideoRecorder::DEFAULT)
+        Settings::application.record.profile = VideoRecorder::H264_STANDARD;
+    description += VideoRecorder::encoder_description(Settings::application.record.profile);
+    description += "appsink name=sink";
+
+    // muxer used when saving to file
+    if ( Settings::application.record.profile == VideoRecorder::VP8) {
+        muxer_ = "webmmux";
+        extension_ = "webm";
+    }
+    else {
+        muxer_ = "qtmux";
+        extension_ = "mov";
+    }
+
+    // parse pipeline descriptor
+    GError *error = NULL;
+    pipeline_ = gst_parse_launch (description.c_str(), &error);
+    if (error != NULL) {
+        std::string msg = std::string("Instant replay : Could not construct pipeline ") + description + "\n" + std::string(error->message);
+        g_clear_error (&error);
+        return msg;
+    }
+
+    // setup app sink to receive encoded frames
+    // encode at low priority: the leaky queue drops frames rather than
+    // taking processor time from rendering
+    GstToolkit::set_background_priority (pipeline_);
+
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline_), "sink");
+    if (sink) {
+        g_object_set (G_OBJECT (sink), "sync", FALSE, NULL);
+
+        GstAppSinkCallbacks callbacks;
+#if GST_VERSION_MINOR > 18 && GST_VERSION_MAJOR > 0
+        callbacks.new_event = NULL;
+#endif
+        callbacks.new_preroll = NULL;
+        callbacks.eos = NULL;
+        callbacks.new_sample = ReplayRecorder::callback_new_sample;
+        gst_app_sink_set_callbacks (GST_APP_SINK(sink), &callbacks, this, NULL);
+        gst_object_unref (sink);
+    }
+    else {
+        return std::string("Instant replay : Failed to configure encoder.");
+    }
+
+    // setup custom app source
+    src_ = GST_APP_SRC( gst_bin_get_by_name (GST_BIN (pipeline_), "src") );
+    if (src_) {
+
+        g_object_set (G_OBJECT (src_),
+                      "is-live", TRUE,
+                      "format", GST_FORMAT_TIME,
+                      NULL);
+
+        if (timestamp_on_clock_)
+            g_object_set (G_OBJECT (src_),"do-timestamp", TRUE,NULL);
+
+        // configure stream
+        gst_app_src_set_stream_type( src_, GST_APP_STREAM_TYPE_STREAM);
+        gst_app_src_set_latency( src_, -1, 0);
+
+        // minimal buffer size: frames are skipped if encoder is busy
+        gst_app_src_set_max_bytes( src_, buffering_size_);
+
+        // specify recorder framerate in the given caps
+        GstCaps *tmp = gst_caps_copy( caps );
+        GValue v = { 0, };
+        g_value_init (&v, GST_TYPE_FRACTION);
+        gst_value_set_fraction (&v, VideoRecorder::framerate_preset_value[Settings::application.record.framerate_mode], 1);
+        gst_caps_set_value(tmp, "framerate", &v);
+        g_value_unset (&v);
+
+        // instruct src to use the caps
+        caps_ = gst_caps_copy( tmp );
+        gst_app_src_set_caps (src_, caps_);
+        gst_caps_unref (tmp);
+
+        // setup callbacks
+        GstAppSrcCallbacks callbacks;
+        callbacks.need_data = FrameGrabber::callback_need_data;
+        callbacks.enough_data = FrameGrabber::callback_enough_data;
+        callbacks.seek_data = NULL; // stream type is not seekable
+        gst_app_src_set_callbacks (src_, &callbacks, this, NULL);
+
+    }
+    else {
+        return std::string("Instant replay : Failed to configure frame grabber.");
+    }
+
+    // start encoding
+    GstStateChangeReturn ret = gst_element_set_state (pipeline_, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        return std::string("Instant replay : Failed to start frame grabber.");
+    }
+
+    // all good
+    initialized_ = true;
+
+    return std::string("Instant replay keeps last ") + std::to_string(replay_duration_ / GST_SECOND)
+            + " seconds in " + VideoRecorder::profile_name[Settings::application.record.profile];
+}
+
+void ReplayRecorder::terminate()
+{
+    // stop the pipeline (again)
+    gst_element_set_state (pipeline_, GST_STATE_NULL);
+
+    // wait for saving to finish
+    if (saving_.valid()) {
+        std::string msg = saving_.get();
+        if (!msg.empty())
+            Log::Warning("%s", msg.c_str());
+    }
+
+    clear();
+    Log::Info("Instant replay stopped.");
+}
+
+void ReplayRecorder::addFrame(GstBuffer *buffer, GstCaps *caps)
+{
+    FrameGrabber::addFrame(buffer, caps);
+
+    // inform when saving finished
+    if (saving_.valid() && saving_.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) {
+        std::string msg = saving_.get();
+        if (msg.empty()) {
+            Settings::application.recentRecordings.push(filename_);
+            Log::Notify("Instant replay %s is ready.", filename_.c_str());
+        }
+        else
+            Log::Warning("%s", msg.c_str());
+    }
+}
+
+std::string ReplayRecorder::info() const
+{
+    if (saving())
+        return "Saving replay...";
+    if (active_)
+        return std::string("Replay ") + GstToolkit::time_to_string(available());
 
     return FrameGrabber::info();
 }
+
+void ReplayRecorder::clear()
+{
+    std::lock_guard<std::mutex> lock(gops_lock_);
+    for (auto gop = gops_.begin(); gop != gops_.end(); ++gop)
+        for (auto it = gop->begin(); it != gop->end(); ++it)
+            gst_buffer_unref(*it);
+    gops_.clear();
+    gops_size_ = 0;
+}
+
+GstClockTime ReplayRecorder::available() const
+{
+    std::lock_guard<std::mutex> lock(gops_lock_);
+    if (gops_.empty())
+        return 0;
+
+    return gops_.back().back()->pts - gops_.front().front()->pts;
+}
+
+bool ReplayRecorder::saving() const
+{
+    return saving_.valid();
+}
+
+void ReplayRecorder::save()
+{
+    // one file at a time
+    if (!active_ || saving())
+        return;
+
+    // get all encoded frames (NB: memory is not copied)
+    std::vector<GstBuffer *> buffers;
+    GstCaps *caps = nullptr;
+    gops_lock_.lock();
+    for (auto gop = gops_.begin(); gop != gops_.end(); ++gop)
+        for (auto it = gop->begin(); it != gop->end(); ++it)
+            buffers.push_back( gst_buffer_ref(*it) );
+    if (encoded_caps_ != nullptr)
+        caps = gst_caps_ref(encoded_caps_);
+    gops_lock_.unlock();
+
+    if (buffers.empty() || caps == nullptr) {
+        for (auto it = buffers.begin(); it != buffers.end(); ++it)
+            gst_buffer_unref(*it);
+        if (caps != nullptr)
+            gst_caps_unref(caps);
+        Log::Notify("Instant replay has nothing to save yet.");
+        return;
+    }
+
+    // if sequencial file naming
+    if (Settings::application.record.naming_mode == 0 )
+        filename_ = SystemToolkit::filename_sequential(Settings::application.record.path, basename_ + "_replay", extension_);
+    // or prefixed with date
+    else
+        filename_ = SystemToolkit::filename_dateprefix(Settings::application.record.path, basename_ + "_replay", extension_);
+
+    // write file in background
+    saving_ = std::async(std::launch::async, ReplayRecorder::mux, buffers, caps, filename_, muxer_);
+}
+
+std::string ReplayRecorder::mux(std::vector<GstBuffer *> buffers, GstCaps *caps, std::string filename, std::string muxer)
+{
+    std::string msg;
+    GstToolkit::background_priority();
+
+    // create a gstreamer pipeline to write encoded frames into a file
+    std::string description = "appsrc name=src ! " + muxer + " ! filesink name=sink";
+    GError *error = NULL;
+    GstElement *pipeline = gst_parse_launch (description.c_str(), &error);
+    if (error != NULL) {
+        msg = std::string("Instant replay : Could not construct pipeline ") + description + "\n" + std::string(error->message);
+        g_clear_error (&error);
+        for (auto it = buffers.begin(); it != buffers.end(); ++it)
+            gst_buffer_unref(*it);
+        gst_caps_unref(caps);
+        return msg;
+    }
+    GstToolkit::set_background_priority (pipeline);
+
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+    g_object_set (G_OBJECT (sink), "location", filename.c_str(), NULL);
+    gst_object_unref (sink);
+
+    GstAppSrc *src = GST_APP_SRC( gst_bin_get_by_name (GST_BIN (pipeline), "src") );
+    g_object_set (G_OBJECT (src), "format", GST_FORMAT_TIME, NULL);
+    gst_app_src_set_caps (src, caps);
+    gst_caps_unref(caps);
+
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    // push all frames, with timestamps starting at zero
+    GstClockTime offset = GST_BUFFER_DTS_IS_VALID(buffers.front()) ? buffers.front()->dts : buffers.front()->pts;
+    for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+        // get our own copy of metadata (NB: memory of the frame is not copied)
+        GstBuffer *frame = gst_buffer_make_writable(*it);
+        if (GST_BUFFER_PTS_IS_VALID(frame))
+            frame->pts = frame->pts > offset ? frame->pts - offset : 0;
+        if (GST_BUFFER_DTS_IS_VALID(frame))
+            frame->dts = frame->dts > offset ? frame->dts - offset : 0;
+        // NB: buffer will be unrefed by the appsrc
+        gst_app_src_push_buffer (src, frame);
+    }
+    gst_app_src_end_of_stream (src);
+
+    // wait for the muxer to finish the file
+    GstBus *bus = gst_element_get_bus (pipeline);
+    GstMessage *message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                                      (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    if (message != nullptr) {
+        if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR)
+            msg = std::string("Instant replay : Failed to save ") + filename;
+        gst_message_unref (message);
+    }
+    gst_object_unref (bus);
+
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (src);
+    gst_object_unref (pipeline);
+
+    return msg;
+}
+
+GstFlowReturn ReplayRecorder::callback_new_sample (GstAppSink *sink, gpointer p)
+{
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+    ReplayRecorder *rec = static_cast<ReplayRecorder *>(p);
+
+    if (sample != NULL && rec != nullptr) {
+
+        GstBuffer *buf = gst_sample_get_buffer (sample);
+        std::lock_guard<std::mutex> lock(rec->gops_lock_);
+
+        // keep caps of the encoded stream (needed by the muxer)
+        GstCaps *caps = gst_sample_get_caps (sample);
+        if ( caps != nullptr && (rec->encoded_caps_ == nullptr || !gst_caps_is_equal(caps, rec->encoded_caps_)) ) {
+            if (rec->encoded_caps_ != nullptr)
+                gst_caps_unref (rec->encoded_caps_);
+            rec->encoded_caps_ = gst_caps_ref (caps);
+            // previous frames cannot be decoded with new caps
+            for (auto gop = rec->gops_.begin(); gop != rec->gops_.end(); ++gop)
+                for (auto it = gop->begin(); it != gop->end(); ++it)
+                    gst_buffer_unref(*it);
+            rec->gops_.clear();
+            rec->gops_size_ = 0;
+        }
+
+        // a key frame starts a new group of pictures
+        if ( !GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT) )
+            rec->gops_.emplace_back();
+
+        // keep the frame (ignore frames before first key frame)
+        if ( !rec->gops_.empty() ) {
+            rec->gops_.back().push_back( gst_buffer_ref(buf) );
+            rec->gops_size_ += gst_buffer_get_size(buf);
+        }
+
+        // drop oldest groups of pictures when enough remain for the replay duration
+        // (read at every frame to follow changes of the setting)
+        rec->replay_duration_ = MAX(Settings::application.record.replay_duration, 1) * GST_SECOND;
+        while ( rec->gops_.size() > 1 ) {
+            GstClockTime newest = buf->pts;
+            GstClockTime second = rec->gops_[1].front()->pts;
+            if ( newest - second < rec->replay_duration_ && rec->gops_size_ < REPLAY_MAX_MEMORY )
+                break;
+            for (auto it = rec->gops_.front().begin(); it != rec->gops_.front().end(); ++it) {
+                rec->gops_size_ -= gst_buffer_get_size(*it);
+                gst_buffer_unref(*it);
+            }
+            rec->gops_.pop_front();
+        }
+    }
+
+    if (sample != NULL)
+        gst_sample_unref (sample);
+
+    return GST_FLOW_OK;
+}
@@ -2,14 +2,20 @@
 #define RECORDER_H
 
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <future>
 #include <string>
 
 
 #include <gst/pbutils/pbutils.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
 
 #include "FrameGrabber.h"
 
+#define REPLAY_MAX_MEMORY 536870912  // 512 MB of encoded frames
+
 class PNGRecorder : public FrameGrabber
 {
     std::string basename_;
@@ -32,6 +38,7 @@ class VideoRecorder : public FrameGrabber
 {
     std::string basename_;
     std::string filename_;
+    std::string capture_filename_;
 
     std::string init(GstCaps *caps) override;
     void terminate() override;
@@ -58,10 +65,58 @@ public:
     static const guint64 buffering_preset_value[6];
     static const char*   framerate_preset_name[3];
     static const int     framerate_preset_value[3];
+    static const char*   spill_preset_name[5];
+    static const guint64 spill_preset_value[5];
+    static const char*   capture_mode_name[3];
+    static const char*   capture_description[3];
+    // encoder of a profile (hardware accelerated if available)
+    static std::string encoder_description(int profile);
 
     VideoRecorder(const std::string &basename = std::string());
     std::string info() const override;
     std::string filename() const { return filename_; }
+
+private:
+    Profile profile_;
+    int capture_mode_;
+    bool audio_;
+};
+
+class ReplayRecorder : public FrameGrabber
+{
+    std::string basename_;
+    std::string filename_;
+
+    std::string init(GstCaps *caps) override;
+    void terminate() override;
+    void addFrame(GstBuffer *buffer, GstCaps *caps) override;
+
+    // ring of encoded groups of pictures (each starting with a key frame)
+    std::deque< std::vector<GstBuffer *> > gops_;
+    GstCaps *encoded_caps_;
+    GstClockTime replay_duration_;
+    guint64 gops_size_;
+    mutable std::mutex gops_lock_;
+    void clear();
+
+    // asynchronous saving to file
+    std::future<std::string> saving_;
+    std::string muxer_;
+    std::string extension_;
+    static std::string mux(std::vector<GstBuffer *> buffers, GstCaps *caps, std::string filename, std::string muxer);
+    static GstFlowReturn callback_new_sample (GstAppSink *, gpointer);
+
+public:
+
+    ReplayRecorder(const std::string &basename = std::string());
+    ~ReplayRecorder();
+    std::string info() const override;
+
+    // save the last encoded frames in a file, without re-encoding
+    void save();
+    bool saving() const;
+    // duration of encoded frames available to save
+    GstClockTime available() const;
 };
 
 
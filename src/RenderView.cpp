@@ -215,11 +215,8 @@ FrameBufferImage *RenderView::thumbnail ()
     // So we wait for a few frames of rendering before trying to capture a thumbnail
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-    // create and store a promise for a FrameBufferImage
-    thumbnailer_.emplace_back( std::promise<FrameBufferImage *>() );
-
     // future will return the promised FrameBufferImage
-    std::future<FrameBufferImage *> ft = thumbnailer_.back().get_future();
+    std::future<FrameBufferImage *> ft = requestThumbnail();
 
     try {
         // wait for a valid return value from promise
@@ -231,3 +228,11 @@ FrameBufferImage *RenderView::thumbnail ()
 
     return img;
 }
+
+std::future<FrameBufferImage *> RenderView::requestThumbnail ()
+{
+    // create and store a promise for a FrameBufferImage
+    thumbnailer_.emplace_back( std::promise<FrameBufferImage *>() );
+
+    return thumbnailer_.back().get_future();
+}
@@ -57,6 +57,8 @@ protected:
     // get a thumbnail outside of opengl context; wait for a promise to be fullfiled after draw
     void drawThumbnail();
     FrameBufferImage *thumbnail ();
+    // request a thumbnail without waiting; the future is fullfiled after next draw
+    std::future<FrameBufferImage *> requestThumbnail ();
     FrameBuffer *frame_thumbnail_;
 };
 
@@ -71,6 +71,8 @@
 #include "ControlManager.h"
 #include "ImageFilter.h"
 #include "Primitives.h"
+#include "Mesh.h"
+#include "FrameBuffer.h"
 
 #include "RenderingManager.h"
 
@@ -523,6 +525,11 @@ void Rendering::draw()
     // operate on main window context
     main_.makeCurrent();
 
+    // new frame for statistics of shading programs and scene graph
+    ShadingProgram::newFrame();
+    Node::newFrame();
+    FrameBufferPool::newFrame();
+
     // draw
     std::list<Rendering::RenderingCallback>::iterator iter;
     for (iter=draw_callbacks_.begin(); iter != draw_callbacks_.end(); ++iter)
@@ -1119,6 +1126,8 @@ void RenderingWindow::terminate()
     if (window_ != NULL) {
         // remove global ref to pointers
         Rendering::manager().windows_.erase(window_);
+        // vertex arrays of meshes are destroyed with the window
+        Mesh::releaseContext(window_);
         // delete window
         glfwDestroyWindow(window_);
     }
@@ -35,12 +35,22 @@
 #include "Scene.h"
 
 #define DEBUG_SCENE 0
+
+// groups with many children index their picking bounds in a grid
+#define PICKING_INDEX_MIN 16
+#define PICKING_GRID 8
 #if DEBUG_SCENE
 static int num_nodes_ = 0;
 #endif
 
 // Node
-Node::Node() : initialized_(false), visible_(true), refcount_(0)
+uint Node::nodes_updated_ = 0;
+uint Node::transforms_computed_ = 0;
+uint Node::last_nodes_updated_ = 0;
+uint Node::last_transforms_computed_ = 0;
+
+Node::Node() : initialized_(false), transform_changed_(false), visible_(true), refcount_(0),
+    picking_margin_(0.f), picking_changed_(false)
 {
     // create unique id
     id_ = BaseToolkit::uniqueId();
@@ -51,6 +61,11 @@ Node::Node() : initialized_(false), visible_(true), refcount_(0)
     translation_ = glm::vec3(0.f);
     crop_ = glm::vec4(-1.f, 1.f, 1.f, -1.f);
     data_ = glm::zero<glm::mat4>();
+
+    // identity transform_ matches default attributes
+    transform_scale_ = scale_;
+    transform_rotation_ = rotation_;
+    transform_translation_ = translation_;
 #if DEBUG_SCENE
     num_nodes_++;
 #endif
@@ -85,6 +100,25 @@ void Node::copyTransform(const Node *other)
     translation_ = other->translation_;
     crop_ = other->crop_;
     data_ = other->data_;
+    transform_changed_ = true;
+}
+
+void Node::newFrame()
+{
+    last_nodes_updated_ = nodes_updated_;
+    last_transforms_computed_ = transforms_computed_;
+    nodes_updated_ = 0;
+    transforms_computed_ = 0;
+}
+
+uint Node::nodesUpdated()
+{
+    return last_nodes_updated_;
+}
+
+uint Node::transformsComputed()
+{
+    return last_transforms_computed_;
 }
 
 void Node::update( float dt)
@@ -103,8 +137,20 @@ void Node::update( float dt)
             ++iter;
     }
 
-    // update transform matrix from attributes
-    transform_ = GlmToolkit::transform(translation_, rotation_, scale_);
+    // update transform matrix from attributes, only if they changed
+    if ( transform_changed_ || translation_ != transform_translation_
+         || rotation_ != transform_rotation_ || scale_ != transform_scale_ ) {
+        transform_ = GlmToolkit::transform(translation_, rotation_, scale_);
+        transform_translation_ = translation_;
+        transform_rotation_ = rotation_;
+        transform_scale_ = scale_;
+        transform_changed_ = false;
+        ++transforms_computed_;
+        picking_changed_ = true;
+    }
+    else
+        picking_changed_ = false;
+    ++nodes_updated_;
 }
 
 void Node::accept(Visitor& v)
@@ -124,37 +170,38 @@ Primitive::~Primitive()
         delete shader_;
 }
 
-void Primitive::init()
+uint Primitive::createVertexArray(const std::vector<glm::vec3> &points,
+                                  const std::vector<glm::vec4> &colors,
+                                  const std::vector<glm::vec2> &texCoords,
+                                  const std::vector<uint> &indices)
 {
-    if ( vao_ )
-        glDeleteVertexArrays ( 1, &vao_);
-
     // Vertex Array
-    glGenVertexArrays( 1, &vao_ );
+    uint vao = 0;
+    glGenVertexArrays( 1, &vao );
     // Create and initialize buffer objects
     uint arrayBuffer_;
     uint elementBuffer_;
     glGenBuffers( 1, &arrayBuffer_ );
     glGenBuffers( 1, &elementBuffer_);
-    glBindVertexArray( vao_ );
+    glBindVertexArray( vao );
 
     // compute the memory needs for points
-    std::size_t sizeofPoints = sizeof(glm::fvec3) * points_.size();
-    std::size_t sizeofColors = sizeof(glm::fvec4) * colors_.size();
-    std::size_t sizeofTexCoords = sizeof(glm::fvec2) * texCoords_.size();
+    std::size_t sizeofPoints = sizeof(glm::fvec3) * points.size();
+    std::size_t sizeofColors = sizeof(glm::fvec4) * colors.size();
+    std::size_t sizeofTexCoords = sizeof(glm::fvec2) * texCoords.size();
 
     // setup the array buffers for vertices
     glBindBuffer( GL_ARRAY_BUFFER, arrayBuffer_ );
     glBufferData( GL_ARRAY_BUFFER, sizeofPoints + sizeofColors + sizeofTexCoords, NULL, GL_STATIC_DRAW);
-    glBufferSubData( GL_ARRAY_BUFFER, 0, sizeofPoints, &points_[0] );
-    glBufferSubData( GL_ARRAY_BUFFER, sizeofPoints, sizeofColors, &colors_[0] );
+    glBufferSubData( GL_ARRAY_BUFFER, 0, sizeofPoints, points.data() );
+    glBufferSubData( GL_ARRAY_BUFFER, sizeofPoints, sizeofColors, colors.data() );
     if ( sizeofTexCoords )
-        glBufferSubData( GL_ARRAY_BUFFER, sizeofPoints + sizeofColors, sizeofTexCoords, &texCoords_[0] );
+        glBufferSubData( GL_ARRAY_BUFFER, sizeofPoints + sizeofColors, sizeofTexCoords, texCoords.data() );
 
     // setup the element array for the triangle indices
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer_);
-    std::size_t sizeofIndices = indices_.size() * sizeof(GLuint);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeofIndices, &(indices_[0]), GL_STATIC_DRAW);
+    std::size_t sizeofIndices = indices.size() * sizeof(GLuint);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeofIndices, indices.data(), GL_STATIC_DRAW);
 
     // explain how to read attributes 0, 1 and 2 (for point, color and textcoord respectively)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::fvec3), (void *)0 );
@@ -170,15 +217,26 @@ void Primitive::init()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    // drawing indications
-    drawCount_ = indices_.size();
-
     // delete temporary buffers
     if ( arrayBuffer_ )
         glDeleteBuffers ( 1, &arrayBuffer_);
     if ( elementBuffer_ )
         glDeleteBuffers ( 1, &elementBuffer_);
 
+    return vao;
+}
+
+void Primitive::init()
+{
+    if ( vao_ )
+        glDeleteVertexArrays ( 1, &vao_);
+
+    // Vertex Array
+    vao_ = createVertexArray(points_, colors_, texCoords_, indices_);
+
+    // drawing indications
+    drawCount_ = indices_.size();
+
     // compute AxisAlignedBoundingBox
     bbox_.extend(points_);
 
@@ -270,6 +328,7 @@ void Group::clear()
         // erase this iterator from the list
         it = children_.erase(it);
     }
+    picking_dirty_ = true;
 }
 
 void Group::attach(Node *child)
@@ -277,6 +336,7 @@ void Group::attach(Node *child)
     if (child != nullptr) {
         children_.insert(child);
         child->refcount_++;
+        picking_dirty_ = true;
     }
 }
 
@@ -287,6 +347,7 @@ void Group::sort()
     for(auto it = children_.begin(); it != children_.end(); it++)
         ordered_children.insert(*it);
     children_.swap(ordered_children);
+    picking_dirty_ = true;
 }
 
 void Group::detach(Node *child)
@@ -299,8 +360,30 @@ void Group::detach(Node *child)
             // detatch child from group parent
             children_.erase(it);
             child->refcount_--;
+            picking_dirty_ = true;
+        }
+    }
+}
+
+// union of the picking bounds of children, in parent coordinates
+template <class Iterator>
+static bool pickingUnion(Iterator begin, Iterator end,
+                         GlmToolkit::AxisAlignedBoundingBox &bounds, float &margin)
+{
+    GlmToolkit::AxisAlignedBoundingBox b;
+    float m = 0.f;
+    for (Iterator node = begin; node != end; ++node) {
+        if ( !(*node)->pickingBounds().isNull() ) {
+            b.extend( (*node)->pickingBounds().transformed( (*node)->transform_ ) );
+            m = MAXI( m, (*node)->pickingMargin() );
         }
     }
+
+    // inform if changed
+    bool changed = b.min() != bounds.min() || b.max() != bounds.max() || m != margin;
+    bounds = b;
+    margin = m;
+    return changed;
 }
 
 void Group::update( float dt )
@@ -308,10 +391,96 @@ void Group::update( float dt )
     Node::update(dt);
 
     // update every child node
+    // (hidden ones too: forced picking visits them)
+    bool changed = picking_dirty_;
     for (NodeSet::iterator node = children_.begin();
          node != children_.end(); ++node) {
         (*node)->update ( dt );
+        changed |= (*node)->pickingChanged();
+    }
+
+    // update bounds only if a child moved or changed
+    if ( changed ) {
+        if ( pickingUnion(children_.begin(), children_.end(), picking_bounds_, picking_margin_) )
+            picking_changed_ = true;
+        pickingIndex();
+        picking_dirty_ = false;
+    }
+}
+
+// range of grid cells covered by bounds on one axis
+static void pickingCells(float min, float max, float grid_min, float grid_max, int &from, int &to)
+{
+    float extent = grid_max - grid_min;
+    if ( extent > 0.f ) {
+        float last = (float) (PICKING_GRID - 1);
+        from = (int) CLAMP( (min - grid_min) / extent * PICKING_GRID, 0.f, last);
+        to   = (int) CLAMP( (max - grid_min) / extent * PICKING_GRID, 0.f, last);
     }
+    else
+        from = to = 0;
+}
+
+void Group::pickingIndex()
+{
+    picking_nodes_.clear();
+    picking_grid_.clear();
+    picking_unbounded_.clear();
+
+    // not worth it for few children
+    if ( children_.size() < PICKING_INDEX_MIN || picking_bounds_.isNull() )
+        return;
+
+    // place each child in the cells covered by its bounds
+    picking_grid_.resize(PICKING_GRID * PICKING_GRID);
+    glm::vec3 gmin = picking_bounds_.min();
+    glm::vec3 gmax = picking_bounds_.max();
+    for (NodeSet::iterator node = children_.begin(); node != children_.end(); ++node) {
+        uint index = picking_nodes_.size();
+        picking_nodes_.push_back(*node);
+        // children without bounds are always given
+        if ( (*node)->pickingBounds().isNull() ) {
+            picking_unbounded_.push_back(index);
+            continue;
+        }
+        GlmToolkit::AxisAlignedBoundingBox bb = (*node)->pickingBounds().transformed( (*node)->transform_ );
+        int x0, x1, y0, y1;
+        pickingCells(bb.min().x, bb.max().x, gmin.x, gmax.x, x0, x1);
+        pickingCells(bb.min().y, bb.max().y, gmin.y, gmax.y, y0, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                picking_grid_[y * PICKING_GRID + x].push_back(index);
+    }
+}
+
+bool Group::pickingCandidates(const GlmToolkit::AxisAlignedBoundingBox &box, std::vector<Node *> &nodes) const
+{
+    if ( picking_dirty_ || picking_grid_.empty() || box.isNull() )
+        return false;
+
+    // indices of children in the cells covered by the box
+    std::vector<uint> indices = picking_unbounded_;
+    if ( box.intersect(picking_bounds_) ) {
+        glm::vec3 gmin = picking_bounds_.min();
+        glm::vec3 gmax = picking_bounds_.max();
+        int x0, x1, y0, y1;
+        pickingCells(box.min().x, box.max().x, gmin.x, gmax.x, x0, x1);
+        pickingCells(box.min().y, box.max().y, gmin.y, gmax.y, y0, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x) {
+                const std::vector<uint> &cell = picking_grid_[y * PICKING_GRID + x];
+                indices.insert(indices.end(), cell.begin(), cell.end());
+            }
+    }
+
+    // in depth order, once each
+    std::sort(indices.begin(), indices.end());
+    indices.erase( std::unique(indices.begin(), indices.end()), indices.end() );
+    nodes.clear();
+    for (auto i = indices.begin(); i != indices.end(); ++i)
+        nodes.push_back( picking_nodes_[*i] );
+
+    return true;
 }
 
 void Group::draw(glm::mat4 modelview, glm::mat4 projection)
@@ -388,6 +557,7 @@ void Switch::clear()
 
     // reset active
     active_ = 0;
+    picking_dirty_ = true;
 }
 
 
@@ -396,8 +566,18 @@ void Switch::update( float dt )
     Node::update(dt);
 
     // update active child node
-    if (!children_.empty())
+    bool changed = picking_dirty_;
+    if (!children_.empty()) {
         (children_[active_])->update( dt );
+        changed |= (children_[active_])->pickingChanged();
+    }
+
+    // bounds of all children, as active child can change before next update
+    if ( changed ) {
+        if ( pickingUnion(children_.begin(), children_.end(), picking_bounds_, picking_margin_) )
+            picking_changed_ = true;
+        picking_dirty_ = false;
+    }
 }
 
 void Switch::draw(glm::mat4 modelview, glm::mat4 projection)
@@ -436,6 +616,7 @@ uint Switch::attach(Node *child)
 {
     children_.push_back(child);
     child->refcount_++;
+    picking_dirty_ = true;
 
     // make new child active
     active_ = children_.size() - 1;
@@ -454,6 +635,7 @@ void Switch::detatch(Node *child)
         // detatch child from group parent
         children_.erase(it);
         child->refcount_--;
+        picking_dirty_ = true;
     }
 }
 
@@ -24,7 +24,8 @@ class Group;
  *
  * Every Node has geometric operations for translation,
  * scale and rotation. The update() function computes the
- * transform_ matrix from these components.
+ * transform_ matrix from these components, only when they
+ * changed since the previous update.
  *
  * draw() shall be defined by the subclass.
  * The visible flag can be used to show/hide a Node.
@@ -42,6 +43,12 @@ class Node {
     uint64_t  id_;
     bool      initialized_;
 
+    // attributes used to compute transform_
+    glm::vec3 transform_scale_, transform_rotation_, transform_translation_;
+    bool      transform_changed_;
+    static uint nodes_updated_, transforms_computed_;
+    static uint last_nodes_updated_, last_transforms_computed_;
+
 public:
     Node ();
     virtual ~Node ();
@@ -64,6 +71,18 @@ public:
 
     void copyTransform (const Node *other);
 
+    // count of nodes updated and of transforms computed during last frame
+    static void newFrame();
+    static uint nodesUpdated();
+    static uint transformsComputed();
+
+    // bounds of the interactive content of the node (in local coordinates),
+    // with a margin in scene coordinates for decorations of constant size
+    inline GlmToolkit::AxisAlignedBoundingBox pickingBounds () const { return picking_bounds_; }
+    inline float pickingMargin () const { return picking_margin_; }
+    // true if transform or bounds changed during last update
+    inline bool pickingChanged () const { return picking_changed_; }
+
     // public members, to manipulate with care
     bool      visible_;
     uint      refcount_;
@@ -78,6 +97,11 @@ public:
     // list of callbacks to call at each update
     std::list<UpdateCallback *> update_callbacks_;
     void clearCallbacks();
+
+protected:
+    GlmToolkit::AxisAlignedBoundingBox picking_bounds_;
+    float picking_margin_;
+    bool  picking_changed_;
 };
 
 
@@ -119,6 +143,12 @@ protected:
     std::vector<glm::vec2>     texCoords_;
     std::vector<uint>          indices_;
     GlmToolkit::AxisAlignedBoundingBox     bbox_;
+
+    // create a STATIC vertex array object from arrays of vertices
+    static uint createVertexArray(const std::vector<glm::vec3> &points,
+                                  const std::vector<glm::vec4> &colors,
+                                  const std::vector<glm::vec2> &texCoords,
+                                  const std::vector<uint> &indices);
 };
 
 //
@@ -159,12 +189,15 @@ private:
  * update() will update all children
  * draw() will draw all children
  *
+ * update() also maintains the bounds of the interactive content
+ * of its children, so that picking can skip the whole group.
+ *
  * When a group is deleted, the children are NOT deleted.
  */
 class Group : public Node {
 
 public:
-    Group() : Node() {}
+    Group() : Node(), picking_dirty_(true) {}
     virtual ~Group();
 
     // Node interface
@@ -185,8 +218,20 @@ public:
     Node *front() const;
     Node *back() const;
 
+    // bounds of children not computed since last change in the list
+    inline bool pickingDirty () const { return picking_dirty_; }
+    // children which picking bounds may overlap the box (in local coordinates),
+    // in depth order; false if not indexed (few children, or changed since update)
+    bool pickingCandidates (const GlmToolkit::AxisAlignedBoundingBox &box, std::vector<Node *> &nodes) const;
+
 protected:
     NodeSet children_;
+    bool picking_dirty_;
+    // grid of picking bounds of children, for groups with many children
+    std::vector<Node *> picking_nodes_;
+    std::vector< std::vector<uint> > picking_grid_;
+    std::vector<uint> picking_unbounded_;
+    void pickingIndex ();
 
 };
 
@@ -200,7 +245,7 @@ protected:
 class Switch : public Node {
 
 public:
-    Switch() : Node(), active_(0) {}
+    Switch() : Node(), active_(0), picking_dirty_(true) {}
     virtual ~Switch();
 
     // Node interface
@@ -220,9 +265,13 @@ public:
     Node *activeChild () const { return child(active_); }
     Node *child (uint index) const;
 
+    // bounds of children not computed since last change in the list
+    inline bool pickingDirty () const { return picking_dirty_; }
+
 protected:
     uint active_;
     std::vector<Node *> children_;
+    bool picking_dirty_;
 };
 
 
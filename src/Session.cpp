@@ -44,7 +44,8 @@ SessionNote::SessionNote(const std::string &t, bool l, int s): label(std::to_str
 }
 
 Session::Session(uint64_t id) : id_(id), active_(true), activation_threshold_(MIXING_MIN_THRESHOLD),
-    filename_(""), thumbnail_(nullptr), ready_(false)
+    filename_(""), sources_name_version_(0),
+    thumbnail_(nullptr), ready_(false), rendered_sources_(0), skipped_sources_(0)
 {
     // create unique id
     if (id_ == 0)
@@ -176,6 +177,10 @@ void Session::update(float dt)
     if ( render_.frame() == nullptr )
         return;
 
+    // index sources renamed since last update
+    if ( sources_name_version_ != Source::renamed() )
+        indexNames();
+
     // listen to inputs
     for (auto k = input_callbacks_.begin(); k != input_callbacks_.end(); ++k)
     {
@@ -219,7 +224,7 @@ void Session::update(float dt)
                         {
                             // loop over all sources in Batch
                             for (auto sid = batch_[*v].begin(); sid != batch_[*v].end(); ++sid){
-                                SourceList::const_iterator sit = std::find_if(sources_.begin(), sources_.end(), Source::hasId(*sid));;
+                                SourceList::const_iterator sit = find(*sid);
                                 if ( sit != sources_.end()) {
                                     // generate a new callback from the model
                                     SourceCallback *forward = k->second.model_->clone();
@@ -243,7 +248,7 @@ void Session::update(float dt)
                     // go through all instances stored for that action
                     for (auto clb = k->second.instances_.begin(); clb != k->second.instances_.end(); ++clb) {
                         // find the source referenced by each instance
-                        SourceList::const_iterator sit = std::find_if(sources_.begin(), sources_.end(), Source::hasId(clb->first));;
+                        SourceList::const_iterator sit = find(clb->first);
                         // if the source is valid
                         if ( sit != sources_.end()) {
                             // either call the reverse if exists (stored as second element in pair)
@@ -266,6 +271,8 @@ void Session::update(float dt)
 
     // pre-render all sources
     ready_ = true;
+    rendered_sources_ = 0;
+    skipped_sources_ = 0;
     for( SourceList::iterator it = sources_.begin(); it != sources_.end(); ++it){
 
         // ensure the RenderSource is rendering *this* session
@@ -293,6 +300,11 @@ void Session::update(float dt)
             (*it)->update(dt);
             // render the source
             (*it)->render();
+            // count sources actually rendered
+            if ( (*it)->rendered() )
+                ++rendered_sources_;
+            else
+                ++skipped_sources_;
         }
     }
 
@@ -360,6 +372,8 @@ SourceList::iterator Session::addSource(Source *s)
         sources_.push_back(s);
         // return the iterator to the source created at the end
         its = --sources_.end();
+        // index the source
+        indexSource(its);
     }
 
     // unlock access
@@ -383,6 +397,8 @@ SourceList::iterator Session::deleteSource(Source *s)
         deleteInputCallbacks(s);
         // erase the source from the failed list
         failed_.erase(s);
+        // erase the source from index
+        unindexSource(its);
         // erase the source from the update list & get next element
         its = sources_.erase(its);
         // delete the source : safe now
@@ -411,6 +427,8 @@ SourceList::iterator Session::removeSource(Source *s)
         detachSource(s);
         // erase the source from the failed list
         failed_.erase(s);
+        // erase the source from index
+        unindexSource(its);
         // erase the source from the update list & get next element
         ret = sources_.erase(its);
     }
@@ -432,6 +450,8 @@ Source *Session::popSource()
         s = *its;
         // detach
         detachSource(s);
+        // erase the source from index
+        unindexSource(its);
         // erase the source from the update list & get next element
         sources_.erase(its);
     }
@@ -499,16 +519,148 @@ SourceList::iterator Session::end()
 
 SourceList::iterator Session::find(Source *s)
 {
-    return std::find(sources_.begin(), sources_.end(), s);
+    if (s == nullptr)
+        return sources_.end();
+
+    SourceList::iterator it = find(s->id());
+    if ( it != sources_.end() && *it == s )
+        return it;
+
+    return sources_.end();
 }
 
 SourceList::iterator Session::find(uint64_t id)
 {
-    return std::find_if(sources_.begin(), sources_.end(), Source::hasId(id));
+    auto i = sources_id_.find(id);
+    if ( i != sources_id_.end() )
+        return i->second;
+
+    return sources_.end();
+}
+
+// NB: called in the main thread after any renaming
+void Session::indexNames()
+{
+    std::lock_guard<std::mutex> lock(sources_name_lock_);
+
+    // keep the first source of the list in case of duplicate names
+    sources_name_.clear();
+    sources_name_count_.clear();
+    for(auto it = sources_.begin(); it != sources_.end(); ++it) {
+        sources_name_.emplace( (*it)->name(), it );
+        ++sources_name_count_[ (*it)->name() ];
+    }
+
+    sources_name_version_ = Source::renamed();
+}
+
+// NB: called in the main thread after adding a source at the end of the list
+void Session::indexSource(SourceList::iterator its)
+{
+    // keep the first source of the list in case of duplicate ids or names
+    sources_id_.emplace( (*its)->id(), its );
+
+    // renaming not indexed yet
+    if ( sources_name_version_ != Source::renamed() ) {
+        indexNames();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sources_name_lock_);
+    sources_name_.emplace( (*its)->name(), its );
+    ++sources_name_count_[ (*its)->name() ];
+}
+
+// NB: called in the main thread before removing a source from the list
+void Session::unindexSource(SourceList::iterator its)
+{
+    // another source with the same id takes its place
+    auto i = sources_id_.find( (*its)->id() );
+    if ( i != sources_id_.end() && i->second == its ) {
+        sources_id_.erase(i);
+        for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+            if ( it != its && (*it)->id() == (*its)->id() ) {
+                sources_id_.emplace( (*it)->id(), it );
+                break;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(sources_name_lock_);
+
+    // renaming not indexed yet: only forget the source (index is rebuilt at update)
+    if ( sources_name_version_ != Source::renamed() ) {
+        for (auto n = sources_name_.begin(); n != sources_name_.end(); ) {
+            if ( n->second == its )
+                n = sources_name_.erase(n);
+            else
+                ++n;
+        }
+        return;
+    }
+
+    const std::string name = (*its)->name();
+    auto c = sources_name_count_.find(name);
+    if ( c == sources_name_count_.end() || c->second < 2 ) {
+        sources_name_count_.erase(name);
+        sources_name_.erase(name);
+    }
+    else {
+        --c->second;
+        // another source with the same name takes its place
+        if ( sources_name_[name] == its ) {
+            for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+                if ( it != its && (*it)->name() == name ) {
+                    sources_name_[name] = it;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// NB: called in the main thread after moving a source in the list
+void Session::reindexSource(SourceList::iterator its)
+{
+    // the first source of the list with the same id or name may change
+    for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+        if ( (*it)->id() == (*its)->id() ) {
+            sources_id_[(*it)->id()] = it;
+            break;
+        }
+    }
+
+    if ( sources_name_version_ != Source::renamed() ) {
+        indexNames();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sources_name_lock_);
+    if ( sources_name_count_[(*its)->name()] > 1 ) {
+        for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+            if ( (*it)->name() == (*its)->name() ) {
+                sources_name_[(*it)->name()] = it;
+                break;
+            }
+        }
+    }
 }
 
 SourceList::iterator Session::find(std::string namesource)
 {
+    {
+        std::lock_guard<std::mutex> lock(sources_name_lock_);
+
+        // use the index if no source was renamed since it was built
+        if ( sources_name_version_ == Source::renamed() ) {
+            auto i = sources_name_.find(namesource);
+            if ( i != sources_name_.end() )
+                return i->second;
+            return sources_.end();
+        }
+    }
+
+    // renaming not indexed yet
     return std::find_if(sources_.begin(), sources_.end(), Source::hasName(namesource));
 }
 
@@ -603,9 +755,9 @@ void Session::move(int current_index, int target_index)
     if ( target_index > current_index )
         ++to;
 
-    Source *s = (*from);
-    sources_.erase(from);
-    sources_.insert(to, s);
+    // move the element without invalidating indexed iterators
+    sources_.splice(to, sources_, from);
+    reindexSource(from);
 }
 
 bool Session::hasLink (SourceList sources)
@@ -754,7 +906,10 @@ SourceList Session::getBatch(size_t i) const
     {
         for (auto sid = batch_[i].begin(); sid != batch_[i].end(); ++sid){
 
-            SourceList::const_iterator it = std::find_if(sources_.begin(), sources_.end(), Source::hasId( *sid));;
+            SourceList::const_iterator it = sources_.end();
+            auto i = sources_id_.find( *sid );
+            if ( i != sources_id_.end() )
+                it = i->second;
             if ( it != sources_.end())
                 list.push_back( *it);
 
@@ -769,7 +924,7 @@ void Session::validate (SourceList &sources)
     // verify that all sources given are valid in the sesion
     // and remove the invalid sources
     for (auto _it = sources.begin(); _it != sources.end(); ) {
-        SourceList::iterator found = std::find(sources_.begin(), sources_.end(), *_it);
+        SourceList::iterator found = find(*_it);
         if ( found == sources_.end() )
             _it = sources.erase(_it);
         else
@@ -3,6 +3,7 @@
 
 #include <mutex>
 #include <variant>
+#include <unordered_map>
 
 #include "SourceList.h"
 #include "RenderView.h"
@@ -102,6 +103,10 @@ public:
     void setActive (bool on);
     inline bool active () { return active_; }
 
+    // number of sources rendered and skipped (unchanged) in last update
+    inline uint renderedSources () const { return rendered_sources_; }
+    inline uint skippedSources () const { return skipped_sources_; }
+
     // return the list of sources which failed
     SourceListUnique failedSources () const { return failed_; }
     void deleteFailedSources ();
@@ -111,6 +116,7 @@ public:
 
     // get an newly rendered thumbnail
     inline FrameBufferImage *renderThumbnail () { return render_.thumbnail(); }
+    inline std::future<FrameBufferImage *> requestThumbnail () { return render_.requestThumbnail(); }
 
     // get / set thumbnail image
     inline FrameBufferImage *thumbnail () const { return thumbnail_; }
@@ -195,6 +201,16 @@ protected:
     SourceListUnique failed_;
     SourceList sources_;
     void validate(SourceList &sources);
+    // index of sources by id and by name
+    std::unordered_map<uint64_t, SourceList::iterator> sources_id_;
+    std::unordered_map<std::string, SourceList::iterator> sources_name_;
+    std::unordered_map<std::string, uint> sources_name_count_;
+    uint64_t sources_name_version_;
+    std::mutex sources_name_lock_;
+    void indexNames();
+    void indexSource(SourceList::iterator its);
+    void unindexSource(SourceList::iterator its);
+    void reindexSource(SourceList::iterator its);
     std::list<SessionNote> notes_;
     std::list<MixingGroup *> mixing_groups_;
     std::map<View::Mode, Group*> config_;
@@ -204,6 +220,8 @@ protected:
     FrameBufferImage *thumbnail_;
     uint64_t start_time_;
     bool ready_;
+    uint rendered_sources_;
+    uint skipped_sources_;
 
     struct Fading
     {
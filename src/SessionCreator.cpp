@@ -18,6 +18,14 @@
 **/
 
 #include <sstream>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include "Log.h"
 #include "defines.h"
@@ -44,6 +52,7 @@
 #include "ImageProcessingShader.h"
 #include "MediaPlayer.h"
 #include "SystemToolkit.h"
+#include "BaseToolkit.h"
 #include "SessionVisitor.h"
 
 #include "tinyxml2Toolkit.h"
@@ -51,12 +60,142 @@ using namespace tinyxml2;
 
 #include "SessionCreator.h"
 
+static std::string infoDescription(const XMLElement *header)
+{
+    std::string description;
+
+    if (header != nullptr) {
+        uint s = header->UnsignedAttribute("size");
+        description = std::to_string( s ) + " source" + ( s > 1 ? "s" : "");
+        uint t = header->UnsignedAttribute("total");
+        if (t>s)
+            description += " (" + std::to_string(t) + " in total)";
+        description += "\n";
+        const char *att_string = header->Attribute("resolution");
+        if (att_string)
+            description += std::string( att_string ) + "\n";
+        att_string = header->Attribute("date");
+        if (att_string) {
+            std::string date( att_string );
+            description += date.substr(6,2) + "/" + date.substr(4,2) + "/" + date.substr(0,4) + " @ ";
+            description += date.substr(8,2) + ":" + date.substr(10,2);
+        }
+    }
+
+    return description;
+}
+
+// find the closing tag of the root Session element, skipping the
+// Session elements nested in group and bundle sources.
+// Scanning resumes from pos when more content is appended.
+static size_t scanSessionEnd(const std::string& content, size_t &pos, int &depth)
+{
+    while (true) {
+        size_t o = content.find("<Session", pos);
+        size_t c = content.find("</Session>", pos);
+
+        // closing tag first
+        if ( c != std::string::npos && ( o == std::string::npos || c < o ) ) {
+            pos = c + 10;
+            if ( --depth < 1 )
+                return c;
+            continue;
+        }
+
+        // opening tag (wait for it to be complete)
+        if ( o != std::string::npos ) {
+            size_t g = content.find('>', o);
+            if ( g == std::string::npos )
+                break;
+            char n = content[o + 8];
+            if ( n == '>' || n == '/' || ::isspace(n) ) {
+                if ( content[g - 1] != '/' )
+                    ++depth;
+            }
+            pos = g + 1;
+            continue;
+        }
+
+        // nothing found; keep the end in case a tag is split
+        if ( content.size() > pos + 16 )
+            pos = content.size() - 16;
+        break;
+    }
+
+    return std::string::npos;
+}
+
+// read header and thumbnail without parsing the whole file:
+// the header is the first element, and the thumbnail is the last
+// element of the Session, saved after all sources
+static bool scanInfo(const std::string& filename, SessionInformation &ret)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // read until the end of the Session element (skip views, snapshots, etc.)
+    std::string content;
+    size_t end = std::string::npos;
+    size_t pos = 0;
+    int depth = 0;
+    char chunk[65536];
+    while ( end == std::string::npos && file.read(chunk, sizeof(chunk)).gcount() > 0 ) {
+        content.append(chunk, file.gcount());
+        end = scanSessionEnd(content, pos, depth);
+    }
+    if ( end == std::string::npos )
+        return false;
+
+    // impose C locale
+    setlocale(LC_ALL, "C");
+
+    // parse the header element alone
+    size_t h = content.find("<" APP_NAME);
+    size_t e = content.find('>', h);
+    if ( h == std::string::npos || e == std::string::npos || e > end )
+        return false;
+    std::string header = content.substr(h, e - h);
+    if ( !header.empty() && header.back() == '/' )
+        header.pop_back();
+    header += "/>";
+    XMLDocument doc;
+    if ( XMLResultError(doc.Parse(header.c_str()), false) )
+        return false;
+    ret.description = infoDescription( doc.FirstChildElement(APP_NAME) );
+
+    // the last Image before the end of Session is the thumbnail
+    // if nothing but its closing tag (or the Thumbnail closing tag) follows
+    size_t i = content.rfind("<Image", end);
+    size_t c = i == std::string::npos ? i : content.find("</Image>", i);
+    if ( c != std::string::npos && c < end ) {
+        c += 8;
+        std::string tail = content.substr(c, end - c);
+        tail.erase( std::remove_if(tail.begin(), tail.end(), ::isspace), tail.end() );
+        if ( tail.empty() || tail == "</Thumbnail>" ) {
+            std::string image = "<Thumbnail>" + content.substr(i, c - i) + "</Thumbnail>";
+            XMLDocument imagedoc;
+            if ( !XMLResultError(imagedoc.Parse(image.c_str()), false) ) {
+                ret.thumbnail = SessionLoader::XMLToImage( imagedoc.FirstChildElement("Thumbnail") );
+                ret.user_thumbnail_ = !tail.empty();
+            }
+        }
+    }
+
+    return true;
+}
+
 SessionInformation SessionCreator::info(const std::string& filename)
 {
     SessionInformation ret;
 
     // if the file exists
     if (SystemToolkit::file_exists(filename)) {
+
+        // fast read of header and thumbnail
+        if ( scanInfo(filename, ret) )
+            return ret;
+
         // impose C locale
         setlocale(LC_ALL, "C");
         // try to load the file
@@ -65,24 +204,8 @@ SessionInformation SessionCreator::info(const std::string& filename)
         // silently ignore on error
         if ( !XMLResultError(eResult, false)) {
 
-            const XMLElement *header = doc.FirstChildElement(APP_NAME);
-            if (header != nullptr) {
-                uint s = header->UnsignedAttribute("size");
-                ret.description = std::to_string( s ) + " source" + ( s > 1 ? "s" : "");
-                uint t = header->UnsignedAttribute("total");
-                if (t>s)
-                    ret.description += " (" + std::to_string(t) + " in total)";
-                ret.description += "\n";
-                const char *att_string = header->Attribute("resolution");
-                if (att_string)
-                    ret.description += std::string( att_string ) + "\n";
-                att_string = header->Attribute("date");
-                if (att_string) {
-                    std::string date( att_string );
-                    ret.description += date.substr(6,2) + "/" + date.substr(4,2) + "/" + date.substr(0,4) + " @ ";
-                    ret.description += date.substr(8,2) + ":" + date.substr(10,2);
-                }
-            }
+            ret.description = infoDescription( doc.FirstChildElement(APP_NAME) );
+
             const XMLElement *session = doc.FirstChildElement("Session");
             if (session != nullptr ) {
                 const XMLElement *thumbnailelement = session->FirstChildElement("Thumbnail");
@@ -101,6 +224,235 @@ SessionInformation SessionCreator::info(const std::string& filename)
     return ret;
 }
 
+// index of session files information, filled in background
+struct SessionInfoEntry {
+    unsigned long mtime = 0;
+    unsigned long size = 0;
+    bool ready = false;
+    bool pending = false;
+    std::string description;
+    bool user_thumbnail = false;
+    FrameBufferImage *thumbnail = nullptr;
+};
+static std::map<std::string, SessionInfoEntry> sessionInfoIndex;
+static std::deque<std::string> sessionInfoQueue;
+static std::mutex sessionInfoLock;
+static std::condition_variable sessionInfoCondition;
+
+// cache of session files information in settings directory
+#define SESSION_INFO_CACHE_MAX 500
+static std::string sessionInfoCacheDirectory()
+{
+    static std::string dir;
+    if (dir.empty()) {
+        dir = SystemToolkit::full_filename(SystemToolkit::settings_path(), "sessions");
+        if ( !SystemToolkit::file_exists(dir) && !SystemToolkit::create_directory(dir) )
+            Log::Info("Cannot create cache of sessions information in %s", dir.c_str());
+    }
+    return dir;
+}
+
+static std::string sessionInfoCacheFile(const std::string& filename)
+{
+    char name[32];
+    snprintf(name, 32, "%016lx.xml", (unsigned long) BaseToolkit::hash(filename.data(), filename.size()));
+    return SystemToolkit::full_filename(sessionInfoCacheDirectory(), name);
+}
+
+// remove cache of files that do not exist anymore, and the oldest
+// cache files above SESSION_INFO_CACHE_MAX
+static void sessionInfoCacheClean()
+{
+    std::list<std::string> cachefiles = SystemToolkit::list_directory( sessionInfoCacheDirectory(), { "*.xml" },
+                                                                       SystemToolkit::DATE_INVERSE);
+    size_t count = 0;
+    for (auto it = cachefiles.begin(); it != cachefiles.end(); ++it) {
+        XMLDocument doc;
+        const char *path = nullptr;
+        if ( !XMLResultError(doc.LoadFile(it->c_str()), false) && doc.FirstChildElement("SessionInfo") )
+            path = doc.FirstChildElement("SessionInfo")->Attribute("path");
+        if ( path == nullptr || !SystemToolkit::file_exists(path) || ++count > SESSION_INFO_CACHE_MAX )
+            SystemToolkit::remove_file(*it);
+    }
+}
+
+static bool sessionInfoCacheLoad(const std::string& filename, SessionInfoEntry &entry)
+{
+    XMLDocument doc;
+    if ( XMLResultError(doc.LoadFile(sessionInfoCacheFile(filename).c_str()), false) )
+        return false;
+
+    // cache is valid only for the same file modification time and size
+    const XMLElement *cache = doc.FirstChildElement("SessionInfo");
+    if (cache == nullptr || cache->Attribute("path", filename.c_str()) == nullptr
+            || (unsigned long) cache->Int64Attribute("mtime") != entry.mtime
+            || (unsigned long) cache->Int64Attribute("size") != entry.size )
+        return false;
+
+    const XMLElement *description = cache->FirstChildElement("Description");
+    if (description && description->GetText())
+        entry.description = description->GetText();
+    entry.user_thumbnail = cache->BoolAttribute("user_thumbnail");
+    entry.thumbnail = SessionLoader::XMLToImage(cache);
+
+    return true;
+}
+
+static void sessionInfoCacheSave(const std::string& filename, const SessionInfoEntry &entry)
+{
+    XMLDocument doc;
+    XMLElement *cache = doc.NewElement("SessionInfo");
+    cache->SetAttribute("path", filename.c_str());
+    cache->SetAttribute("mtime", (int64_t) entry.mtime);
+    cache->SetAttribute("size", (int64_t) entry.size);
+    cache->SetAttribute("user_thumbnail", entry.user_thumbnail);
+    doc.InsertEndChild(cache);
+
+    XMLElement *description = doc.NewElement("Description");
+    description->InsertEndChild( doc.NewText(entry.description.c_str()) );
+    cache->InsertEndChild(description);
+    if (entry.thumbnail) {
+        XMLElement *image = SessionVisitor::ImageToXML(entry.thumbnail, &doc);
+        if (image)
+            cache->InsertEndChild(image);
+    }
+
+    XMLSaveDoc(&doc, sessionInfoCacheFile(filename));
+}
+
+static void sessionInfoIndexing()
+{
+    Log::SetSubsystem("Session");
+
+    sessionInfoCacheClean();
+
+    std::unique_lock<std::mutex> lock(sessionInfoLock);
+
+    while (true) {
+        // wait for a file to read
+        sessionInfoCondition.wait(lock, []{ return !sessionInfoQueue.empty(); });
+        std::string filename = sessionInfoQueue.front();
+        sessionInfoQueue.pop_front();
+
+        auto it = sessionInfoIndex.find(filename);
+        if (it == sessionInfoIndex.end() || !it->second.pending)
+            continue;
+        bool ready = it->second.ready;
+        unsigned long mtime = it->second.mtime;
+        unsigned long size = it->second.size;
+
+        // access file and read information without locking the index
+        lock.unlock();
+        SessionInfoEntry entry;
+        entry.mtime = SystemToolkit::file_modification_time(filename);
+        entry.size = SystemToolkit::file_size(filename);
+        // information is up to date if the file did not change
+        bool changed = !ready || entry.mtime != mtime || entry.size != size;
+        if ( changed && !sessionInfoCacheLoad(filename, entry) ) {
+            SessionInformation info = SessionCreator::info(filename);
+            entry.description = info.description;
+            entry.user_thumbnail = info.user_thumbnail_;
+            entry.thumbnail = info.thumbnail;
+            sessionInfoCacheSave(filename, entry);
+        }
+        lock.lock();
+
+        // store, unless the entry was removed in the meantime
+        it = sessionInfoIndex.find(filename);
+        if (it == sessionInfoIndex.end() || !changed) {
+            if (it != sessionInfoIndex.end())
+                it->second.pending = false;
+            if (entry.thumbnail)
+                delete entry.thumbnail;
+        }
+        else {
+            if (it->second.thumbnail)
+                delete it->second.thumbnail;
+            entry.ready = true;
+            it->second = entry;
+        }
+    }
+}
+
+// add a file to the queue of indexing, return true if information is ready
+// NB: must be called with sessionInfoLock locked, and never accesses the file
+// (the indexing thread checks if the file changed)
+static bool sessionInfoRequest(const std::string& filename, bool urgent, bool check)
+{
+    static bool started = false;
+    if (!started) {
+        started = true;
+        std::thread(sessionInfoIndexing).detach();
+    }
+
+    SessionInfoEntry &entry = sessionInfoIndex[filename];
+
+    // already requested: only give priority if urgent
+    if (entry.pending) {
+        if (urgent && !sessionInfoQueue.empty() && sessionInfoQueue.front() != filename) {
+            auto q = std::find(sessionInfoQueue.begin(), sessionInfoQueue.end(), filename);
+            if (q != sessionInfoQueue.end()) {
+                sessionInfoQueue.erase(q);
+                sessionInfoQueue.push_front(filename);
+            }
+        }
+    }
+    // read if unknown, or check if the file changed
+    else if (!entry.ready || check) {
+        entry.pending = true;
+        if (urgent)
+            sessionInfoQueue.push_front(filename);
+        else
+            sessionInfoQueue.push_back(filename);
+        sessionInfoCondition.notify_one();
+    }
+
+    return entry.ready;
+}
+
+void SessionCreator::requestInfo(const std::list<std::string>& filenames)
+{
+    std::lock_guard<std::mutex> lock(sessionInfoLock);
+
+    // forget files not in the list
+    std::set<std::string> files(filenames.begin(), filenames.end());
+    for (auto it = sessionInfoIndex.begin(); it != sessionInfoIndex.end(); ) {
+        if ( files.count(it->first) < 1 ) {
+            if (it->second.thumbnail)
+                delete it->second.thumbnail;
+            it = sessionInfoIndex.erase(it);
+        }
+        else
+            ++it;
+    }
+    sessionInfoQueue.erase( std::remove_if(sessionInfoQueue.begin(), sessionInfoQueue.end(),
+                                           [&files](const std::string &f) { return files.count(f) < 1; }),
+                            sessionInfoQueue.end() );
+
+    // (re)index files in the list
+    for (auto it = filenames.begin(); it != filenames.end(); ++it)
+        sessionInfoRequest(*it, false, true);
+}
+
+bool SessionCreator::peekInfo(const std::string& filename, SessionInformation &info)
+{
+    std::lock_guard<std::mutex> lock(sessionInfoLock);
+    if ( !sessionInfoRequest(filename, true, false) )
+        return false;
+
+    // give a copy of the information
+    const SessionInfoEntry &entry = sessionInfoIndex[filename];
+    info.description = entry.description;
+    info.user_thumbnail_ = entry.user_thumbnail;
+    info.thumbnail = nullptr;
+    if (entry.thumbnail) {
+        info.thumbnail = new FrameBufferImage(entry.thumbnail->width, entry.thumbnail->height);
+        memcpy(info.thumbnail->rgb, entry.thumbnail->rgb, entry.thumbnail->width * entry.thumbnail->height * 3);
+    }
+
+    return true;
+}
+
 SessionCreator::SessionCreator(uint level): SessionLoader(nullptr, level)
 {
 
@@ -962,6 +1314,14 @@ void SessionLoader::visit(MediaPlayer &n)
             mediaplayerNode->QueryIntAttribute("sync_to_metronome", &sync_to_metronome);
             n.setSyncToMetronome( (Metronome::Synchronicity) sync_to_metronome);
 
+            uint frame_cache = 0;
+            mediaplayerNode->QueryUnsignedAttribute("frame_cache", &frame_cache);
+            n.setFrameCache(frame_cache);
+
+            bool preload = false;
+            mediaplayerNode->QueryBoolAttribute("preload", &preload);
+            n.setPreload(preload);
+
             /// obsolete
             // only read media player play attribute if the source has no play attribute (backward compatibility)
             if ( !xmlCurrent_->Attribute( "play" ) ) {
@@ -22,6 +22,7 @@ public:
     void load(tinyxml2::XMLElement *sessionNode);
     std::map< uint64_t, Source* > getSources() const;
     std::list< SourceList > getMixingGroups() const;
+    inline std::list< SourceIdList > getMixingGroupsId() const { return groups_sources_id_; }
 
     typedef enum {
         CLONE,
@@ -138,7 +139,14 @@ public:
 
     void load(const std::string& filename);
 
+    // read information of a session file (header and thumbnail)
     static SessionInformation info(const std::string& filename);
+
+    // information of session files read in background and cached on disk
+    // requestInfo (re)indexes the given files and forgets the others
+    // peekInfo returns false if not available yet (and requests it)
+    static void requestInfo(const std::list<std::string>& filenames);
+    static bool peekInfo(const std::string& filename, SessionInformation &info);
 };
 
 #endif // SESSIONCREATOR_H
@@ -393,7 +393,7 @@ void SessionFileSource::render()
 {
     if ( !initialized_ )
         init();
-    else {
+    else if ( needRender() ) {
         // render the media player into frame buffer
         renderbuffer_->begin();
         texturesurface_->draw(glm::identity<glm::mat4>(), renderbuffer_->projection());
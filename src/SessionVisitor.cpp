@@ -441,6 +441,9 @@ void SessionVisitor::visit(MediaPlayer &n)
         newelement->SetAttribute("software_decoding", n.softwareDecodingForced());
         newelement->SetAttribute("rewind_on_disabled", n.rewindOnDisabled());
         newelement->SetAttribute("sync_to_metronome", (int) n.syncToMetronome());
+        newelement->SetAttribute("preload", n.preload());
+        if (!n.preload())
+            newelement->SetAttribute("frame_cache", n.frameCache());
 
         // timeline
         XMLElement *timelineelement = xmlDoc_->NewElement("Timeline");
@@ -132,6 +132,7 @@ void Settings::Save(uint64_t runtime, const std::string &filename)
     applicationNode->SetAttribute("smooth_transition", application.smooth_transition);
     applicationNode->SetAttribute("save_snapshot", application.save_version_snapshot);
     applicationNode->SetAttribute("action_history_follow_view", application.action_history_follow_view);
+    applicationNode->SetAttribute("action_history_budget", application.action_history_budget);
     applicationNode->SetAttribute("show_tooptips", application.show_tooptips);
     applicationNode->SetAttribute("accept_connections", application.accept_connections);
     applicationNode->SetAttribute("pannel_main_mode", application.pannel_main_mode);
@@ -174,6 +175,7 @@ void Settings::Save(uint64_t runtime, const std::string &filename)
     RenderNode->SetAttribute("vsync", application.render.vsync);
     RenderNode->SetAttribute("multisampling", application.render.multisampling);
     RenderNode->SetAttribute("gpu_decoding", application.render.gpu_decoding);
+    RenderNode->SetAttribute("yuv_texturing", application.render.yuv_texturing);
     RenderNode->SetAttribute("ratio", application.render.ratio);
     RenderNode->SetAttribute("res", application.render.res);
     RenderNode->SetAttribute("custom_width", application.render.custom_width);
@@ -190,8 +192,15 @@ void Settings::Save(uint64_t runtime, const std::string &filename)
     RecordNode->SetAttribute("framerate_mode", application.record.framerate_mode);
     RecordNode->SetAttribute("buffering_mode", application.record.buffering_mode);
     RecordNode->SetAttribute("priority_mode", application.record.priority_mode);
+    RecordNode->SetAttribute("readback_depth", application.record.readback_depth);
+    RecordNode->SetAttribute("conversion_mode", application.record.conversion_mode);
     RecordNode->SetAttribute("naming_mode", application.record.naming_mode);
     RecordNode->SetAttribute("audio_device", application.record.audio_device.c_str());
+    RecordNode->SetAttribute("replay", application.record.replay);
+    RecordNode->SetAttribute("replay_duration", application.record.replay_duration);
+    RecordNode->SetAttribute("spill_mode", application.record.spill_mode);
+    RecordNode->SetAttribute("spill_path", application.record.spill_path.c_str());
+    RecordNode->SetAttribute("capture_mode", application.record.capture_mode);
     pRoot->InsertEndChild(RecordNode);
 
     // Transition
@@ -447,6 +456,7 @@ void Settings::Load(const string &filename)
             applicationNode->QueryBoolAttribute("smooth_transition", &application.smooth_transition);
             applicationNode->QueryBoolAttribute("save_snapshot", &application.save_version_snapshot);
             applicationNode->QueryBoolAttribute("action_history_follow_view", &application.action_history_follow_view);
+            applicationNode->QueryIntAttribute("action_history_budget", &application.action_history_budget);
             applicationNode->QueryBoolAttribute("show_tooptips", &application.show_tooptips);
             applicationNode->QueryBoolAttribute("accept_connections", &application.accept_connections);
             applicationNode->QueryBoolAttribute("pannel_always_visible", &application.pannel_always_visible);
@@ -495,6 +505,7 @@ void Settings::Load(const string &filename)
             rendernode->QueryIntAttribute("vsync", &application.render.vsync);
             rendernode->QueryIntAttribute("multisampling", &application.render.multisampling);
             rendernode->QueryBoolAttribute("gpu_decoding", &application.render.gpu_decoding);
+            rendernode->QueryBoolAttribute("yuv_texturing", &application.render.yuv_texturing);
             rendernode->QueryIntAttribute("ratio", &application.render.ratio);
             rendernode->QueryIntAttribute("res", &application.render.res);
             rendernode->QueryIntAttribute("custom_width", &application.render.custom_width);
@@ -511,7 +522,13 @@ void Settings::Load(const string &filename)
             recordnode->QueryIntAttribute("framerate_mode", &application.record.framerate_mode);
             recordnode->QueryIntAttribute("buffering_mode", &application.record.buffering_mode);
             recordnode->QueryIntAttribute("priority_mode", &application.record.priority_mode);
+            recordnode->QueryIntAttribute("readback_depth", &application.record.readback_depth);
+            recordnode->QueryIntAttribute("conversion_mode", &application.record.conversion_mode);
             recordnode->QueryIntAttribute("naming_mode", &application.record.naming_mode);
+            recordnode->QueryBoolAttribute("replay", &application.record.replay);
+            recordnode->QueryIntAttribute("replay_duration", &application.record.replay_duration);
+            recordnode->QueryIntAttribute("spill_mode", &application.record.spill_mode);
+            recordnode->QueryIntAttribute("capture_mode", &application.record.capture_mode);
 
             const char *path_ = recordnode->Attribute("path");
             if (path_)
@@ -524,6 +541,12 @@ void Settings::Load(const string &filename)
                 application.record.audio_device = std::string(dev_);
             else
                 application.record.audio_device = "";
+
+            const char *spill_ = recordnode->Attribute("spill_path");
+            if (spill_)
+                application.record.spill_path = std::string(spill_);
+            else
+                application.record.spill_path = "";
         }
 
         // Source
@@ -109,7 +109,14 @@ struct RecordConfig
     int buffering_mode;
     int priority_mode;
     int naming_mode;
+    int readback_depth;
+    int conversion_mode;
     std::string audio_device;
+    bool replay;
+    int replay_duration;
+    int spill_mode;
+    std::string spill_path;
+    int capture_mode;
 
     RecordConfig() : path("") {
         profile = 0;
@@ -120,7 +127,14 @@ struct RecordConfig
         buffering_mode = 2;
         priority_mode = 1;
         naming_mode = 1;
+        readback_depth = 3;
+        conversion_mode = 0;
         audio_device = "";
+        replay = false;
+        replay_duration = 30;
+        spill_mode = 0;
+        spill_path = "";
+        capture_mode = 0;
     }
 
 };
@@ -185,6 +199,7 @@ struct RenderConfig
     float fading;
     bool gpu_decoding;
     bool gpu_decoding_available;
+    bool yuv_texturing;
 
     RenderConfig() {
         disabled = false;
@@ -197,6 +212,7 @@ struct RenderConfig
         fading = 0.0;
         gpu_decoding = true;
         gpu_decoding_available = false;
+        yuv_texturing = false;
     }
 };
 
@@ -283,6 +299,7 @@ struct Application
     bool mouse_pointer_lock;
     std::vector<float> mouse_pointer_strength;
     bool action_history_follow_view;
+    int  action_history_budget;
     bool show_tooptips;
 
     int  pannel_main_mode;
@@ -359,6 +376,7 @@ struct Application
         mouse_pointer_lock = false;
         mouse_pointer_strength = {0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f};
         action_history_follow_view = false;
+        action_history_budget = 64;
         show_tooptips = true;
         accept_connections = false;
         stream_protocol = 0;
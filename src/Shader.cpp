@@ -23,6 +23,10 @@
 #include <regex>
 #include <chrono>
 #include <ctime>
+#include <map>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
 
 #include <glad/glad.h> 
 #include <GLFW/glfw3.h>
@@ -33,6 +37,7 @@
 #include "Log.h"
 #include "Visitor.h"
 #include "BaseToolkit.h"
+#include "SystemToolkit.h"
 #include "RenderingManager.h"
 
 #include "Shader.h"
@@ -41,8 +46,16 @@
 //#define SHADER_DEBUG
 #endif
 
+// binding point of the uniform buffer of view matrices
+#define VIEW_BLOCK_BINDING 0
+#define VIEW_BUFFER_SLOTS 256
+
 // Globals
 ShadingProgram *ShadingProgram::currentProgram_ = nullptr;
+uint ShadingProgram::calls_issued_ = 0;
+uint ShadingProgram::calls_saved_ = 0;
+uint ShadingProgram::last_calls_issued_ = 0;
+uint ShadingProgram::last_calls_saved_ = 0;
 ShadingProgram simpleShadingProgram("shaders/simple.vs", "shaders/simple.fs");
 ShadingProgram textureShadingProgram("shaders/texture.vs", "shaders/texture.fs");
 
@@ -75,6 +88,70 @@ GLenum blending_destination_function[9] = {GL_ONE_MINUS_SRC_ALPHA,// normal
                                            GL_ONE,   // lighten only
                                            GL_ZERO};
 
+// Cache of GLSL program binaries, stored in the settings directory
+// and invalidated when the OpenGL driver changes
+std::string programCachePath()
+{
+    static std::string path;
+    static bool checked = false;
+
+    if (!checked) {
+        checked = true;
+
+        // program binaries must be supported by the driver
+        GLint formats = 0;
+        if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats < 1)
+            return path;
+
+        std::string dir = SystemToolkit::full_filename(SystemToolkit::settings_path(), "shaders");
+        if ( !SystemToolkit::file_exists(dir) && !SystemToolkit::create_directory(dir) )
+            return path;
+
+        // identify driver
+        std::string driver = std::string( (const char*) glGetString(GL_VENDOR) ) + " "
+                + std::string( (const char*) glGetString(GL_RENDERER) ) + " "
+                + std::string( (const char*) glGetString(GL_VERSION) );
+
+        // compare to driver of cached binaries
+        std::string driverfile = SystemToolkit::full_filename(dir, "driver");
+        std::string cached;
+        std::ifstream in(driverfile);
+        std::getline(in, cached);
+        in.close();
+
+        // invalid cache: delete all binaries
+        if (cached != driver) {
+            std::list<std::string> binaries = SystemToolkit::list_directory(dir, { "*.bin" });
+            for (auto it = binaries.begin(); it != binaries.end(); ++it)
+                SystemToolkit::remove_file(*it);
+            std::ofstream out(driverfile);
+            out << driver << std::endl;
+            if (!cached.empty())
+                Log::Info("Shader cache cleared for new driver %s", driver.c_str());
+        }
+
+        path = dir;
+    }
+
+    return path;
+}
+
+std::string programCacheFilename(size_t key)
+{
+    char name[32];
+    snprintf(name, 32, "%016lx.bin", (unsigned long) key);
+    return SystemToolkit::full_filename(programCachePath(), name);
+}
+
+// binaries also kept in memory (e.g. same filter used many times)
+struct ProgramBinary {
+    GLenum format;
+    std::vector<char> data;
+};
+std::map<size_t, ProgramBinary> programBinaries;
+
 ShadingProgram::ShadingProgram(const std::string& vertex, const std::string& fragment) :
     id_(0), need_compile_(true), lineshift_(0), vertex_(vertex), fragment_(fragment), promise_(nullptr)
 {
@@ -102,6 +179,19 @@ void ShadingProgram::compile()
     if (Resource::hasPath(fragment_))
         fragment_code = Resource::getText(fragment_);
 
+    // get program from binary cache if available
+    size_t key = BaseToolkit::hash(vertex_code.data(), vertex_code.size());
+    key = BaseToolkit::hash(fragment_code.data(), fragment_code.size(), key);
+    if ( loadBinary(key) ) {
+        glUseProgram(id_);
+        setup();
+        glUseProgram(0);
+        if (promise_)
+            promise_->set_value( "Ok" );
+        need_compile_ = false;
+        return;
+    }
+
     // VERTEX SHADER
     const char* vcode = vertex_code.c_str();
     unsigned int vertex_id_ = glCreateShader(GL_VERTEX_SHADER);
@@ -135,6 +225,8 @@ void ShadingProgram::compile()
             // attach shaders and link
             glAttachShader(id_, vertex_id_);
             glAttachShader(id_, fragment_id_);
+            if ( !programCachePath().empty() )
+                glProgramParameteri(id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
             glLinkProgram(id_);
 
             glGetProgramiv(id_, GL_LINK_STATUS, &success);
@@ -146,8 +238,9 @@ void ShadingProgram::compile()
             else {
                 // all good, set default uniforms
                 glUseProgram(id_);
-                glUniform1i(glGetUniformLocation(id_, "iChannel0"), 0);
-                glUniform1i(glGetUniformLocation(id_, "iChannel1"), 1);
+                setup();
+                // keep binary for next time
+                saveBinary(key);
 #ifdef SHADER_DEBUG
                 g_printerr("New GLSL Program %d \n", id_);
 #endif
@@ -227,92 +320,316 @@ void ShadingProgram::reset()
         glDeleteProgram(id_);
         id_ = 0;
     }
+    uniforms_.clear();
     ShadingProgram::enduse();
 }
 
+void ShadingProgram::setup()
+{
+    // get uniforms
+    cacheUniforms();
+
+    // set default uniforms
+    const char *channels[2] = { "iChannel0", "iChannel1" };
+    for (int c = 0; c < 2; ++c) {
+        Uniform *u = uniform(channels[c]);
+        if (u != nullptr && changed(u, &c, sizeof(int)))
+            glUniform1i(u->location, c);
+    }
+}
+
+bool ShadingProgram::loadBinary(size_t key)
+{
+    if ( programCachePath().empty() )
+        return false;
+
+    // read binary from disk if not in memory
+    std::string filename = programCacheFilename(key);
+    if ( programBinaries.count(key) < 1 ) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+            return false;
+        ProgramBinary b;
+        file.read( (char *) &b.format, sizeof(GLenum) );
+        b.data.assign( std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() );
+        if (b.data.empty())
+            return false;
+        programBinaries[key] = b;
+    }
+    const ProgramBinary &b = programBinaries[key];
+
+    // create program from binary
+    if (id_ != 0)
+        glDeleteProgram(id_);
+    id_ = glCreateProgram();
+    glProgramBinary(id_, b.format, b.data.data(), (GLsizei) b.data.size());
+
+    // binary can be rejected by driver
+    int success = GL_FALSE;
+    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(id_);
+        id_ = 0;
+        programBinaries.erase(key);
+        SystemToolkit::remove_file(filename);
+        return false;
+    }
+
+#ifdef SHADER_DEBUG
+    g_printerr("Cached GLSL Program %d \n", id_);
+#endif
+    return true;
+}
+
+void ShadingProgram::saveBinary(size_t key)
+{
+    if ( programCachePath().empty() )
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(id_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length < 1)
+        return;
+
+    ProgramBinary b;
+    b.data.resize(length);
+    glGetProgramBinary(id_, length, NULL, &b.format, b.data.data());
+
+    std::ofstream file(programCacheFilename(key), std::ios::binary);
+    if (file.is_open()) {
+        file.write( (const char *) &b.format, sizeof(GLenum) );
+        file.write( b.data.data(), b.data.size() );
+    }
+    programBinaries[key] = b;
+}
+
+void ShadingProgram::cacheUniforms()
+{
+    uniforms_.clear();
+
+    GLint count = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        char name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id_, (GLuint) i, 256, &length, &size, &type, name);
+
+        // ignore uniforms in blocks (no location)
+        GLint location = glGetUniformLocation(id_, name);
+        if (location < 0)
+            continue;
+
+        // arrays are named with '[0]' suffix
+        std::string n(name, length);
+        if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0)
+            n.resize(n.size() - 3);
+
+        Uniform u;
+        u.location = location;
+        u.set = false;
+        uniforms_[n] = u;
+    }
+
+    // connect the block of view matrices to the shared uniform buffer
+    GLuint block = glGetUniformBlockIndex(id_, "View");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(id_, block, VIEW_BLOCK_BINDING);
+}
+
+ShadingProgram::Uniform *ShadingProgram::uniform(const std::string& name)
+{
+    auto it = uniforms_.find(name);
+    if (it == uniforms_.end())
+        return nullptr;
+
+    // a cached location saves a call to glGetUniformLocation
+    ++calls_saved_;
+    return &it->second;
+}
+
+bool ShadingProgram::changed(Uniform *u, const void *val, size_t size)
+{
+    // same value as last set in this program: nothing to do
+    if (u->set && memcmp(u->value, val, size) == 0) {
+        ++calls_saved_;
+        return false;
+    }
+
+    memcpy(u->value, val, size);
+    u->set = true;
+    ++calls_issued_;
+    return true;
+}
+
+void ShadingProgram::setProjection(const glm::mat4 &projection)
+{
+    static GLuint buffer = 0;
+    static GLsizeiptr stride = 0;
+    static int slot = 0;
+    static GLFWwindow *context = nullptr;
+    static glm::mat4 value;
+    static bool set = false;
+
+    // create the buffer once (shared by all contexts), with a ring of slots
+    // so that a new projection never overwrites one in use by pending draws
+    if (buffer == 0) {
+        GLint align = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        stride = std::max<GLsizeiptr>( align, sizeof(glm::mat4) );
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, stride * VIEW_BUFFER_SLOTS, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // binding points are specific to each context
+    if (context != glfwGetCurrentContext()) {
+        context = glfwGetCurrentContext();
+        glBindBufferRange(GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, buffer, slot * stride, sizeof(glm::mat4));
+        ++calls_issued_;
+    }
+
+    // update buffer only if projection changed
+    if (set && value == projection) {
+        ++calls_saved_;
+        return;
+    }
+
+    // write in the next slot (orphan the buffer when all slots were used)
+    slot = (slot + 1) % VIEW_BUFFER_SLOTS;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (slot == 0)
+        glBufferData(GL_UNIFORM_BUFFER, stride * VIEW_BUFFER_SLOTS, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, slot * stride, sizeof(glm::mat4), glm::value_ptr(projection));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, buffer, slot * stride, sizeof(glm::mat4));
+    value = projection;
+    set = true;
+    ++calls_issued_;
+}
+
+void ShadingProgram::newFrame()
+{
+    last_calls_issued_ = calls_issued_;
+    last_calls_saved_ = calls_saved_;
+    calls_issued_ = 0;
+    calls_saved_ = 0;
+}
+
+uint ShadingProgram::callsIssued()
+{
+    return last_calls_issued_;
+}
+
+uint ShadingProgram::callsSaved()
+{
+    return last_calls_saved_;
+}
+
 template<>
 bool ShadingProgram::setUniform<int>(const std::string &name, int val)
 {
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform1i(uid, val);
+    if (changed(u, &val, sizeof(int)))
+        glUniform1i(u->location, val);
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<bool>(const std::string& name, bool val) {
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform1i(uid, val);
+    int v = val;
+    if (changed(u, &v, sizeof(int)))
+        glUniform1i(u->location, v);
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<float>(const std::string& name, float val) {
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform1f(uid, val);
+    if (changed(u, &val, sizeof(float)))
+        glUniform1f(u->location, val);
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<float>(const std::string& name, float val1, float val2) {
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform2f(uid, val1, val2);
+    float v[2] = {val1, val2};
+    if (changed(u, v, sizeof(v)))
+        glUniform2f(u->location, val1, val2);
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<float>(const std::string& name, float val1, float val2, float val3) {
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform3f(uid, val1, val2, val3);
+    float v[3] = {val1, val2, val3};
+    if (changed(u, v, sizeof(v)))
+        glUniform3f(u->location, val1, val2, val3);
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<glm::vec2>(const std::string& name, glm::vec2 val) {
-    glm::vec2 v(val);
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform2fv(uid, 1, glm::value_ptr(v));
+    if (changed(u, glm::value_ptr(val), sizeof(glm::vec2)))
+        glUniform2fv(u->location, 1, glm::value_ptr(val));
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<glm::vec3>(const std::string& name, glm::vec3 val) {
-    glm::vec3 v(val);
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform3fv(uid, 1, glm::value_ptr(v));
+    if (changed(u, glm::value_ptr(val), sizeof(glm::vec3)))
+        glUniform3fv(u->location, 1, glm::value_ptr(val));
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<glm::vec4>(const std::string& name, glm::vec4 val) {
-    glm::vec4 v(val);
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
         return false;
-    glUniform4fv(uid, 1, glm::value_ptr(v));
+    if (changed(u, glm::value_ptr(val), sizeof(glm::vec4)))
+        glUniform4fv(u->location, 1, glm::value_ptr(val));
     return true;
 }
 
 template<>
 bool ShadingProgram::setUniform<glm::mat4>(const std::string& name, glm::mat4 val) {
-    glm::mat4 m(val);
-    GLint uid = glGetUniformLocation(id_, name.c_str());
-    if (uid < 0)
+    Uniform *u = uniform(name);
+    if (u == nullptr)
+        return false;
+    if (changed(u, glm::value_ptr(val), sizeof(glm::mat4)))
+        glUniformMatrix4fv(u->location, 1, GL_FALSE, glm::value_ptr(val));
+    return true;
+}
+
+bool ShadingProgram::setUniform(const std::string& name, const std::vector<glm::mat4> &val) {
+    Uniform *u = uniform(name);
+    if (u == nullptr || val.empty())
         return false;
-    glUniformMatrix4fv(uid, 1, GL_FALSE, glm::value_ptr(m));
+    // arrays are not cached
+    u->set = false;
+    ++calls_issued_;
+    glUniformMatrix4fv(u->location, (GLsizei) val.size(), GL_FALSE, glm::value_ptr(val[0]));
     return true;
 }
 
@@ -346,14 +663,23 @@ void Shader::accept(Visitor& v) {
     v.visit(*this);
 }
 
+size_t Shader::hash() const
+{
+    size_t h = BaseToolkit::hash( glm::value_ptr(iTransform), sizeof(glm::mat4) );
+    h = BaseToolkit::hash( glm::value_ptr(color), sizeof(glm::vec4), h );
+    return BaseToolkit::hash( &blending, sizeof(BlendMode), h );
+}
+
 void Shader::use()
 {
     // Use program
     program_->use();
 
-    // set uniforms
-    program_->setUniform("projection", projection);
+    // set uniforms (projection is shared by all programs)
+    ShadingProgram::setProjection(projection);
     program_->setUniform("modelview", modelview);
+    if (!instances.empty())
+        program_->setUniform("instances", instances);
     program_->setUniform("iTransform", iTransform);
     program_->setUniform("color", color);
 
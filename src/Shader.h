@@ -4,6 +4,7 @@
 #include <future>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
 // Forward declare classes referenced
@@ -28,6 +29,15 @@ public:
     template<typename T> bool setUniform(const std::string& name, T val);
     template<typename T> bool setUniform(const std::string& name, T val1, T val2);
     template<typename T> bool setUniform(const std::string& name, T val1, T val2, T val3);
+    bool setUniform(const std::string& name, const std::vector<glm::mat4> &val);
+
+    // set the projection matrix in the uniform buffer shared by all programs
+    static void setProjection(const glm::mat4 &projection);
+
+    // count of GL calls issued and saved by caching during last frame
+    static void newFrame();
+    static uint callsIssued();
+    static uint callsSaved();
 
 private:
     unsigned int id_;
@@ -37,7 +47,25 @@ private:
     std::string fragment_;
     std::promise<std::string> *promise_;
 
+    // cache of locations and values of uniforms, filled at link
+    struct Uniform {
+        int location;
+        bool set;
+        float value[16];
+    };
+    std::unordered_map<std::string, Uniform> uniforms_;
+    void cacheUniforms();
+    void setup();
+
+    // binary of linked program cached on disk
+    bool loadBinary(size_t key);
+    void saveBinary(size_t key);
+    Uniform *uniform(const std::string& name);
+    static bool changed(Uniform *u, const void *val, size_t size);
+
     static ShadingProgram *currentProgram_;
+    static uint calls_issued_, calls_saved_;
+    static uint last_calls_issued_, last_calls_saved_;
 };
 
 class Shader
@@ -56,11 +84,17 @@ public:
     virtual void accept(Visitor& v);
     void copy(Shader const &S);
 
+    // hash of parameters, changes when any uniform changes
+    virtual size_t hash() const;
+
     glm::mat4 projection;
     glm::mat4 modelview;
     glm::mat4 iTransform;
     glm::vec4 color;
 
+    // modelview of instances after the first, for instanced drawing
+    std::vector<glm::mat4> instances;
+
     typedef enum {
         BLEND_OPACITY = 0,
         BLEND_SCREEN,
@@ -95,6 +95,11 @@ std::string ShmdataBroadcast::init(GstCaps *caps)
     // create a gstreamer pipeline
     std::string description = "appsrc name=src ! queue ! ";
 
+    // shared memory is in RGB: convert frames if given in YUV
+    GstVideoInfo info;
+    if ( gst_video_info_from_caps(&info, caps) && GST_VIDEO_INFO_IS_YUV(&info) )
+        description += "videoconvert ! video/x-raw, format=RGB ! ";
+
     // complement pipeline with sink
     description += shm_sink_[method_] + " name=sink";
 
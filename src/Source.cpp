@@ -22,6 +22,7 @@
 #include <tinyxml2.h>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include "defines.h"
 #include "FrameBuffer.h"
@@ -116,7 +117,10 @@ SourceCore& SourceCore::operator= (SourceCore const& other)
 }
 
 
-Source::Source(uint64_t id) : SourceCore(), id_(id), ready_(false), symbol_(nullptr),
+std::atomic<uint64_t> Source::renamed_(0);
+
+Source::Source(uint64_t id) : SourceCore(), id_(id), ready_(false),
+    rendered_generation_(0), rendered_parameters_(0), rendered_(false), symbol_(nullptr),
     active_(true), locked_(false), need_update_(SourceUpdate_None), dt_(16.f), workspace_(WORKSPACE_CENTRAL)
 {
     // create unique id
@@ -426,6 +430,8 @@ void Source::setName (const std::string &name)
     if (!name.empty())
         name_ = BaseToolkit::unspace( BaseToolkit::transliterate(name) );
 
+    ++renamed_;
+
     initials_[0] = std::toupper( name_.front(), std::locale("C") );
     initials_[1] = std::toupper( name_.back(), std::locale("C") );
 
@@ -526,11 +532,32 @@ bool Source::imageProcessingEnabled()
     return ( renderingshader_ == processingshader_ );
 }
 
+bool Source::needRender()
+{
+    // hash all parameters of the rendering pass
+    size_t h = texturesurface_->shader()->hash();
+    uint t = texturesurface_->textureIndex();
+    h = BaseToolkit::hash( &t, sizeof(uint), h );
+    glm::vec4 area = renderbuffer_->projectionArea();
+    h = BaseToolkit::hash( glm::value_ptr(area), sizeof(glm::vec4), h );
+    glm::vec3 res = renderbuffer_->resolution();
+    h = BaseToolkit::hash( glm::value_ptr(res), sizeof(glm::vec3), h );
+
+    // render if unknown content, new content, or changed parameters
+    uint64_t g = generation();
+    rendered_ = !ready_ || g == 0 || g != rendered_generation_ || h != rendered_parameters_;
+
+    rendered_generation_ = g;
+    rendered_parameters_ = h;
+
+    return rendered_;
+}
+
 void Source::render()
 {
     if ( renderbuffer_ == nullptr )
         init();
-    else {
+    else if ( needRender() ) {
         // render the view into frame buffer
         // NB: this also applies the color correction shader
         renderbuffer_->begin();
@@ -113,6 +113,8 @@ public:
     void setName (const std::string &name);
     inline std::string name () const { return name_; }
     inline const char *initials () const { return initials_; }
+    // incremented each time any source is renamed
+    static inline uint64_t renamed () { return renamed_; }
 
     // cloning mechanism
     virtual CloneSource *clone (uint64_t id = 0);
@@ -205,6 +207,12 @@ public:
     // a Source shall define how to render into the frame buffer
     virtual void render ();
 
+    // generation of the content to render, changes when a new frame is available
+    // (0 if unknown; the source is then rendered at every frame)
+    virtual uint64_t generation () const { return 0; }
+    // informs if the last call to render() did draw into the frame buffer
+    inline bool rendered () const { return rendered_; }
+
     // accept all kind of visitors
     virtual void accept (Visitor& v);
 
@@ -293,6 +301,7 @@ protected:
     // name
     std::string name_;
     char initials_[3];
+    static std::atomic<uint64_t> renamed_;
     uint64_t id_;
 
     // every Source shall be initialized to be ready after first draw
@@ -304,6 +313,13 @@ protected:
     FrameBuffer *renderbuffer_;
     void attach(FrameBuffer *renderbuffer);
 
+    // dirty tracking of render(): skip drawing in the renderbuffer
+    // when neither the content nor the parameters of rendering changed
+    bool needRender ();
+    uint64_t rendered_generation_;
+    size_t rendered_parameters_;
+    bool rendered_;
+
     // the rendersurface draws the renderbuffer in the scene
     // It is associated to the rendershader for mixing effects
     FrameBufferMeshSurface *rendersurface_;
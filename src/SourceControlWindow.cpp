@@ -1923,6 +1923,16 @@ void SourceControlWindow::RenderMediaPlayer(MediaSource *ms)
             mediaplayer_active_->setRewindOnDisabled(option);
         }
 
+        option = mediaplayer_active_->preload();
+        if (ImGui::MenuItem(ICON_FA_MEMORY "  Preload in memory", NULL, &option )) {
+            mediaplayer_active_->setPreload(option);
+        }
+
+        option = mediaplayer_active_->frameCache() > 0;
+        if (ImGui::MenuItem(ICON_FA_HISTORY "  Cache for backward play", NULL, &option, !mediaplayer_active_->preload() )) {
+            mediaplayer_active_->setFrameCache(option ? FRAME_CACHE_DEFAULT_MB : 0);
+        }
+
         if (ImGui::IsWindowHovered())
             counter_menu_timeout=0;
         else if (++counter_menu_timeout > 10)
@@ -71,6 +71,7 @@ Stream::Stream()
     // OpenGL texture
     textureindex_ = 0;
     textureinitialized_ = false;
+    generation_ = 0;
 }
 
 Stream::~Stream()
@@ -636,6 +637,9 @@ void Stream::init_texture(guint index)
 
 void Stream::fill_texture(guint index)
 {
+    // texture content changes
+    ++generation_;
+
     // is this the first frame ?
     if ( !textureinitialized_ || !textureindex_)
     {
@@ -139,6 +139,11 @@ public:
      * Must be called in OpenGL context
      * */
     guint texture() const;
+    /**
+     * Get the generation of the texture content,
+     * incremented each time a frame is filled in the texture
+     * */
+    inline uint64_t generation() const { return generation_; }
     /**
      * Get the name of the decoder used,
      * return 'software' if no hardware decoder is used
@@ -172,6 +177,7 @@ protected:
     uint64_t id_;
     std::string description_;
     guint textureindex_;
+    uint64_t generation_;
 
     // general properties of media
     guint width_;
@@ -112,6 +112,14 @@ uint StreamSource::texture() const
         return stream_->texture();
 }
 
+uint64_t StreamSource::generation() const
+{
+    if (stream_ == nullptr)
+        return 0;
+    else
+        return stream_->generation();
+}
+
 void StreamSource::init()
 {
     if ( stream_ && stream_->isOpen() ) {
@@ -38,6 +38,7 @@ public:
     guint64 playtime () const override;
     Failure failed() const override;
     uint texture() const override;
+    uint64_t generation () const override;
 
     // pure virtual interface
     virtual Stream *stream() const = 0;
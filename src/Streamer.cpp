@@ -156,8 +156,12 @@ std::vector<std::string> Streaming::listStreams()
 
     if (streamers_lock_.try_lock()) {
         std::vector<VideoStreamer *>::const_iterator sit = streamers_.begin();
-        for (; sit != streamers_.end(); ++sit)
-            ls.push_back( (*sit)->info() );
+        for (; sit != streamers_.end(); ++sit) {
+            // one stream per peer (even if encoder is shared)
+            std::vector<NetworkToolkit::StreamConfig> peers = (*sit)->peers();
+            for (auto pit = peers.cbegin(); pit != peers.cend(); ++pit)
+                ls.push_back( std::string(NetworkToolkit::stream_protocol_label[pit->protocol]) + " to " + pit->client_name );
+        }
         streamers_lock_.unlock();
     }
 
@@ -189,20 +193,20 @@ NetworkToolkit::StreamConfig Streaming::removeStream(const std::string &sender,
     // get ip of sender
     std::string sender_ip = sender.substr(0, sender.find_last_of(":"));
 
-    // parse the list for a streamers matching IP and port
+    // parse the list for a streamers having a peer matching IP and port
     streamers_lock_.lock();
     std::vector<VideoStreamer *>::const_iterator sit = streamers_.begin();
     for (; sit != streamers_.end(); ++sit){
-        NetworkToolkit::StreamConfig config = (*sit)->config_;
-        if (config.client_address.compare(sender_ip) == 0 && config.port == port ) {
+        if ( (*sit)->removePeer(sender_ip, port, &removed) ) {
 #ifdef STREAMER_DEBUG
-            Log::Info("Ending streaming to %s:%d", config.client_address.c_str(), config.port);
+            Log::Info("Ending streaming to %s:%d", removed.client_address.c_str(), removed.port);
 #endif
-            // match: stop this streamer
-            removed = config;
-            (*sit)->stop();
-            // remove from list
-            streamers_.erase(sit);
+            // stop this streamer if it has no more peers
+            if ( (*sit)->peers().empty() ) {
+                (*sit)->stop();
+                // remove from list
+                streamers_.erase(sit);
+            }
             break;
         }
     }
@@ -216,10 +220,10 @@ void Streaming::removeStreams(const std::string &clientname)
     streamers_lock_.lock();
     std::vector<VideoStreamer *>::const_iterator sit = streamers_.begin();
     while ( sit != streamers_.end() ){
-        NetworkToolkit::StreamConfig config = (*sit)->config_;
-        if (config.client_name.compare(clientname) == 0) {
+        // stop this streamer if it has no more peers
+        if ( (*sit)->removePeers(clientname) && (*sit)->peers().empty() ) {
 #ifdef STREAMER_DEBUG
-            Log::Info("Ending streaming to %s:%d", config.client_address.c_str(), config.port);
+            Log::Info("Ending streaming to %s", clientname.c_str());
 #endif
             // match: stop this streamer
             (*sit)->stop();
@@ -288,14 +292,8 @@ void Streaming::addStream(const std::string &sender, int port,
     conf.height = FrameGrabbing::manager().height();
     conf.protocol = Settings::application.stream_protocol > 0 ? NetworkToolkit::UDP_H264 : NetworkToolkit::UDP_JPEG;
 
-    // create streamer & remember it
-    VideoStreamer *streamer = new VideoStreamer(conf);
-    streamers_lock_.lock();
-    streamers_.push_back(streamer);
-    streamers_lock_.unlock();
-
-    // start streamer
-    FrameGrabbing::manager().add(streamer);
+    // start streaming
+    _startStream(conf);
 }
 
 void Streaming::_addStream(const std::string &sender, int reply_to,
@@ -349,9 +347,25 @@ void Streaming::_addStream(const std::string &sender, int reply_to,
     Log::Info("Starting streaming to %s:%d", sender_ip.c_str(), conf.port);
 #endif
 
-    // create streamer & remember it
-    VideoStreamer *streamer = new VideoStreamer(conf);
+    // start streaming
+    _startStream(conf);
+}
+
+void Streaming::_startStream(const NetworkToolkit::StreamConfig &conf)
+{
     streamers_lock_.lock();
+
+    // an encoder with same protocol and resolution can stream to one more peer
+    for (auto sit = streamers_.begin(); sit != streamers_.end(); ++sit) {
+        if ( (*sit)->accepts(conf) ) {
+            (*sit)->addPeer(conf);
+            streamers_lock_.unlock();
+            return;
+        }
+    }
+
+    // otherwise create streamer & remember it
+    VideoStreamer *streamer = new VideoStreamer(conf);
     streamers_.push_back(streamer);
     streamers_lock_.unlock();
 
@@ -360,9 +374,91 @@ void Streaming::_addStream(const std::string &sender, int reply_to,
 }
 
 
-VideoStreamer::VideoStreamer(const NetworkToolkit::StreamConfig &conf): FrameGrabber(), config_(conf), stopped_(false)
+VideoStreamer::VideoStreamer(const NetworkToolkit::StreamConfig &conf): FrameGrabber(), config_(conf), stopped_(false), sink_(nullptr)
 {
     frame_duration_ = gst_util_uint64_scale_int (1, GST_SECOND, STREAMING_FPS);  // fixed 30 FPS
+    peers_.push_back(conf);
+}
+
+bool VideoStreamer::accepts(const NetworkToolkit::StreamConfig &conf) const
+{
+    // shared memory socket is specific to each peer
+    if (conf.protocol == NetworkToolkit::SHM_RAW || config_.protocol == NetworkToolkit::SHM_RAW)
+        return false;
+
+    return !endofstream_ && !finished_ &&
+            conf.protocol == config_.protocol &&
+            conf.width == config_.width && conf.height == config_.height;
+}
+
+void VideoStreamer::addPeer(const NetworkToolkit::StreamConfig &conf)
+{
+    std::lock_guard<std::mutex> lock(peers_lock_);
+
+    // ignore repeated request
+    for (auto pit = peers_.cbegin(); pit != peers_.cend(); ++pit) {
+        if (pit->client_address.compare(conf.client_address) == 0 && pit->port == conf.port)
+            return;
+    }
+    peers_.push_back(conf);
+
+    // add destination to the running stream
+    // (otherwise all peers are added at init)
+    if (sink_) {
+        g_signal_emit_by_name (sink_, "add", conf.client_address.c_str(), conf.port, NULL);
+        // new peer needs a key frame to start decoding
+        if (config_.protocol == NetworkToolkit::UDP_H264)
+            gst_element_send_event(sink_, gst_video_event_new_upstream_force_key_unit(GST_CLOCK_TIME_NONE, TRUE, 0));
+    }
+
+#ifdef STREAMER_DEBUG
+    Log::Info("Streaming to %s:%d shares encoder with %ld other peer(s).", conf.client_address.c_str(), conf.port, peers_.size() - 1);
+#endif
+}
+
+bool VideoStreamer::removePeer(const std::string &address, int port, NetworkToolkit::StreamConfig *removed)
+{
+    std::lock_guard<std::mutex> lock(peers_lock_);
+
+    for (auto pit = peers_.begin(); pit != peers_.end(); ++pit) {
+        if (pit->client_address.compare(address) == 0 && pit->port == port) {
+            // remove destination from the running stream
+            if (sink_)
+                g_signal_emit_by_name (sink_, "remove", address.c_str(), port, NULL);
+            if (removed)
+                *removed = *pit;
+            peers_.erase(pit);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VideoStreamer::removePeers(const std::string &clientname)
+{
+    std::lock_guard<std::mutex> lock(peers_lock_);
+
+    bool ret = false;
+    for (auto pit = peers_.begin(); pit != peers_.end(); ) {
+        if (pit->client_name.compare(clientname) == 0) {
+            // remove destination from the running stream
+            if (sink_)
+                g_signal_emit_by_name (sink_, "remove", pit->client_address.c_str(), pit->port, NULL);
+            pit = peers_.erase(pit);
+            ret = true;
+        }
+        else
+            ++pit;
+    }
+
+    return ret;
+}
+
+std::vector<NetworkToolkit::StreamConfig> VideoStreamer::peers() const
+{
+    std::lock_guard<std::mutex> lock(peers_lock_);
+    return peers_;
 }
 
 std::string VideoStreamer::init(GstCaps *caps)
@@ -424,10 +520,12 @@ std::string VideoStreamer::init(GstCaps *caps)
                       "socket-path", path.c_str(),  NULL);
     }
     else {
-        g_object_set (G_OBJECT (gst_bin_get_by_name (GST_BIN (pipeline_), "sink")),
-                      "sync", FALSE,
-                      "host", config_.client_address.c_str(),
-                      "port", config_.port,  NULL);
+        // multiple udp sink sends to all peers
+        std::lock_guard<std::mutex> lock(peers_lock_);
+        sink_ = gst_bin_get_by_name (GST_BIN (pipeline_), "sink");
+        g_object_set (G_OBJECT (sink_), "sync", FALSE, NULL);
+        for (auto pit = peers_.cbegin(); pit != peers_.cend(); ++pit)
+            g_signal_emit_by_name (sink_, "add", pit->client_address.c_str(), pit->port, NULL);
     }
 
     // setup custom app source
@@ -498,6 +596,12 @@ void VideoStreamer::terminate()
 
     Log::Notify("Streaming to %s finished after %s s.", config_.client_name.c_str(),
                 GstToolkit::time_to_string(duration_).c_str());
+
+    // release sink
+    std::lock_guard<std::mutex> lock(peers_lock_);
+    if (sink_)
+        gst_object_unref (sink_);
+    sink_ = nullptr;
 }
 
 void VideoStreamer::stop ()
@@ -522,7 +626,9 @@ std::string VideoStreamer::info() const
     else if (active_) {
         ret << NetworkToolkit::stream_protocol_label[config_.protocol];
         ret << " to ";
-        ret << config_.client_name;
+        std::vector<NetworkToolkit::StreamConfig> p = peers();
+        for (auto pit = p.cbegin(); pit != p.cend(); ++pit)
+            ret << (pit == p.cbegin() ? "" : ", ") << pit->client_name;
     }
     else
         ret <<  "Streaming terminated.";
@@ -52,6 +52,7 @@ protected:
     void _addStream(const std::string &sender, int reply_to, const std::string &clientname,
                    NetworkToolkit::StreamProtocol protocol = NetworkToolkit::DEFAULT);
     void _refuseStream(const std::string &sender, int reply_to);
+    void _startStream(const NetworkToolkit::StreamConfig &conf);
 
 private:
 
@@ -73,10 +74,22 @@ class VideoStreamer : public FrameGrabber
     void terminate() override;
     void stop() override;
 
-    // connection information
+    // connection information (protocol and resolution of the encoder)
     NetworkToolkit::StreamConfig config_;
     std::atomic<bool> stopped_;
 
+    // peers receiving the encoded stream
+    // (UDP protocols share one encoder among all peers)
+    std::vector<NetworkToolkit::StreamConfig> peers_;
+    mutable std::mutex peers_lock_;
+    GstElement *sink_;
+
+    bool accepts(const NetworkToolkit::StreamConfig &conf) const;
+    void addPeer(const NetworkToolkit::StreamConfig &conf);
+    bool removePeer(const std::string &address, int port, NetworkToolkit::StreamConfig *removed = nullptr);
+    bool removePeers(const std::string &clientname);
+    std::vector<NetworkToolkit::StreamConfig> peers() const;
+
 public:
 
     VideoStreamer(const NetworkToolkit::StreamConfig &conf);
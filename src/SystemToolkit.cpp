@@ -294,6 +294,20 @@ unsigned long SystemToolkit::file_modification_time(const std::string& path)
     return 0;
 }
 
+unsigned long SystemToolkit::file_size(const std::string& path)
+{
+    if (file_exists(path)) {
+        struct stat statsfile;
+        // fill statistics of given file path
+        if( stat( path.c_str(), &statsfile) > -1 ) {
+            // return size
+            return (unsigned long) statsfile.st_size;
+        }
+    }
+
+    return 0;
+}
+
 std::string SystemToolkit::file_modification_time_string(const std::string& path)
 {
     ostringstream oss;
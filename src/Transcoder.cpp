@@ -0,0 +1,250 @@
+/*
+ * This file is part of vimix - video live mixer
+ *
+ * **Copyright** (C) 2019-2023 Bruno Herbelin <bruno.herbelin@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include <chrono>
+
+#include "defines.h"
+#include "Log.h"
+#include "GstToolkit.h"
+#include "SystemToolkit.h"
+#include "Settings.h"
+
+#include "Transcoder.h"
+
+
+Transcoder::Transcoder(const std::string &input, const std::string &output,
+                       VideoRecorder::Profile profile, bool audio) :
+    input_(input), output_(output), profile_(profile), audio_(audio),
+    started_(false), cancel_(false), progress_(0.f), speed_(0.f)
+{
+}
+
+Transcoder::~Transcoder()
+{
+    // stop and wait for thread to end
+    cancel();
+    if ( !promises_.empty() && promises_.back().valid() )
+        promises_.back().wait();
+}
+
+void Transcoder::start ()
+{
+    if ( promises_.empty() && !started_ ) {
+        filename_ = std::string();
+        cancel_ = false;
+        started_ = true;
+        promises_.emplace_back( std::async(std::launch::async, transcode, this) );
+    }
+}
+
+void Transcoder::cancel ()
+{
+    cancel_ = true;
+}
+
+bool Transcoder::finished ()
+{
+    if ( !promises_.empty() ) {
+        // check that transcoding thread finished
+        if (promises_.back().wait_for(std::chrono::milliseconds(4)) == std::future_status::ready ) {
+            // get the filename from encoder
+            filename_ = promises_.back().get();
+            if (!filename_.empty()) {
+                // save path location
+                Settings::application.recentRecordings.push(filename_);
+            }
+            // done with this transcoding
+            promises_.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Transcoder::transcode (Transcoder *job)
+{
+    std::string filename = std::string();
+    GstToolkit::background_priority();
+
+    // reset
+    job->progress_ = 0.f;
+    job->speed_ = 0.f;
+
+    if ( !SystemToolkit::file_exists(job->input_) ) {
+        Log::Warning("Transcoder: No file %s.", job->input_.c_str());
+        return filename;
+    }
+
+    // decode intermediate file and encode with the profile codec
+    std::string description = "filesrc name=src ! decodebin name=dec ";
+    description += "dec. ! queue ! videoconvert ! ";
+    description += VideoRecorder::encoder_description( job->profile_ );
+    if ( job->profile_ == VideoRecorder::VP8)
+        description += "webmmux name=mux ! filesink name=sink ";
+    else
+        description += "qtmux name=mux ! filesink name=sink ";
+    if ( job->audio_ ) {
+        description += "dec. ! queue ! audioconvert ! audioresample ! ";
+        if ( job->profile_ == VideoRecorder::VP8)
+            description += "opusenc ! opusparse ! queue ! mux.";
+        else
+            description += "voaacenc ! aacparse ! queue ! mux.";
+    }
+
+    // parse pipeline descriptor
+    GError *error = NULL;
+    GstElement *pipeline = gst_parse_launch (description.c_str(), &error);
+    if (error != NULL) {
+        Log::Warning("Transcoder Could not construct pipeline %s:\n%s", description.c_str(), error->message);
+        g_clear_error (&error);
+        return filename;
+    }
+
+    // setup file source and sink
+    GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+    GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+    g_object_set (G_OBJECT (src), "location", job->input_.c_str(), NULL);
+    g_object_set (G_OBJECT (sink), "location", job->output_.c_str(), "sync", FALSE, NULL);
+    gst_object_unref (src);
+    gst_object_unref (sink);
+
+    // all streaming threads run at low priority
+    GstToolkit::set_background_priority (pipeline);
+    GstBus *bus = gst_element_get_bus (pipeline);
+
+    Log::Info("Transcoder encoding %s to %s.", SystemToolkit::filename(job->input_).c_str(),
+              VideoRecorder::profile_name[job->profile_]);
+
+    bool success = false;
+    if ( gst_element_set_state (pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE )
+        Log::Warning("Transcoder Could not start pipeline.");
+    else {
+        auto start = std::chrono::steady_clock::now();
+        bool done = false;
+        while ( !done ) {
+            // wait for end of stream or error
+            GstMessage *msg = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND,
+                                                          (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+            if (msg != NULL) {
+                if ( GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR ) {
+                    GError *err = NULL;
+                    gst_message_parse_error (msg, &err, NULL);
+                    Log::Warning("Transcoder failed: %s", err ? err->message : "unknown error");
+                    g_clear_error (&err);
+                }
+                else
+                    success = true;
+                gst_message_unref (msg);
+                done = true;
+            }
+
+            // progressing
+            gint64 pos = 0, len = 0;
+            if ( gst_element_query_position (pipeline, GST_FORMAT_TIME, &pos) &&
+                 gst_element_query_duration (pipeline, GST_FORMAT_TIME, &len) && len > 0 ) {
+                job->progress_ = CLAMP( (float) pos / (float) len, 0.f, 1.f);
+                std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+                if ( elapsed.count() > 0.f )
+                    job->speed_ = ((float) pos / (float) GST_SECOND) / elapsed.count();
+            }
+
+            // interrupt
+            if ( job->cancel_ )
+                done = true;
+        }
+    }
+
+    // clean
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    if ( success && !job->cancel_ ) {
+        filename = job->output_;
+        // intermediate file is not needed anymore
+        SystemToolkit::remove_file(job->input_);
+        Log::Info("Transcoder %s encoded in %s.", filename.c_str(), VideoRecorder::profile_name[job->profile_]);
+    }
+    else
+        // do not leave an incomplete file
+        SystemToolkit::remove_file(job->output_);
+
+    // finished
+    job->progress_ = 1.f;
+
+    return filename;
+}
+
+
+Transcoding::Transcoding()
+{
+}
+
+Transcoding::~Transcoding()
+{
+    for (auto j = jobs_.begin(); j != jobs_.end(); ++j)
+        delete *j;
+    jobs_.clear();
+}
+
+void Transcoding::add (Transcoder *job)
+{
+    if (job)
+        jobs_.push_back(job);
+}
+
+void Transcoding::cancel ()
+{
+    if (!jobs_.empty())
+        jobs_.front()->cancel();
+}
+
+// stop encoding at exit; intermediate captures are kept
+void Transcoding::terminate ()
+{
+    for (auto j = jobs_.begin(); j != jobs_.end(); ++j) {
+        (*j)->cancel();
+        Log::Warning("Video encoding interrupted; capture kept in %s.", (*j)->input().c_str());
+        // wait for transcoding thread to end
+        delete *j;
+    }
+    jobs_.clear();
+}
+
+void Transcoding::update ()
+{
+    if (jobs_.empty())
+        return;
+
+    // one job at a time, in order
+    Transcoder *job = jobs_.front();
+    if ( !job->started() )
+        job->start();
+    else if ( job->finished() ) {
+        if ( !job->filename().empty() )
+            Log::Notify("Video Recording %s is ready.", job->filename().c_str());
+        else if ( job->cancelled() )
+            Log::Notify("Video encoding cancelled; capture kept in %s.", job->input().c_str());
+        else
+            Log::Warning("Video encoding failed; capture kept in %s.", job->input().c_str());
+
+        jobs_.pop_front();
+        delete job;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include <list>
+#include <string>
+#include <atomic>
+#include <vector>
+#include <future>
+
+#include <gst/gst.h>
+
+#include "Recorder.h"
+
+/**
+ * @brief The Transcoder class encodes a video file captured with an
+ * intermediate codec into the final codec of a recording profile.
+ *
+ * Transcoding runs in a separate thread at low priority.
+ */
+class Transcoder
+{
+public:
+    Transcoder(const std::string &input, const std::string &output,
+               VideoRecorder::Profile profile, bool audio);
+    ~Transcoder();
+
+    // process control
+    void start ();
+    void cancel ();
+    bool finished ();
+    inline bool started () const { return started_; }
+    inline bool cancelled () const { return cancel_; }
+
+    // source and result
+    inline std::string input () const { return input_; }
+    inline std::string output () const { return output_; }
+    inline std::string filename () const { return filename_; }
+    inline VideoRecorder::Profile profile () const { return profile_; }
+    inline float progress () const { return progress_; }
+    inline float speed () const { return speed_; }
+
+protected:
+    static std::string transcode (Transcoder *job);
+
+private:
+    std::string input_;
+    std::string output_;
+    std::string filename_;
+    VideoRecorder::Profile profile_;
+    bool audio_;
+
+    bool started_;
+    std::atomic<bool> cancel_;
+    std::atomic<float> progress_;
+    std::atomic<float> speed_;
+    std::vector< std::future<std::string> >promises_;
+};
+
+/**
+ * @brief The Transcoding class runs transcoders one after the other
+ *
+ * OutputPreviewWindow calls update() at every frame
+ */
+class Transcoding
+{
+    // Private Constructor
+    Transcoding();
+    Transcoding(Transcoding const& copy) = delete;
+    Transcoding& operator=(Transcoding const& copy) = delete;
+
+public:
+
+    static Transcoding& manager()
+    {
+        // The only instance
+        static Transcoding _instance;
+        return _instance;
+    }
+    ~Transcoding();
+
+    void add (Transcoder *job);
+    void update ();
+    void cancel ();
+    void terminate ();
+
+    inline Transcoder *current () const { return jobs_.empty() ? nullptr : jobs_.front(); }
+    inline size_t pending () const { return jobs_.size(); }
+
+private:
+    std::list<Transcoder *> jobs_;
+};
+
+#endif // TRANSCODER_H
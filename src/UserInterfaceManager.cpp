@@ -63,6 +63,7 @@
 #include "ControlManager.h"
 #include "ActionManager.h"
 #include "Resource.h"
+#include "Shader.h"
 #include "Connection.h"
 #include "SessionCreator.h"
 #include "Mixer.h"
@@ -1495,7 +1496,11 @@ enum MetricsFlags_
     Metrics_gpu        = 4,
     Metrics_session    = 8,
     Metrics_runtime    = 16,
-    Metrics_lifetime   = 32
+    Metrics_lifetime   = 32,
+    Metrics_capture    = 64,
+    Metrics_sources    = 128,
+    Metrics_glcalls    = 256,
+    Metrics_transforms = 512
 };
 
 void UserInterface::RenderMetrics(bool *p_open, int* p_corner, int *p_mode)
@@ -1627,6 +1632,68 @@ void UserInterface::RenderMetrics(bool *p_open, int* p_corner, int *p_mode)
             ImGuiToolkit::ToolTip("Accumulated runtime of vimix\nsince its installation");
     }
 
+    // frame capture if recording or streaming
+    if (*p_mode & Metrics_capture && FrameGrabbing::manager().busy()) {
+        ImGuiToolkit::PushFont(ImGuiToolkit::FONT_BOLD);
+        snprintf(dummy_str, 256, "%.1f ms", FrameGrabbing::manager().readbackLatency());
+        ImGui::SetNextItemWidth(_width);
+        ImGui::InputText("##dummy4", dummy_str, IM_ARRAYSIZE(dummy_str), ImGuiInputTextFlags_ReadOnly);
+        ImGui::PopFont();
+        ImGui::SameLine(0, IMGUI_SAME_LINE);
+        ImGui::Text("Capture");
+        if (ImGui::IsItemHovered()) {
+            snprintf(dummy_str, 256, "Latency of frame capture\n(%lu frames dropped)",
+                     (unsigned long) FrameGrabbing::manager().droppedFrames());
+            ImGuiToolkit::ToolTip(dummy_str);
+        }
+    }
+
+    // sources rendered in the last frame
+    if (*p_mode & Metrics_sources) {
+        Session *se = Mixer::manager().session();
+        ImGuiToolkit::PushFont(ImGuiToolkit::FONT_BOLD);
+        snprintf(dummy_str, 256, "%u / %u", se->renderedSources(), se->renderedSources() + se->skippedSources());
+        ImGui::SetNextItemWidth(_width);
+        ImGui::InputText("##dummy5", dummy_str, IM_ARRAYSIZE(dummy_str), ImGuiInputTextFlags_ReadOnly);
+        ImGui::PopFont();
+        ImGui::SameLine(0, IMGUI_SAME_LINE);
+        ImGui::Text("Sources");
+        if (ImGui::IsItemHovered()) {
+            snprintf(dummy_str, 256, "Sources rendered in last frame\n(%u unchanged sources skipped)", se->skippedSources());
+            ImGuiToolkit::ToolTip(dummy_str);
+        }
+    }
+
+    // GL calls saved by shading programs in the last frame
+    if (*p_mode & Metrics_glcalls) {
+        ImGuiToolkit::PushFont(ImGuiToolkit::FONT_BOLD);
+        snprintf(dummy_str, 256, "%u", ShadingProgram::callsSaved());
+        ImGui::SetNextItemWidth(_width);
+        ImGui::InputText("##dummy6", dummy_str, IM_ARRAYSIZE(dummy_str), ImGuiInputTextFlags_ReadOnly);
+        ImGui::PopFont();
+        ImGui::SameLine(0, IMGUI_SAME_LINE);
+        ImGui::Text("GL saved");
+        if (ImGui::IsItemHovered()) {
+            snprintf(dummy_str, 256, "OpenGL calls saved by caching\nuniforms in last frame\n(%u calls issued)", ShadingProgram::callsIssued());
+            ImGuiToolkit::ToolTip(dummy_str);
+        }
+    }
+
+    // transforms of scene graph nodes computed in the last frame
+    if (*p_mode & Metrics_transforms) {
+        ImGuiToolkit::PushFont(ImGuiToolkit::FONT_BOLD);
+        snprintf(dummy_str, 256, "%u", Node::transformsComputed());
+        ImGui::SetNextItemWidth(_width);
+        ImGui::InputText("##dummy7", dummy_str, IM_ARRAYSIZE(dummy_str), ImGuiInputTextFlags_ReadOnly);
+        ImGui::PopFont();
+        ImGui::SameLine(0, IMGUI_SAME_LINE);
+        ImGui::Text("Transforms");
+        if (ImGui::IsItemHovered()) {
+            snprintf(dummy_str, 256, "Transforms of nodes\nrecomputed in last frame\n(%u nodes updated)", Node::nodesUpdated());
+            ImGuiToolkit::ToolTip(dummy_str);
+        }
+    }
+
     ImGui::PopStyleVar();
 
     if (ImGui::BeginPopup("metrics_menu"))
@@ -1645,6 +1712,14 @@ void UserInterface::RenderMetrics(bool *p_open, int* p_corner, int *p_mode)
             *p_mode ^= Metrics_runtime;
         if (ImGui::MenuItem( "Lifetime", NULL, *p_mode & Metrics_lifetime))
             *p_mode ^= Metrics_lifetime;
+        if (ImGui::MenuItem( "Capture", NULL, *p_mode & Metrics_capture))
+            *p_mode ^= Metrics_capture;
+        if (ImGui::MenuItem( "Sources", NULL, *p_mode & Metrics_sources))
+            *p_mode ^= Metrics_sources;
+        if (ImGui::MenuItem( "GL calls", NULL, *p_mode & Metrics_glcalls))
+            *p_mode ^= Metrics_glcalls;
+        if (ImGui::MenuItem( "Transforms", NULL, *p_mode & Metrics_transforms))
+            *p_mode ^= Metrics_transforms;
 
         ImGui::Separator();
 
@@ -2362,7 +2437,8 @@ void ToolBox::Render()
     static float recorded_bounds[3][2] = {  {40.f, 65.f}, {1.f, 50.f}, {0.f, 50.f} };
     static float refresh_rate = -1.f;
     static int   values_index = 0;
-    float megabyte = static_cast<float>( static_cast<double>(FrameBuffer::memory_usage()) / 1000000.0 );
+    unsigned long pooled = 0, pooled_peak = 0;
+    float megabyte = static_cast<float>( static_cast<double>(FrameBuffer::memory_usage(&pooled, &pooled_peak)) / 1000000.0 );
 
     // init
     if (refresh_rate < 0.f) {
@@ -2422,7 +2498,8 @@ void ToolBox::Render()
     ImGui::PlotLines("LinesRender", recorded_values[0], PLOT_ARRAY_SIZE, values_index, overlay, recorded_bounds[0][0], recorded_bounds[0][1], plot_size);
     snprintf(overlay, 128, "Update time %.1f ms (%.1f FPS)", recorded_sum[1] / float(PLOT_ARRAY_SIZE), (float(PLOT_ARRAY_SIZE) * 1000.f) / recorded_sum[1]);
     ImGui::PlotHistogram("LinesMixer", recorded_values[1], PLOT_ARRAY_SIZE, values_index, overlay, recorded_bounds[1][0], recorded_bounds[1][1], plot_size);
-    snprintf(overlay, 128, "Framebuffers %.1f MB", recorded_values[2][(values_index+PLOT_ARRAY_SIZE-1) % PLOT_ARRAY_SIZE] );
+    snprintf(overlay, 128, "Framebuffers %.1f MB (pool %.1f MB, peak %.1f MB)", recorded_values[2][(values_index+PLOT_ARRAY_SIZE-1) % PLOT_ARRAY_SIZE],
+             static_cast<double>(pooled) / 1000000.0, static_cast<double>(pooled_peak) / 1000000.0 );
     ImGui::PlotLines("LinesMemo", recorded_values[2], PLOT_ARRAY_SIZE, values_index, overlay, recorded_bounds[2][0], recorded_bounds[2][1], plot_size);
 
     ImGui::End();
@@ -3894,6 +3971,8 @@ void Navigator::RenderNewPannel(const ImVec2 &iconsize)
                     ImGui::Text("Frames :");ImGui::SameLine(150);
                     ImGui::Text("%lu / %lu", (unsigned long)_video_recorder.numFrames(),
                                 (unsigned long)_video_recorder.files().size() );
+                    ImGui::Text("Speed :");ImGui::SameLine(150);
+                    ImGui::Text("%.1f fps", _video_recorder.speed() );
 
                     ImGui::Spacing();
                     ImGui::ProgressBar(_video_recorder.progress());
@@ -5013,6 +5092,8 @@ void Navigator::RenderMainPannelPlaylist()
         if ( !Settings::application.recentFolders.path.empty())
             folder_session_files = SystemToolkit::list_directory( Settings::application.recentFolders.path, { VIMIX_FILE_PATTERN },
                                                        (SystemToolkit::Ordering) Settings::application.recentFolders.ordering);
+        // prepare information of session files in background
+        SessionCreator::requestInfo(folder_session_files);
     }
 
     //
@@ -5319,11 +5400,14 @@ void Navigator::RenderMainPannelPlaylist()
         static std::string _file_info = "";
         static Thumbnail _file_thumbnail;
         static bool with_tag_ = false;
+        static bool _pending = false;
 
-        // load info only if changed from the one already displayed
-        if (session_hovered_ != _current_hovered) {
+        // get info only if changed from the one already displayed
+        // (or until it is read in background)
+        if (session_hovered_ != _current_hovered || _pending) {
             _current_hovered = session_hovered_;
-            SessionInformation info = SessionCreator::info(_current_hovered);
+            SessionInformation info;
+            _pending = !SessionCreator::peekInfo(_current_hovered, info);
             _file_info = info.description;
             if (info.thumbnail) {
                 // set image content to thumbnail display
@@ -5498,6 +5582,21 @@ void Navigator::RenderMainPannelSettings()
     if (ImGuiToolkit::TextButton("Codec"))
         Settings::application.record.profile = 0;
 
+    ImGuiToolkit::Indication("Capture frames with a cheap intermediate codec during recording,\n"
+                             "and encode to the selected codec in background afterwards;\n"
+                             ICON_FA_CARET_RIGHT " Direct: encode while recording.\n"
+                             ICON_FA_CARET_RIGHT " Raw: uncompressed frames (large files).\n"
+                             ICON_FA_CARET_RIGHT " Lossless: Huffyuv compressed frames.", ICON_FA_STOPWATCH);
+    ImGui::SameLine(0);
+    ImGui::SetCursorPosX(width_);
+    ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
+    ImGui::Combo("##Capture", &Settings::application.record.capture_mode,
+                 VideoRecorder::capture_mode_name,
+                 IM_ARRAYSIZE(VideoRecorder::capture_mode_name));
+    ImGui::SameLine(0, IMGUI_SAME_LINE);
+    if (ImGuiToolkit::TextButton("Capture"))
+        Settings::application.record.capture_mode = 0;
+
     ImGui::SetCursorPosX(width_);
     ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
     ImGui::Combo("##Framerate",
@@ -5530,6 +5629,19 @@ void Navigator::RenderMainPannelSettings()
     if (ImGuiToolkit::TextButton("Buffer"))
         Settings::application.record.buffering_mode = 2;
 
+    ImGuiToolkit::Indication("Overflow of the buffer on disk when the encoder is too slow;\n"
+                             "frames are stored in a file reserved in the recording folder\n"
+                             "instead of being skipped, and encoded when the encoder catches up.", ICON_FA_HDD);
+    ImGui::SameLine(0);
+    ImGui::SetCursorPosX(width_);
+    ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
+    ImGui::SliderInt("##Spill", &Settings::application.record.spill_mode, 0,
+                     IM_ARRAYSIZE(VideoRecorder::spill_preset_name)-1,
+                     VideoRecorder::spill_preset_name[Settings::application.record.spill_mode]);
+    ImGui::SameLine(0, IMGUI_SAME_LINE);
+    if (ImGuiToolkit::TextButton("Overflow"))
+        Settings::application.record.spill_mode = 0;
+
     ImGuiToolkit::Indication("Priority when buffer is full and recorder has to skip frames;\n"
                              ICON_FA_CARET_RIGHT " Duration: Correct duration, variable framerate."
                              ICON_FA_CARET_RIGHT " Framerate: Correct framerate, shorter duration.\n",
@@ -5542,6 +5654,33 @@ void Navigator::RenderMainPannelSettings()
     if (ImGuiToolkit::TextButton("Priority"))
         Settings::application.record.priority_mode = 1;
 
+    ImGuiToolkit::Indication("Pixel format of frames given to recorders and streamers;\n"
+                             ICON_FA_CARET_RIGHT " RGB: converted by each encoder on CPU.\n"
+                             ICON_FA_CARET_RIGHT " I420 / NV12: converted once on GPU, halves readback.",
+                             ICON_FA_MICROCHIP);
+    ImGui::SameLine(0);
+    ImGui::SetCursorPosX(width_);
+    ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
+    ImGui::Combo("##Conversion", &Settings::application.record.conversion_mode, "RGB\0I420\0NV12\0");
+    ImGui::SameLine(0, IMGUI_SAME_LINE);
+    if (ImGuiToolkit::TextButton("Conversion"))
+        Settings::application.record.conversion_mode = 0;
+
+    ImGuiToolkit::Indication("Instant replay keeps the last seconds of output encoded "
+                             "in memory, to be saved at any time from the Record menu.", ICON_FA_HISTORY);
+    ImGui::SameLine(0);
+    ImGui::SetCursorPosX(width_);
+    ImGui::SetNextItemWidth(IMGUI_RIGHT_ALIGN);
+    int replay = Settings::application.record.replay ? Settings::application.record.replay_duration : 0;
+    if (ImGui::SliderInt("##Replay", &replay, 0, 120, replay > 0 ? "%d s" : "Off")) {
+        Settings::application.record.replay = replay > 0;
+        if (replay > 0)
+            Settings::application.record.replay_duration = replay;
+    }
+    ImGui::SameLine(0, IMGUI_SAME_LINE);
+    if (ImGuiToolkit::TextButton("Replay"))
+        Settings::application.record.replay = false;
+
     //
     // AUDIO
     //
@@ -5755,6 +5894,14 @@ void Navigator::RenderMainPannelSettings()
     else
         ImGui::TextDisabled("Hardware en/decoding unavailable");
 
+    // YUV texturing deserves more explanation
+    ImGuiToolkit::Indication("If enabled, videos are uploaded to the graphics card in their native "
+                             "YUV format and converted to RGB on the GPU. Reduces CPU usage when "
+                             "playing many videos (applies to videos opened afterwards; "
+                             "the alpha channel of videos is ignored).", ICON_FA_MICROCHIP);
+    ImGui::SameLine(0);
+    ImGuiToolkit::ButtonSwitch( "GPU color conversion", &Settings::application.render.yuv_texturing);
+
     // audio support deserves more explanation
     ImGuiToolkit::Indication("If enabled, tries to find audio in openned videos "
                              "and allows recording audio.", audio ? ICON_FA_VOLUME_UP : ICON_FA_VOLUME_MUTE);
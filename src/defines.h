@@ -203,6 +203,7 @@
 #define SHORTCUT_RECORDCONT   CTRL_MOD "Shift+R"
 #define MENU_RECORDPAUSE      ICON_FA_PAUSE_CIRCLE "  Pause Record"
 #define SHORTCUT_RECORDPAUSE  CTRL_MOD "Space"
+#define MENU_SAVEREPLAY       ICON_FA_HISTORY "  Save instant replay"
 #define MENU_CAPTUREFRAME     ICON_FA_CAMERA_RETRO "  Capture frame"
 #define SHORTCUT_CAPTURE_DISPLAY "F11"
 #define SHORTCUT_CAPTURE_PLAYER "F10"
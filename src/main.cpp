@@ -25,12 +25,15 @@
 
 // vmix
 #include "Settings.h"
+#include "SystemToolkit.h"
+#include "Log.h"
 #include "Mixer.h"
 #include "RenderingManager.h"
 #include "UserInterfaceManager.h"
 #include "ControlManager.h"
 #include "Connection.h"
 #include "Metronome.h"
+#include "Transcoder.h"
 #include "Audio.h"
 
 #if defined(APPLE)
@@ -73,6 +76,7 @@ int main(int argc, char *argv[])
     int helpRequested = 0;
     int fontsizeRequested = 0;
     std::string settingsRequested;
+    std::string logfileRequested;
     int ret = -1;
 
     for (int i = 1; i < argc; ++i) {
@@ -93,6 +97,15 @@ int main(int argc, char *argv[])
                 fprintf(stderr, "Error: filename missing after --settings\n");
                 helpRequested = 1;
             }
+        } else if (strcmp(argv[i], "--logfile") == 0 || strcmp(argv[i], "-O") == 0) {
+            // get log file argument
+            if (i + 1 < argc) {
+                logfileRequested = argv[i + 1];
+                i++; // Skip the next argument since it's already processed
+            } else {
+                fprintf(stderr, "Error: filename missing after --logfile\n");
+                helpRequested = 1;
+            }
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-H") == 0) {
             helpRequested = 1;
         } else if (strcmp(argv[i], "--fontsize") == 0 || strcmp(argv[i], "-F") == 0) {
@@ -147,7 +160,7 @@ int main(int argc, char *argv[])
 
     if (helpRequested) {
         printf("Usage: %s [-H, --help] [-V, --version] [-F, --fontsize] [-L, --headless]\n"
-               "               [-S, --settings] [-T, --test] [-C, --clean] [filename]\n",
+               "               [-S, --settings] [-O, --logfile] [-T, --test] [-C, --clean] [filename]\n",
                argv[0]);
         printf("Options:\n");
         printf("  --help       : Display usage information\n");
@@ -155,6 +168,7 @@ int main(int argc, char *argv[])
         printf("  --fontsize   : Force rendering font size to specified value, e.g., '-F 25'\n");
         printf("  --settings   : Run with given settings file, e.g., '-S settingsfile.xml'\n");
         printf("  --headless   : Run without GUI (only if output windows configured)\n");
+        printf("  --logfile    : Write logs to given file, e.g., '-O vimix.log'\n");
         printf("  --test       : Run rendering test and return\n");
         printf("  --clean      : Reset user settings\n");
         printf("Filename:\n");
@@ -174,6 +188,11 @@ int main(int argc, char *argv[])
     Settings::Load( settingsRequested );
     Settings::application.executable = std::string(argv[0]);
 
+    /// log to file if requested, or by default without GUI
+    if (logfileRequested.empty() && headlessRequested)
+        logfileRequested = SystemToolkit::full_filename(SystemToolkit::settings_path(), "vimix.log");
+    Log::SetLogFile(logfileRequested.c_str());
+
     /// lock to inform an instance is running
     Settings::Lock();
 
@@ -271,6 +290,11 @@ int main(int argc, char *argv[])
     ///
     Connection::manager().terminate();
 
+    ///
+    /// TRANSCODING TERMINATE
+    ///
+    Transcoding::manager().terminate();
+
     /// unlock on clean exit
     Settings::Unlock();
 
@@ -279,6 +303,9 @@ int main(int argc, char *argv[])
     ///
     Settings::Save(UserInterface::manager().Runtime());
 
+    /// flush log file
+    Log::Terminate();
+
     /// ok
     return 0;
 }